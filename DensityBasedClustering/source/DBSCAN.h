@@ -0,0 +1,247 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  UI-free density-based clustering (DBSCAN; Ester et al., 1996) over a 2-D PointSet. Used by the
+//  web demo (DensityBasedExample).
+//
+//  A point is core if at least minPts points (itself included) lie strictly within epsilon of it,
+//  an edge point if it isn't core but some core point lies within epsilon, and noise otherwise.
+//  Core points within epsilon of each other are in the same cluster; each edge point joins the
+//  cluster of its nearest core neighbor (ties to the lower id), and noise belongs to none.
+//
+//  Neighborhoods come from a uniform grid with half-epsilon cells (GridIndex), so each query
+//  visits the 5x5 block of cells around a point instead of every point. Any two points in one cell
+//  are neighbors, so the work is mostly per cell (Gunawan, 2013; Wang et al., 2020):
+//  - A cell holding minPts points is all core, with no queries; otherwise core counting stops as
+//    soon as minPts is reached.
+//  - The core points of a cell form one component, so the lock-free union-find
+//    (ConcurrentDisjointSet) runs over cells: two nearby cells are linked once any pair of their
+//    cores are neighbors, and pairs already connected aren't checked at all.
+//  - Non-core points then attach to their nearest core neighbor.
+//  Squared distances are compared against the largest value whose square root is still below
+//  epsilon, so labels match the plain sqrt(dx^2 + dy^2) < epsilon test exactly.
+//
+//  Every phase is split across a ThreadPool (SetNumThreads()). Clusters are numbered in order of
+//  their smallest point id, so results don't depend on the thread count. Each run's time and
+//  query count per phase are kept for benchmarking (GetStats()).
+
+#ifndef CLUSTERING_DBSCAN_H
+#define CLUSTERING_DBSCAN_H
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "base/vector.h"
+
+#include "../../KMeansClusteringExample/source/PointSet.h"
+#include "../../KMeansClusteringExample/source/ThreadPool.h"
+#include "GridIndex.h"
+#include "DisjointSet.h"
+
+namespace clustering {
+
+  /// What part does a point play in the density structure? (Values match the web demo's ids.)
+  enum class DensityRole : uint8_t { NONE = 0, CORE = 1, EDGE = 2, NOISE = 3 };
+
+  /// Cluster id of noise points.
+  constexpr size_t NOISE_CLUSTER = std::numeric_limits<size_t>::max();
+
+  /// The largest squared distance d2 with sqrt(d2) < epsilon (negative if there is none).
+  inline double SquaredRadiusBelow(double epsilon) {
+    if (!(epsilon > 0.0)) return -1.0;
+    double limit = epsilon * epsilon;
+    while (limit > 0.0 && !(std::sqrt(limit) < epsilon)) limit = std::nextafter(limit, 0.0);
+    while (std::sqrt(std::nextafter(limit, std::numeric_limits<double>::infinity())) < epsilon) {
+      limit = std::nextafter(limit, std::numeric_limits<double>::infinity());
+    }
+    return limit;
+  }
+
+  /// Summary of a DBSCAN run.
+  struct DBSCANResult {
+    size_t num_clusters;
+    size_t num_core;
+    size_t num_edge;
+    size_t num_noise;
+  };
+
+  /// Wall time (seconds) and neighborhood queries of each phase of a DBSCAN run.
+  struct DBSCANStats {
+    double index_seconds;    //< Building the grid.
+    double core_seconds;     //< Finding core points.
+    double link_seconds;     //< Linking cores into clusters.
+    double border_seconds;   //< Attaching non-core points to their nearest core.
+    double label_seconds;    //< Numbering clusters.
+    size_t core_queries;     //< Point neighborhoods counted.
+    size_t link_queries;     //< Cell pairs (or core neighborhoods) checked.
+    size_t border_queries;   //< Non-core neighborhoods searched.
+  };
+
+  class DBSCAN {
+  protected:
+    double epsilon;                   //< Neighborhood radius (exclusive).
+    size_t min_pts;                   //< Neighbors (self included) needed to be a core point.
+    GridIndex index;                  //< Half-epsilon grid over the last points clustered.
+    bool cell_level;                  //< Did the last run link whole cells (or single points)?
+    emp::vector<DensityRole> roles;   //< Core/edge/noise for each point.
+    emp::vector<size_t> labels;       //< Cluster of each point (NOISE_CLUSTER for noise).
+    ConcurrentDisjointSet components; //< Cells (or core points) linked so far.
+    emp::vector<uint8_t> core_cells;  //< Scratch: does each cell hold a core point?
+    emp::vector<size_t> border_core;  //< Scratch: nearest core neighbor of each non-core point.
+    emp::vector<size_t> component_labels; //< Scratch: cluster id of each component root.
+    emp::vector<size_t> thread_queries; //< Scratch: per-thread query counts.
+    size_t neighbor_queries;          //< Point neighborhood and cell-pair queries issued by the last run.
+    DBSCANStats stats;                //< Per-phase breakdown of the last run.
+    ThreadPool pool;                  //< Worker threads (just the caller by default).
+
+  public:
+    DBSCAN(double _epsilon = 1.0, size_t _min_pts = 5)
+      : epsilon(_epsilon), min_pts(_min_pts), index(), cell_level(false), roles(), labels(), components(),
+        core_cells(), border_core(), component_labels(), thread_queries(), neighbor_queries(0),
+        stats{0.0, 0.0, 0.0, 0.0, 0.0, 0, 0, 0}, pool(1) { ; }
+
+    double GetEpsilon() const { return epsilon; }
+    size_t GetMinPts() const { return min_pts; }
+    size_t GetNumThreads() const { return pool.GetNumThreads(); }
+    const GridIndex & GetIndex() const { return index; }
+    const emp::vector<DensityRole> & GetRoles() const { return roles; }
+    DensityRole GetRole(size_t i) const { return roles[i]; }
+    const emp::vector<size_t> & GetLabels() const { return labels; }
+    size_t GetLabel(size_t i) const { return labels[i]; }
+    size_t GetNeighborQueries() const { return neighbor_queries; }
+    const DBSCANStats & GetStats() const { return stats; }
+
+    void SetEpsilon(double _epsilon) { epsilon = _epsilon; }
+    void SetMinPts(size_t _min_pts) { min_pts = _min_pts; }
+    /// How many threads should the engine use? (0 = one per hardware thread.)
+    void SetNumThreads(size_t num_threads) { pool.SetNumThreads(num_threads); }
+
+    /// Label every point core, edge or noise, and give every non-noise point a cluster id
+    /// (0 .. num_clusters - 1).
+    DBSCANResult Run(const PointSet & points) {
+      const size_t n = points.GetSize();
+      const double max_dist_sq = SquaredRadiusBelow(epsilon);
+      auto phase_start = std::chrono::steady_clock::now();
+      const auto lap = [&phase_start]() {
+        const auto now = std::chrono::steady_clock::now();
+        const double seconds = std::chrono::duration<double>(now - phase_start).count();
+        phase_start = now;
+        return seconds;
+      };
+      const auto total_queries = [this]() {
+        size_t total = 0;
+        for (size_t queries : thread_queries) total += queries;
+        return total;
+      };
+      index.Build(points, epsilon, 2);
+      stats.index_seconds = lap();
+      // Any two points sharing a (half-epsilon) cell are neighbors, unless the grid had to be coarsened.
+      cell_level = index.GetReach() >= 2 && max_dist_sq >= 0.0;
+      const size_t num_cells = index.GetNumCells();
+      roles.assign(n, DensityRole::NONE);
+      labels.assign(n, NOISE_CLUSTER);
+      border_core.assign(n, NOISE_CLUSTER);
+      core_cells.assign(num_cells, 0);
+      thread_queries.assign(pool.GetNumThreads(), 0);
+      const auto is_core = [this](size_t j) { return roles[j] == DensityRole::CORE; };
+
+      // Core points, a cell at a time; a cell with min_pts points needs no queries at all.
+      pool.ForRanges(num_cells, [this, max_dist_sq](size_t t, size_t begin, size_t end) {
+        for (size_t cell = begin; cell < end; ++cell) {
+          const size_t first = index.GetCellBegin(cell), last = index.GetCellEnd(cell);
+          const bool all_core = cell_level && last - first >= min_pts;
+          for (size_t pos = first; pos < last; ++pos) {
+            const size_t i = index.GetSortedId(pos);
+            if (!all_core) {
+              ++thread_queries[t];
+              if (index.CountNeighbors(i, max_dist_sq, min_pts) < min_pts) continue;
+            }
+            roles[i] = DensityRole::CORE;
+            core_cells[cell] = 1;
+          }
+        }
+      });
+      stats.core_seconds = lap();
+      stats.core_queries = total_queries();
+
+      if (cell_level) {
+        // The cores of a cell are one component; link two cells once any of their cores are
+        // neighbors (each pair once, from the lower cell, skipped if already connected).
+        components.Reset(num_cells);
+        pool.ForRanges(num_cells, [this, max_dist_sq, &is_core](size_t t, size_t begin, size_t end) {
+          for (size_t cell = begin; cell < end; ++cell) {
+            if (!core_cells[cell]) continue;
+            index.VisitNeighborCells(cell, [&](size_t other) {
+              if (other <= cell || !core_cells[other] || components.SameSet(cell, other)) return;
+              ++thread_queries[t];
+              if (index.AnyPairWithin(cell, other, max_dist_sq, is_core)) components.Union(cell, other);
+            });
+          }
+        });
+      } else {
+        // Link core points within epsilon of each other (each pair once, from its lower id).
+        components.Reset(n);
+        pool.ForRanges(n, [this, max_dist_sq](size_t t, size_t begin, size_t end) {
+          for (size_t pos = begin; pos < end; ++pos) {
+            const size_t i = index.GetSortedId(pos);
+            if (roles[i] != DensityRole::CORE) continue;
+            ++thread_queries[t];
+            index.VisitNeighbors(i, max_dist_sq, [this, i](size_t j, double) {
+              if (j > i && roles[j] == DensityRole::CORE) components.Union(i, j);
+              return false;
+            });
+          }
+        });
+      }
+      stats.link_seconds = lap();
+      stats.link_queries = total_queries() - stats.core_queries;
+
+      // Each non-core point finds its nearest core neighbor, if any.
+      pool.ForRanges(n, [this, max_dist_sq](size_t t, size_t begin, size_t end) {
+        for (size_t pos = begin; pos < end; ++pos) {
+          const size_t i = index.GetSortedId(pos);
+          if (roles[i] == DensityRole::CORE) continue;
+          ++thread_queries[t];
+          double best_dist = std::numeric_limits<double>::max();
+          size_t & best = border_core[i];
+          index.VisitNeighbors(i, max_dist_sq, [this, &best, &best_dist](size_t j, double dist_sq) {
+            if (roles[j] == DensityRole::CORE && (dist_sq < best_dist || (dist_sq == best_dist && j < best))) {
+              best = j;
+              best_dist = dist_sq;
+            }
+            return false;
+          });
+        }
+      });
+      neighbor_queries = total_queries();
+      stats.border_seconds = lap();
+      stats.border_queries = neighbor_queries - stats.core_queries - stats.link_queries;
+
+      // Number the clusters in order of their smallest point.
+      DBSCANResult result{0, 0, 0, 0};
+      component_labels.assign(components.GetSize(), NOISE_CLUSTER);
+      for (size_t i = 0; i < n; ++i) {
+        if (roles[i] != DensityRole::CORE) continue;
+        size_t & label = component_labels[components.Find(cell_level ? index.GetCell(i) : i)];
+        if (label == NOISE_CLUSTER) label = result.num_clusters++;
+        labels[i] = label;
+        ++result.num_core;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        if (roles[i] == DensityRole::CORE) continue;
+        const bool is_edge = border_core[i] != NOISE_CLUSTER;
+        roles[i] = is_edge ? DensityRole::EDGE : DensityRole::NOISE;
+        if (is_edge) { labels[i] = labels[border_core[i]]; ++result.num_edge; }
+        else ++result.num_noise;
+      }
+      stats.label_seconds = lap();
+      return result;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Lock-free concurrent disjoint-set (union-find) over element ids 0..n-1, after Anderson & Woll
+//  ("Wait-free Parallel Algorithms for the Union-Find Problem", 1991) and Jayanti & Tarjan (2016).
+//  Every parent pointer is an atomic; Find() halves paths with compare-and-swap and Union() links
+//  one root under the other with a single CAS, retrying if another thread got there first.
+//  Roots are always linked under the smaller id, so when the unions are done each set's root is its
+//  smallest element, no matter how threads interleaved (results don't depend on scheduling).
+//  Safe to call Find()/Union() from any number of threads at once; Reset() is not.
+//  DisjointSet is the single-threaded counterpart that can grow a set at a time (incremental
+//  clustering), with the same smallest-root rule.
+
+#ifndef CLUSTERING_DISJOINT_SET_H
+#define CLUSTERING_DISJOINT_SET_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "base/vector.h"
+
+namespace clustering {
+
+  class ConcurrentDisjointSet {
+  protected:
+    std::unique_ptr<std::atomic<size_t>[]> parent;   //< parent[i] == i for roots.
+    size_t size;
+
+  public:
+    ConcurrentDisjointSet(size_t n = 0) : parent(), size(0) { Reset(n); }
+
+    size_t GetSize() const { return size; }
+
+    /// n singleton sets. (Not thread-safe.)
+    void Reset(size_t n) {
+      if (n != size) { parent.reset(n ? new std::atomic<size_t>[n] : nullptr); size = n; }
+      for (size_t i = 0; i < n; ++i) parent[i].store(i, std::memory_order_relaxed);
+    }
+
+    /// Root of x's set, halving the path on the way up.
+    size_t Find(size_t x) {
+      while (true) {
+        size_t p = parent[x].load(std::memory_order_relaxed);
+        if (p == x) return x;
+        const size_t grandparent = parent[p].load(std::memory_order_relaxed);
+        if (grandparent == p) return p;
+        // Point x at its grandparent; if another thread moved it first, its new parent is just as good.
+        parent[x].compare_exchange_weak(p, grandparent, std::memory_order_relaxed);
+        x = grandparent;
+      }
+    }
+
+    /// Are a and b in the same set (at the moment of the call)?
+    bool SameSet(size_t a, size_t b) {
+      while (true) {
+        a = Find(a);
+        b = Find(b);
+        if (a == b) return true;
+        // a was still a root when we looked at b: they really were apart.
+        if (parent[a].load(std::memory_order_relaxed) == a) return false;
+      }
+    }
+
+    /// Merge the sets of a and b. Returns false if they already were one set.
+    bool Union(size_t a, size_t b) {
+      while (true) {
+        a = Find(a);
+        b = Find(b);
+        if (a == b) return false;
+        if (a < b) std::swap(a, b);
+        // Link the larger root under the smaller; fails (and retries) if a stopped being a root.
+        size_t expected = a;
+        if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return true;
+      }
+    }
+  };
+
+  class DisjointSet {
+  protected:
+    emp::vector<size_t> parent;   //< parent[i] == i for roots.
+
+  public:
+    DisjointSet() : parent() { ; }
+
+    size_t GetSize() const { return parent.size(); }
+    void Clear() { parent.clear(); }
+
+    /// Add a singleton set; returns its element.
+    size_t AddSet() { parent.push_back(parent.size()); return parent.size() - 1; }
+
+    /// Root of x's set, halving the path on the way up.
+    size_t Find(size_t x) {
+      while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+      }
+      return x;
+    }
+
+    /// Merge the sets of a and b; returns the root of the result (the smaller of the two roots).
+    size_t Union(size_t a, size_t b) {
+      a = Find(a);
+      b = Find(b);
+      if (b < a) std::swap(a, b);
+      parent[b] = a;
+      return a;
+    }
+  };
+
+}
+
+#endif
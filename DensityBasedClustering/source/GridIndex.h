@@ -0,0 +1,211 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Uniform-grid spatial index over 2-D points, for fixed-radius (epsilon) neighborhood queries.
+//  Cells are radius / S wide (S = subdivisions, 1 by default), so every neighbor of a point lies
+//  in the (2S + 1) x (2S + 1) block of cells around its own. Points are sorted by cell (row-major
+//  over cell coordinates, only non-empty cells are stored), and each cell caches the 2S + 1 runs
+//  of cells that cover its block, so a query is a few contiguous scans over packed coordinates
+//  with no hashing or searching. Distances are compared squared.
+//  With S = 2, two points in one cell are always within the radius of each other, which lets
+//  callers reason about whole cells at once (DBSCAN does), and the 5x5 block of half-radius cells
+//  covers less area than the 3x3 block of radius-wide ones.
+//  Build is O(n log n); memory is O(n) no matter how sparse the points are.
+
+#ifndef CLUSTERING_GRID_INDEX_H
+#define CLUSTERING_GRID_INDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "base/vector.h"
+
+#include "../../KMeansClusteringExample/source/PointSet.h"
+
+namespace clustering {
+
+  class GridIndex {
+  protected:
+    static constexpr double MAX_CELLS_PER_AXIS = 1048576.0;   //< Coarser cells beyond this (keys stay small).
+    static constexpr double CELL_MARGIN = 1e-9;               //< Relative: rounding can't push a neighbor out of reach.
+
+    struct Range { size_t begin; size_t end; };   //< A run of cells [begin, end).
+
+    double cell_size;
+    size_t reach;                      //< Cells searched on each side of a point's own.
+    double min_x, min_y;
+    uint64_t num_rows;                 //< Cells along y (the key is cell_x * num_rows + cell_y).
+    emp::vector<uint64_t> cell_keys;   //< Non-empty cells, sorted.
+    emp::vector<size_t> cell_start;    //< Points of cell c are order[cell_start[c], cell_start[c + 1]).
+    emp::vector<Range> blocks;         //< 2 * reach + 1 per cell: the runs covering nearby columns.
+    emp::vector<size_t> order;         //< Point ids sorted by cell.
+    emp::vector<double> sorted_x;      //< Coordinates in sorted order (queries stream these).
+    emp::vector<double> sorted_y;
+    emp::vector<size_t> point_cell;    //< Cell index of each point.
+    emp::vector<size_t> point_pos;     //< Position of each point in the sorted order.
+
+    uint64_t CellX(double x) const { return (uint64_t) ((x - min_x) / cell_size); }
+    uint64_t CellY(double y) const { return (uint64_t) ((y - min_y) / cell_size); }
+
+    /// Index of the first non-empty cell whose key is >= key.
+    size_t LowerBound(uint64_t key) const {
+      return (size_t) (std::lower_bound(cell_keys.begin(), cell_keys.end(), key) - cell_keys.begin());
+    }
+
+    const Range * GetBlock(size_t cell) const { return blocks.data() + (2 * reach + 1) * cell; }
+
+  public:
+    GridIndex() : cell_size(1.0), reach(1), min_x(0.0), min_y(0.0), num_rows(1), cell_keys(), cell_start(),
+                  blocks(), order(), sorted_x(), sorted_y(), point_cell(), point_pos() { ; }
+
+    size_t GetSize() const { return order.size(); }
+    size_t GetNumCells() const { return cell_keys.size(); }
+    double GetCellSize() const { return cell_size; }
+    /// Cells searched on each side (the subdivisions asked for, or 1 if the grid had to be coarsened).
+    size_t GetReach() const { return reach; }
+    /// Id of the point at position pos of the cell order (walking positions keeps work local).
+    size_t GetSortedId(size_t pos) const { return order[pos]; }
+    /// Cell index of point i.
+    size_t GetCell(size_t i) const { return point_cell[i]; }
+    /// Points of a cell are GetSortedId(pos) for pos in [GetCellBegin(cell), GetCellEnd(cell)).
+    size_t GetCellBegin(size_t cell) const { return cell_start[cell]; }
+    size_t GetCellEnd(size_t cell) const { return cell_start[cell + 1]; }
+
+    /// Index the (2-D) points for queries of radius up to radius, with cells radius / subdivisions
+    /// wide (or coarser, if that would make more than MAX_CELLS_PER_AXIS cells along an axis).
+    void Build(const PointSet & points, double radius, size_t subdivisions = 1) {
+      const size_t n = points.GetSize();
+      const double * xs = points.GetColumn(0);
+      const double * ys = points.GetColumn(1);
+      min_x = min_y = 0.0;
+      double max_x = 0.0, max_y = 0.0;
+      if (n) {
+        min_x = max_x = xs[0];
+        min_y = max_y = ys[0];
+        for (size_t i = 1; i < n; ++i) {
+          min_x = std::min(min_x, xs[i]); max_x = std::max(max_x, xs[i]);
+          min_y = std::min(min_y, ys[i]); max_y = std::max(max_y, ys[i]);
+        }
+      }
+      const double extent = std::max(max_x - min_x, max_y - min_y);
+      reach = std::max<size_t>(subdivisions, 1);
+      cell_size = radius * (1.0 + CELL_MARGIN) / (double) reach;
+      if (cell_size < extent / MAX_CELLS_PER_AXIS) {
+        cell_size = std::max(radius * (1.0 + CELL_MARGIN), extent / MAX_CELLS_PER_AXIS);
+        reach = 1;
+      }
+      if (!(cell_size > 0.0)) cell_size = 1.0;   // One point (or all identical) and radius 0.
+      num_rows = CellY(max_y) + 1;
+
+      // Sort point ids by cell.
+      emp::vector<std::pair<uint64_t, size_t>> keyed(n);
+      for (size_t i = 0; i < n; ++i) keyed[i] = { CellX(xs[i]) * num_rows + CellY(ys[i]), i };
+      std::sort(keyed.begin(), keyed.end());
+      order.resize(n);
+      sorted_x.resize(n);
+      sorted_y.resize(n);
+      point_cell.resize(n);
+      point_pos.resize(n);
+      cell_keys.clear();
+      cell_start.clear();
+      for (size_t pos = 0; pos < n; ++pos) {
+        const size_t i = keyed[pos].second;
+        if (cell_keys.empty() || cell_keys.back() != keyed[pos].first) {
+          cell_keys.push_back(keyed[pos].first);
+          cell_start.push_back(pos);
+        }
+        order[pos] = i;
+        sorted_x[pos] = xs[i];
+        sorted_y[pos] = ys[i];
+        point_cell[i] = cell_keys.size() - 1;
+        point_pos[i] = pos;
+      }
+      cell_start.push_back(n);
+
+      // For each cell, the runs holding cells (x', y - reach .. y + reach) for x' = x - reach .. x + reach.
+      const size_t width = 2 * reach + 1;
+      blocks.resize(width * cell_keys.size());
+      for (size_t c = 0; c < cell_keys.size(); ++c) {
+        const uint64_t cx = cell_keys[c] / num_rows;
+        const uint64_t cy = cell_keys[c] % num_rows;
+        const uint64_t y_lo = (cy >= reach) ? cy - reach : 0;
+        const uint64_t y_hi = std::min<uint64_t>(cy + reach, num_rows - 1);
+        for (uint64_t k = 0; k < width; ++k) {
+          Range & range = blocks[width * c + k];
+          if (cx + k < reach) { range = { 0, 0 }; continue; }   // Columns left of 0 don't exist.
+          const uint64_t col = cx + k - reach;
+          range.begin = LowerBound(col * num_rows + y_lo);
+          range.end = LowerBound(col * num_rows + y_hi + 1);
+        }
+      }
+    }
+
+    /// Call fun(j, dist_sq) for every indexed point j (i itself included) whose squared distance
+    /// dist_sq to point i is at most max_dist_sq (which must not exceed the radius the index was
+    /// built for, squared). fun returns true to stop early; returns whether it did.
+    template <typename FUN_T>
+    bool VisitNeighbors(size_t i, double max_dist_sq, FUN_T && fun) const {
+      const double x = sorted_x[point_pos[i]];
+      const double y = sorted_y[point_pos[i]];
+      const Range * block = GetBlock(point_cell[i]);
+      for (size_t k = 0; k < 2 * reach + 1; ++k) {
+        for (size_t pos = cell_start[block[k].begin]; pos < cell_start[block[k].end]; ++pos) {
+          const double dx = sorted_x[pos] - x;
+          const double dy = sorted_y[pos] - y;
+          const double dist_sq = dx * dx + dy * dy;
+          if (dist_sq <= max_dist_sq && fun(order[pos], dist_sq)) return true;
+        }
+      }
+      return false;
+    }
+
+    /// How many indexed points (i included) lie within max_dist_sq of point i? Counting stops
+    /// once limit is reached (checked after each run, so the scans themselves stay branch-free).
+    size_t CountNeighbors(size_t i, double max_dist_sq, size_t limit) const {
+      const double x = sorted_x[point_pos[i]];
+      const double y = sorted_y[point_pos[i]];
+      const Range * block = GetBlock(point_cell[i]);
+      size_t count = 0;
+      for (size_t k = 0; k < 2 * reach + 1 && count < limit; ++k) {
+        for (size_t pos = cell_start[block[k].begin]; pos < cell_start[block[k].end]; ++pos) {
+          const double dx = sorted_x[pos] - x;
+          const double dy = sorted_y[pos] - y;
+          count += (dx * dx + dy * dy <= max_dist_sq);
+        }
+      }
+      return count;
+    }
+
+    /// Call fun(other) for every non-empty cell in the block around cell (cell itself included).
+    template <typename FUN_T>
+    void VisitNeighborCells(size_t cell, FUN_T && fun) const {
+      const Range * block = GetBlock(cell);
+      for (size_t k = 0; k < 2 * reach + 1; ++k) {
+        for (size_t other = block[k].begin; other < block[k].end; ++other) fun(other);
+      }
+    }
+
+    /// Is some point of cell_a within max_dist_sq of some point of cell_b, considering only
+    /// points for which keep(id) is true? Stops at the first such pair.
+    template <typename KEEP_T>
+    bool AnyPairWithin(size_t cell_a, size_t cell_b, double max_dist_sq, KEEP_T && keep) const {
+      for (size_t pos_a = cell_start[cell_a]; pos_a < cell_start[cell_a + 1]; ++pos_a) {
+        if (!keep(order[pos_a])) continue;
+        const double x = sorted_x[pos_a];
+        const double y = sorted_y[pos_a];
+        for (size_t pos_b = cell_start[cell_b]; pos_b < cell_start[cell_b + 1]; ++pos_b) {
+          const double dx = sorted_x[pos_b] - x;
+          const double dy = sorted_y[pos_b] - y;
+          if (dx * dx + dy * dy <= max_dist_sq && keep(order[pos_b])) return true;
+        }
+      }
+      return false;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,376 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  HDBSCAN (Campello, Moulavi & Sander, 2013): density-based clustering without a global epsilon,
+//  so clusters of different densities can coexist. Works on the same PointSet as DBSCAN/OPTICS.
+//  - Core distance of a point: distance to its minPts-th nearest point (itself included, as in
+//    DBSCAN). Mutual reachability of a and b: max(core(a), core(b), dist(a, b)).
+//  - Minimum spanning tree of the mutual-reachability graph by Boruvka rounds over a kd-tree
+//    (PointKdTree; after McInnes & Healy, 2017): every round, each point looks for its cheapest
+//    edge to another component, and each component adds its cheapest. A search skips subtrees
+//    that are entirely in the point's own component, or whose bound (box distance, smallest core
+//    distance below) can't beat the best edge its component has found so far (seeded with last
+//    round's edges that still leave it). Rounds at least halve the number of components, and the
+//    searches are split across a ThreadPool.
+//  - Single-linkage hierarchy from the sorted MST, condensed with min_cluster_size: a split only
+//    makes new clusters if both sides are that big; otherwise points just fall out of the cluster.
+//  - Flat clustering by excess of mass: a cluster is kept if its stability (sum over its points of
+//    lambda = 1 / distance beyond its birth) is at least that of its kept descendants.
+//  Ties are broken by point id everywhere (edges compare as (weight, lower id, higher id)), so the
+//  MST and labels don't depend on the thread count. Clusters are numbered by their smallest point.
+
+#ifndef CLUSTERING_HDBSCAN_H
+#define CLUSTERING_HDBSCAN_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <tuple>
+
+#include "base/vector.h"
+
+#include "../../KMeansClusteringExample/source/PointSet.h"
+#include "../../KMeansClusteringExample/source/ThreadPool.h"
+#include "DBSCAN.h"
+#include "DisjointSet.h"
+#include "KdTree.h"
+
+namespace clustering {
+
+  /// An edge of the mutual-reachability minimum spanning tree.
+  struct HDBSCANEdge {
+    size_t a;
+    size_t b;
+    double weight_sq;   //< Squared mutual-reachability distance.
+
+    /// Total order used everywhere: by weight, then by endpoints.
+    bool operator<(const HDBSCANEdge & other) const {
+      return std::make_tuple(weight_sq, std::min(a, b), std::max(a, b))
+           < std::make_tuple(other.weight_sq, std::min(other.a, other.b), std::max(other.a, other.b));
+    }
+  };
+
+  /// Summary of an HDBSCAN run.
+  struct HDBSCANResult {
+    size_t num_clusters;
+    size_t num_noise;
+    size_t num_rounds;   //< Boruvka rounds needed for the spanning tree.
+  };
+
+  class HDBSCAN {
+  protected:
+    static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+    static constexpr double MAX_LAMBDA = 1e200;   //< lambda = 1 / distance for distance 0 (duplicates).
+
+    size_t min_pts;                      //< Neighbors (self included) that set a point's core distance.
+    size_t min_cluster_size;             //< Smallest split-off group that counts as a cluster (0 = min_pts).
+    PointKdTree tree;                    //< Over the last points clustered.
+    emp::vector<double> core_sq;         //< Squared core distance of each point.
+    emp::vector<HDBSCANEdge> mst;        //< Spanning tree, sorted.
+    emp::vector<size_t> labels;          //< Cluster of each point (NOISE_CLUSTER for noise).
+    emp::vector<double> point_lambda;    //< lambda at which each point left the condensed tree.
+    emp::vector<double> cluster_stability; //< Stability of each condensed-tree cluster (0 = root).
+    emp::vector<emp::vector<double>> thread_heaps; //< Scratch: per-thread k-nearest heaps.
+
+    // Boruvka scratch.
+    ConcurrentDisjointSet components;
+    emp::vector<size_t> point_component; //< Component (root) of each point this round.
+    emp::vector<size_t> node_component;  //< Component shared by every point below a tree node, or NONE.
+    emp::vector<double> node_min_core;   //< Smallest squared core distance below each tree node.
+    std::unique_ptr<std::atomic<double>[]> component_bound; //< Cheapest edge found so far, per component.
+    emp::vector<double> best_sq;         //< Cheapest edge found from each point this round...
+    emp::vector<size_t> best_to;         //< ...and where it goes (NONE if none).
+    emp::vector<size_t> component_pick;  //< Point whose edge each component adds (NONE if none).
+    ThreadPool pool;                     //< Worker threads (just the caller by default).
+
+    static double Lambda(double dist_sq) { return dist_sq > 0.0 ? 1.0 / std::sqrt(dist_sq) : MAX_LAMBDA; }
+
+    static void AtomicMin(std::atomic<double> & target, double value) {
+      double cur = target.load(std::memory_order_relaxed);
+      while (value < cur && !target.compare_exchange_weak(cur, value, std::memory_order_relaxed)) { ; }
+    }
+
+    /// Cheapest edge from a point (at x, squared core distance core, in component comp) to another
+    /// component within node's subtree; updates best/best_id. Ties go to the lower id.
+    void SearchOther(size_t node, const double * x, double core, size_t comp, double & best, size_t & best_id) const {
+      const PointKdTree::Node & cur = tree.GetNode(node);
+      if (cur.IsLeaf()) {
+        for (size_t pos = cur.begin; pos < cur.end; ++pos) {
+          const size_t other = tree.GetSortedId(pos);
+          if (point_component[other] == comp) continue;
+          const double weight = std::max(std::max(core, core_sq[other]), tree.DistSq(pos, x));
+          if (weight < best || (weight == best && other < best_id)) { best = weight; best_id = other; }
+        }
+        return;
+      }
+      size_t near = cur.left, far = cur.right;
+      double near_bound = Bound(near, x, core), far_bound = Bound(far, x, core);
+      if (far_bound < near_bound) { std::swap(near, far); std::swap(near_bound, far_bound); }
+      // Only strictly worse subtrees are skipped, so equal-weight edges still compete on ids.
+      const double limit = std::min(best, component_bound[comp].load(std::memory_order_relaxed));
+      if (node_component[near] != comp && near_bound <= limit) SearchOther(near, x, core, comp, best, best_id);
+      const double limit2 = std::min(best, component_bound[comp].load(std::memory_order_relaxed));
+      if (node_component[far] != comp && far_bound <= limit2) SearchOther(far, x, core, comp, best, best_id);
+    }
+
+    /// Lower bound on the squared mutual reachability from x (core distance core) into node.
+    double Bound(size_t node, const double * x, double core) const {
+      return std::max(std::max(core, node_min_core[node]), tree.BoxDistSq(node, x));
+    }
+
+    /// Minimum spanning tree of the mutual-reachability graph; returns the number of rounds.
+    size_t BuildSpanningTree() {
+      const size_t n = tree.GetSize();
+      const size_t num_nodes = tree.GetNumNodes();
+      components.Reset(n);
+      point_component.resize(n);
+      node_component.resize(num_nodes);
+      best_sq.resize(n);
+      best_to.resize(n);
+      for (size_t i = 0; i < n; ++i) { best_sq[i] = std::numeric_limits<double>::infinity(); best_to[i] = NONE; }
+      component_pick.resize(n);
+      component_bound.reset(n ? new std::atomic<double>[n] : nullptr);
+      mst.clear();
+
+      size_t num_components = n, rounds = 0;
+      while (num_components > 1) {
+        ++rounds;
+        pool.ForRanges(n, [this](size_t, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            point_component[i] = components.Find(i);
+            component_pick[i] = NONE;
+            component_bound[i].store(std::numeric_limits<double>::infinity(), std::memory_order_relaxed);
+          }
+        });
+        // Children come after their parents, so one backwards pass fills in every node.
+        for (size_t node = num_nodes; node-- > 0; ) {
+          const PointKdTree::Node & cur = tree.GetNode(node);
+          if (cur.IsLeaf()) {
+            size_t comp = point_component[tree.GetSortedId(cur.begin)];
+            for (size_t pos = cur.begin + 1; pos < cur.end && comp != NONE; ++pos) {
+              if (point_component[tree.GetSortedId(pos)] != comp) comp = NONE;
+            }
+            node_component[node] = comp;
+          } else {
+            const size_t left = node_component[cur.left];
+            node_component[node] = (left == node_component[cur.right]) ? left : NONE;
+          }
+        }
+
+        // Last round's edges that still leave their component are a head start: they bound the
+        // searches from the beginning.
+        pool.ForRanges(n, [this](size_t, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) {
+            if (best_to[i] == NONE) continue;
+            if (point_component[best_to[i]] == point_component[i]) {
+              best_sq[i] = std::numeric_limits<double>::infinity();
+              best_to[i] = NONE;
+            } else {
+              AtomicMin(component_bound[point_component[i]], best_sq[i]);
+            }
+          }
+        });
+
+        // Each point's cheapest edge out of its component (skipped if it can't beat one already found).
+        pool.ForRanges(n, [this](size_t, size_t begin, size_t end) {
+          for (size_t pos = begin; pos < end; ++pos) {
+            const size_t i = tree.GetSortedId(pos);
+            const size_t comp = point_component[i];
+            if (core_sq[i] > component_bound[comp].load(std::memory_order_relaxed)) continue;
+            SearchOther(0, tree.GetRow(pos), core_sq[i], comp, best_sq[i], best_to[i]);
+            if (best_to[i] != NONE) AtomicMin(component_bound[comp], best_sq[i]);
+          }
+        });
+
+        // Each component adds its cheapest edge (an edge picked from both sides is added once).
+        for (size_t i = 0; i < n; ++i) {
+          if (best_to[i] == NONE) continue;
+          size_t & pick = component_pick[point_component[i]];
+          if (pick == NONE || HDBSCANEdge{i, best_to[i], best_sq[i]} < HDBSCANEdge{pick, best_to[pick], best_sq[pick]}) {
+            pick = i;
+          }
+        }
+        const size_t before = num_components;
+        for (size_t i = 0; i < n; ++i) {
+          if (point_component[i] != i || component_pick[i] == NONE) continue;
+          const size_t from = component_pick[i];
+          if (components.Union(from, best_to[from])) {
+            mst.push_back({ from, best_to[from], best_sq[from] });
+            --num_components;
+          }
+        }
+        if (num_components == before) break;   // Can't happen (the graph is complete); just in case.
+      }
+      std::sort(mst.begin(), mst.end());
+      return rounds;
+    }
+
+    /// Condense the single-linkage hierarchy of the sorted MST, then pick clusters by excess of
+    /// mass; fills labels. Returns the number of clusters.
+    size_t ExtractClusters() {
+      const size_t n = tree.GetSize();
+      const size_t min_size = std::max<size_t>(min_cluster_size ? min_cluster_size : min_pts, 2);
+      labels.assign(n, NOISE_CLUSTER);
+      point_lambda.assign(n, 0.0);
+      cluster_stability.assign(1, 0.0);
+      if (n < 2 || mst.size() + 1 != n) return 0;   // Nothing to split.
+
+      // Single-linkage dendrogram: node n + k is the k-th merge (nodes below n are points).
+      const size_t num_merges = n - 1;
+      emp::vector<size_t> merge_left(num_merges), merge_right(num_merges), merge_size(num_merges);
+      emp::vector<size_t> root_node(n);
+      for (size_t i = 0; i < n; ++i) root_node[i] = i;
+      const auto size_of = [n, &merge_size](size_t node) { return node < n ? 1 : merge_size[node - n]; };
+      components.Reset(n);
+      for (size_t k = 0; k < num_merges; ++k) {
+        const size_t a = components.Find(mst[k].a), b = components.Find(mst[k].b);
+        merge_left[k] = root_node[a];
+        merge_right[k] = root_node[b];
+        merge_size[k] = size_of(merge_left[k]) + size_of(merge_right[k]);
+        components.Union(a, b);
+        root_node[components.Find(a)] = n + k;
+      }
+
+      // Condense top-down. Cluster 0 is the root; children are always numbered after parents.
+      emp::vector<size_t> cluster_parent = { NONE }, cluster_size = { n }, point_cluster(n, 0);
+      emp::vector<double> cluster_birth(1, 0.0);
+      emp::vector<size_t> leaves;
+      const auto fall_out = [&](size_t node, size_t cluster, double lambda) {
+        leaves.assign(1, node);
+        while (!leaves.empty()) {
+          const size_t cur = leaves.back();
+          leaves.pop_back();
+          if (cur < n) { point_cluster[cur] = cluster; point_lambda[cur] = lambda; continue; }
+          leaves.push_back(merge_left[cur - n]);
+          leaves.push_back(merge_right[cur - n]);
+        }
+      };
+      emp::vector<std::pair<size_t, size_t>> stack(1, { n + num_merges - 1, 0 });   // (node, cluster)
+      while (!stack.empty()) {
+        const size_t node = stack.back().first, cluster = stack.back().second;
+        stack.pop_back();
+        const size_t k = node - n, left = merge_left[k], right = merge_right[k];
+        const double lambda = Lambda(mst[k].weight_sq);
+        const bool big_left = size_of(left) >= min_size, big_right = size_of(right) >= min_size;
+        if (big_left && big_right) {
+          for (size_t child : { left, right }) {
+            stack.push_back({ child, cluster_parent.size() });
+            cluster_parent.push_back(cluster);
+            cluster_size.push_back(size_of(child));
+            cluster_birth.push_back(lambda);
+          }
+        } else {
+          if (big_left) stack.push_back({ left, cluster });
+          else fall_out(left, cluster, lambda);
+          if (big_right) stack.push_back({ right, cluster });
+          else fall_out(right, cluster, lambda);
+        }
+      }
+
+      // Stability: lambda each point (or child cluster) lasted past the cluster's birth.
+      const size_t num_condensed = cluster_parent.size();
+      cluster_stability.assign(num_condensed, 0.0);
+      for (size_t i = 0; i < n; ++i) {
+        cluster_stability[point_cluster[i]] += point_lambda[i] - cluster_birth[point_cluster[i]];
+      }
+      for (size_t c = 1; c < num_condensed; ++c) {
+        const size_t parent = cluster_parent[c];
+        cluster_stability[parent] += (double) cluster_size[c] * (cluster_birth[c] - cluster_birth[parent]);
+      }
+
+      // Excess of mass, bottom-up: keep a cluster unless its descendants are more stable together.
+      // (The root is never kept: a single all-encompassing cluster isn't a clustering.)
+      emp::vector<double> best_below(num_condensed, 0.0);
+      emp::vector<uint8_t> has_children(num_condensed, 0), selected(num_condensed, 0);
+      for (size_t c = num_condensed; c-- > 1; ) {
+        double value = cluster_stability[c];
+        if (!has_children[c] || best_below[c] <= value) selected[c] = 1;
+        else value = best_below[c];
+        best_below[cluster_parent[c]] += value;
+        has_children[cluster_parent[c]] = 1;
+      }
+      // Top-down: a point belongs to the kept cluster at or above where it fell out, if any.
+      emp::vector<size_t> kept(num_condensed, NOISE_CLUSTER);
+      for (size_t c = 1; c < num_condensed; ++c) {
+        kept[c] = (kept[cluster_parent[c]] != NOISE_CLUSTER) ? kept[cluster_parent[c]] : (selected[c] ? c : NOISE_CLUSTER);
+      }
+      emp::vector<size_t> cluster_ids(num_condensed, NOISE_CLUSTER);
+      size_t num_clusters = 0;
+      for (size_t i = 0; i < n; ++i) {
+        const size_t c = kept[point_cluster[i]];
+        if (c == NOISE_CLUSTER) continue;
+        if (cluster_ids[c] == NOISE_CLUSTER) cluster_ids[c] = num_clusters++;
+        labels[i] = cluster_ids[c];
+      }
+      return num_clusters;
+    }
+
+  public:
+    HDBSCAN(size_t _min_pts = 5, size_t _min_cluster_size = 0)
+      : min_pts(_min_pts), min_cluster_size(_min_cluster_size), tree(), core_sq(), mst(), labels(),
+        point_lambda(), cluster_stability(), thread_heaps(), components(), point_component(), node_component(),
+        node_min_core(), component_bound(), best_sq(), best_to(), component_pick(), pool(1) { ; }
+
+    size_t GetMinPts() const { return min_pts; }
+    size_t GetMinClusterSize() const { return min_cluster_size ? min_cluster_size : min_pts; }
+    size_t GetNumThreads() const { return pool.GetNumThreads(); }
+    const emp::vector<size_t> & GetLabels() const { return labels; }
+    size_t GetLabel(size_t i) const { return labels[i]; }
+    /// Core distance of point i (distance to its minPts-th nearest point, itself included).
+    double GetCoreDistance(size_t i) const { return std::sqrt(core_sq[i]); }
+    /// Mutual-reachability minimum spanning tree, sorted by weight.
+    const emp::vector<HDBSCANEdge> & GetSpanningTree() const { return mst; }
+    /// lambda (1 / distance) at which point i left its cluster in the condensed tree.
+    double GetPointLambda(size_t i) const { return point_lambda[i]; }
+    /// Stabilities of the condensed-tree clusters (index 0 is the root).
+    const emp::vector<double> & GetStabilities() const { return cluster_stability; }
+
+    void SetMinPts(size_t _min_pts) { min_pts = _min_pts; }
+    /// Smallest group a split must leave on both sides to make new clusters (0 = same as minPts).
+    void SetMinClusterSize(size_t _min_cluster_size) { min_cluster_size = _min_cluster_size; }
+    /// How many threads should the engine use? (0 = one per hardware thread.)
+    void SetNumThreads(size_t num_threads) { pool.SetNumThreads(num_threads); }
+
+    /// Cluster the points (any dimension).
+    HDBSCANResult Run(const PointSet & points) {
+      const size_t n = points.GetSize();
+      tree.Build(points);
+      core_sq.assign(n, 0.0);
+      thread_heaps.resize(pool.GetNumThreads());
+
+      // Core distances (min_pts <= 1 leaves them all 0: plain single linkage).
+      const size_t k = std::min(min_pts, n);
+      if (k > 1) {
+        pool.ForRanges(n, [this, k](size_t t, size_t begin, size_t end) {
+          for (size_t pos = begin; pos < end; ++pos) {
+            const size_t i = tree.GetSortedId(pos);
+            core_sq[i] = tree.KthNearestSq(i, k, thread_heaps[t]);
+          }
+        });
+      }
+      node_min_core.resize(tree.GetNumNodes());
+      for (size_t node = tree.GetNumNodes(); node-- > 0; ) {
+        const PointKdTree::Node & cur = tree.GetNode(node);
+        if (cur.IsLeaf()) {
+          double lowest = std::numeric_limits<double>::infinity();
+          for (size_t pos = cur.begin; pos < cur.end; ++pos) lowest = std::min(lowest, core_sq[tree.GetSortedId(pos)]);
+          node_min_core[node] = lowest;
+        } else {
+          node_min_core[node] = std::min(node_min_core[cur.left], node_min_core[cur.right]);
+        }
+      }
+
+      HDBSCANResult result{0, 0, 0};
+      result.num_rounds = BuildSpanningTree();
+      result.num_clusters = ExtractClusters();
+      for (size_t label : labels) result.num_noise += (label == NOISE_CLUSTER);
+      return result;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,361 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Incremental DBSCAN (in the spirit of Ester et al., 1998): points are inserted and removed one
+//  at a time, and each edit only touches the epsilon-neighborhoods it can affect, so its cost
+//  follows the local density rather than the number of points.
+//
+//  Roles and clusters always equal what DBSCAN::Run() would give on the live points (same
+//  epsilon test, edge points on their nearest core neighbor, ties to the lower id); only the
+//  cluster ids differ. They are stable across edits instead of renumbered, so a cluster keeps its
+//  id (and its color in the demo) while it grows.
+//  - Insert: the new point and its neighbors gain a neighbor; those reaching minPts become core
+//    and join (union-find over cluster ids) every cluster with a core within epsilon.
+//  - Remove: neighbors lose one; cores dropping below minPts are demoted. A cluster that lost
+//    cores may have split, so searches run from its remaining cores around the lost ones,
+//    interleaved, and stop as soon as all but one have met or run out. Each one that ran out is a
+//    split-off part and gets a new id, so the cost is about the size of the smaller parts, not of
+//    the cluster.
+//  - Non-core points near any change then re-pick their nearest core.
+//  Points live in a hash grid of epsilon-wide cells, so a query is the 3x3 cells around a point.
+//  Ids are handed out in insertion order and never reused; removed points just stop counting.
+
+#ifndef CLUSTERING_INCREMENTAL_DBSCAN_H
+#define CLUSTERING_INCREMENTAL_DBSCAN_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+#include "base/vector.h"
+
+#include "DBSCAN.h"
+#include "DisjointSet.h"
+
+namespace clustering {
+
+  class IncrementalDBSCAN {
+  protected:
+    static constexpr double CELL_MARGIN = 1e-9;   //< Relative: rounding can't push a neighbor out of reach.
+
+    /// A point's state when the current edit first touched it.
+    struct Saved { size_t id; DensityRole role; size_t label; };
+
+    double epsilon;                      //< Neighborhood radius (exclusive).
+    size_t min_pts;                      //< Neighbors (self included) needed to be a core point.
+    double max_dist_sq;                  //< SquaredRadiusBelow(epsilon).
+    double cell_size;
+    emp::vector<double> xs;              //< Coordinates of every point ever inserted.
+    emp::vector<double> ys;
+    emp::vector<uint8_t> alive;          //< Not removed yet?
+    emp::vector<size_t> neighbor_counts; //< Live points within epsilon (self included).
+    emp::vector<DensityRole> roles;      //< NONE once removed.
+    emp::vector<size_t> point_clusters;  //< Cluster id (resolve with clusters.Find()); NOISE_CLUSTER for noise.
+    DisjointSet clusters;                //< Cluster ids, merged as clusters join.
+    size_t num_clusters;
+    std::unordered_map<uint64_t, emp::vector<size_t>> cells;   //< Live points per cell.
+    size_t neighbor_queries;             //< Neighborhood queries issued by the last edit.
+    emp::vector<size_t> changed;         //< Points whose role or label the last edit changed.
+    emp::vector<std::pair<size_t, size_t>> merges;   //< (absorbed id, surviving id) in the last edit.
+    emp::vector<Saved> saved;            //< Scratch: first-touch states in this edit.
+    emp::vector<size_t> touch_marks;     //< Scratch: edit that last touched each point.
+    emp::vector<size_t> refresh_marks;   //< Scratch: edit that last re-attached each non-core point.
+    emp::vector<size_t> visit_marks;     //< Scratch: split search that last visited each point.
+    emp::vector<size_t> visit_search;    //< Scratch: which of the interleaved searches that was.
+    size_t edit_count;
+    size_t search_count;
+    emp::vector<size_t> hood;            //< Scratch: one neighborhood.
+    emp::vector<size_t> lost_cores;      //< Scratch: cores a removal took away.
+    emp::vector<size_t> moved_cores;     //< Scratch: cores given a new id by a split.
+
+    int64_t CellCoord(double v) const { return (int64_t) std::floor(v / cell_size); }
+    /// Cells far apart may share a key; that only costs a few extra distance checks.
+    static uint64_t CellKey(int64_t cx, int64_t cy) {
+      return ((uint64_t) (uint32_t) cx << 32) | (uint64_t) (uint32_t) cy;
+    }
+
+    /// Call fun(j) for every live point j within epsilon of (x, y).
+    template <typename FUN_T>
+    void VisitNeighbors(double x, double y, FUN_T && fun) {
+      ++neighbor_queries;
+      const int64_t cx = CellCoord(x), cy = CellCoord(y);
+      for (int64_t dx = -1; dx <= 1; ++dx) {
+        for (int64_t dy = -1; dy <= 1; ++dy) {
+          const auto it = cells.find(CellKey(cx + dx, cy + dy));
+          if (it == cells.end()) continue;
+          for (size_t j : it->second) {
+            const double ddx = xs[j] - x, ddy = ys[j] - y;
+            if (ddx * ddx + ddy * ddy <= max_dist_sq) fun(j);
+          }
+        }
+      }
+    }
+
+    /// Cluster of point i as callers see it.
+    size_t Label(size_t i) {
+      return (roles[i] == DensityRole::CORE || roles[i] == DensityRole::EDGE) ? clusters.Find(point_clusters[i])
+                                                                               : NOISE_CLUSTER;
+    }
+
+    void BeginEdit() {
+      ++edit_count;
+      neighbor_queries = 0;
+      saved.clear();
+      merges.clear();
+    }
+
+    /// Change point i's state, remembering what it was before this edit.
+    void SetState(size_t i, DensityRole role, size_t cluster) {
+      if (touch_marks[i] != edit_count) {
+        touch_marks[i] = edit_count;
+        saved.push_back({ i, roles[i], Label(i) });
+      }
+      roles[i] = role;
+      point_clusters[i] = cluster;
+    }
+
+    /// Collect the points whose state really differs from before the edit.
+    void EndEdit() {
+      changed.clear();
+      for (const Saved & s : saved) {
+        if (s.role != roles[s.id] || s.label != Label(s.id)) changed.push_back(s.id);
+      }
+    }
+
+    /// Point c just became core: join it to every cluster with a core within epsilon (or start one).
+    void Promote(size_t c) {
+      size_t target = NOISE_CLUSTER;
+      VisitNeighbors(xs[c], ys[c], [this, c, &target](size_t q) {
+        if (q == c || roles[q] != DensityRole::CORE) return;
+        const size_t root = clusters.Find(point_clusters[q]);
+        if (target == NOISE_CLUSTER) { target = root; return; }
+        if (root == target) return;
+        const size_t kept = clusters.Union(target, root);
+        merges.emplace_back(kept == target ? root : target, kept);
+        target = kept;
+        --num_clusters;
+      });
+      if (target == NOISE_CLUSTER) { target = clusters.AddSet(); ++num_clusters; }
+      SetState(c, DensityRole::CORE, target);
+    }
+
+    /// Re-attach every non-core point within epsilon of (x, y) to its nearest core (or make it noise).
+    void RefreshBorders(double x, double y) {
+      hood.clear();
+      VisitNeighbors(x, y, [this](size_t j) {
+        if (roles[j] != DensityRole::CORE && refresh_marks[j] != edit_count) hood.push_back(j);
+      });
+      for (size_t j : hood) {
+        refresh_marks[j] = edit_count;
+        size_t best = NOISE_CLUSTER;
+        double best_sq = 0.0;
+        VisitNeighbors(xs[j], ys[j], [this, j, &best, &best_sq](size_t q) {
+          if (roles[q] != DensityRole::CORE) return;
+          const double dx = xs[q] - xs[j], dy = ys[q] - ys[j];
+          const double dist_sq = dx * dx + dy * dy;
+          if (best == NOISE_CLUSTER || dist_sq < best_sq || (dist_sq == best_sq && q < best)) {
+            best = q;
+            best_sq = dist_sq;
+          }
+        });
+        if (best == NOISE_CLUSTER) SetState(j, DensityRole::NOISE, NOISE_CLUSTER);
+        else SetState(j, DensityRole::EDGE, clusters.Find(point_clusters[best]));
+      }
+    }
+
+    /// A cluster lost the cores in lost_cores; seeds are its remaining cores next to them. Search
+    /// from every seed at once, a point per search per round; searches that meet are merged, and
+    /// once at most one group is still growing, every finished group is a separate cluster.
+    void SplitCluster(const emp::vector<size_t> & seeds) {
+      const size_t k = seeds.size();
+      if (k < 2) return;
+      ++search_count;
+      emp::vector<emp::vector<size_t>> queues(k);   // Everything each search visited, in order.
+      emp::vector<size_t> heads(k, 0);
+      emp::vector<size_t> groups(k);                 // Union-find over searches.
+      emp::vector<size_t> growing(k, 1);             // Searches with work left, per group root.
+      size_t unfinished = k;
+      const auto find = [&groups](size_t s) {
+        while (groups[s] != s) s = groups[s] = groups[groups[s]];
+        return s;
+      };
+      for (size_t s = 0; s < k; ++s) {
+        groups[s] = s;
+        queues[s].push_back(seeds[s]);
+        visit_marks[seeds[s]] = search_count;
+        visit_search[seeds[s]] = s;
+      }
+
+      while (unfinished > 1) {
+        for (size_t s = 0; s < k && unfinished > 1; ++s) {
+          if (heads[s] == queues[s].size()) continue;
+          const size_t p = queues[s][heads[s]++];
+          VisitNeighbors(xs[p], ys[p], [&](size_t q) {
+            if (roles[q] != DensityRole::CORE) return;
+            if (visit_marks[q] != search_count) {
+              visit_marks[q] = search_count;
+              visit_search[q] = s;
+              queues[s].push_back(q);
+              return;
+            }
+            size_t a = find(s), b = find(visit_search[q]);
+            if (a == b) return;
+            if (b < a) std::swap(a, b);
+            groups[b] = a;
+            growing[a] += growing[b];
+            --unfinished;
+          });
+          if (heads[s] == queues[s].size() && --growing[find(s)] == 0) --unfinished;
+        }
+      }
+
+      // The group still growing keeps the old id (if all finished, the biggest does); every other
+      // group splits off with a new one.
+      emp::vector<size_t> group_sizes(k, 0);
+      for (size_t s = 0; s < k; ++s) group_sizes[find(s)] += queues[s].size();
+      size_t keeper = find(0);
+      for (size_t s = 0; s < k; ++s) {
+        const size_t g = find(s);
+        if (growing[g] > 0) { keeper = g; break; }
+        if (group_sizes[g] > group_sizes[keeper]) keeper = g;
+      }
+      emp::vector<size_t> new_ids(k, NOISE_CLUSTER);
+      for (size_t s = 0; s < k; ++s) {
+        const size_t g = find(s);
+        if (g == keeper) continue;
+        if (new_ids[g] == NOISE_CLUSTER) { new_ids[g] = clusters.AddSet(); ++num_clusters; }
+        for (size_t p : queues[s]) {
+          SetState(p, DensityRole::CORE, new_ids[g]);
+          moved_cores.push_back(p);
+        }
+      }
+    }
+
+  public:
+    IncrementalDBSCAN(double _epsilon = 1.0, size_t _min_pts = 5)
+      : epsilon(0.0), min_pts(0), max_dist_sq(-1.0), cell_size(1.0), xs(), ys(), alive(), neighbor_counts(),
+        roles(), point_clusters(), clusters(), num_clusters(0), cells(), neighbor_queries(0), changed(),
+        merges(), saved(), touch_marks(), refresh_marks(), visit_marks(), visit_search(), edit_count(0),
+        search_count(0), hood(), lost_cores(), moved_cores() { Reset(_epsilon, _min_pts); }
+
+    double GetEpsilon() const { return epsilon; }
+    size_t GetMinPts() const { return min_pts; }
+    /// Ids handed out so far (removed points included).
+    size_t GetSize() const { return xs.size(); }
+    size_t GetNumClusters() const { return num_clusters; }
+    bool IsAlive(size_t i) const { return alive[i]; }
+    DensityRole GetRole(size_t i) const { return roles[i]; }
+    /// Cluster id of point i (NOISE_CLUSTER for noise and removed points). Ids are stable, not dense.
+    size_t GetLabel(size_t i) { return Label(i); }
+    size_t GetNeighborQueries() const { return neighbor_queries; }
+    /// Points whose role or label the last edit changed (the edited point included). Points that
+    /// only changed because their whole cluster merged into another are listed in GetMerges().
+    const emp::vector<size_t> & GetChanged() const { return changed; }
+    const emp::vector<std::pair<size_t, size_t>> & GetMerges() const { return merges; }
+
+    /// Forget all points and start over with these parameters.
+    void Reset(double _epsilon, size_t _min_pts) {
+      epsilon = _epsilon;
+      min_pts = _min_pts;
+      max_dist_sq = SquaredRadiusBelow(epsilon);
+      cell_size = (epsilon > 0.0) ? epsilon * (1.0 + CELL_MARGIN) : 1.0;
+      xs.clear(); ys.clear(); alive.clear(); neighbor_counts.clear(); roles.clear(); point_clusters.clear();
+      touch_marks.clear(); refresh_marks.clear(); visit_marks.clear(); visit_search.clear();
+      clusters.Clear();
+      num_clusters = 0;
+      cells.clear();
+      changed.clear();
+      merges.clear();
+      neighbor_queries = 0;
+    }
+
+    /// Add a point; returns its id.
+    size_t Insert(double x, double y) {
+      BeginEdit();
+      const size_t id = xs.size();
+      xs.push_back(x);
+      ys.push_back(y);
+      alive.push_back(1);
+      neighbor_counts.push_back(0);
+      roles.push_back(DensityRole::NONE);
+      point_clusters.push_back(NOISE_CLUSTER);
+      touch_marks.push_back(0);
+      refresh_marks.push_back(0);
+      visit_marks.push_back(0);
+      visit_search.push_back(0);
+      cells[CellKey(CellCoord(x), CellCoord(y))].push_back(id);
+      SetState(id, DensityRole::NOISE, NOISE_CLUSTER);
+
+      // Everyone nearby gains a neighbor; promote those that reach min_pts.
+      hood.clear();
+      VisitNeighbors(x, y, [this](size_t j) { hood.push_back(j); });
+      emp::vector<size_t> promoted;
+      neighbor_counts[id] = hood.size();
+      if (neighbor_counts[id] >= min_pts) promoted.push_back(id);
+      for (size_t j : hood) {
+        if (j == id) continue;
+        if (++neighbor_counts[j] >= min_pts && roles[j] != DensityRole::CORE) promoted.push_back(j);
+      }
+      for (size_t c : promoted) Promote(c);
+
+      RefreshBorders(x, y);
+      for (size_t c : promoted) RefreshBorders(xs[c], ys[c]);
+      EndEdit();
+      return id;
+    }
+
+    /// Remove point id; false if it was already removed (or never existed).
+    bool Remove(size_t id) {
+      if (id >= xs.size() || !alive[id]) return false;
+      BeginEdit();
+      const auto cell = cells.find(CellKey(CellCoord(xs[id]), CellCoord(ys[id])));
+      *std::find(cell->second.begin(), cell->second.end(), id) = cell->second.back();
+      cell->second.pop_back();
+      if (cell->second.empty()) cells.erase(cell);
+      alive[id] = 0;
+
+      // Everyone nearby loses a neighbor; cores below min_pts are demoted (borders are redone below).
+      lost_cores.clear();
+      moved_cores.clear();
+      emp::vector<size_t> lost_roots;
+      if (roles[id] == DensityRole::CORE) { lost_cores.push_back(id); lost_roots.push_back(Label(id)); }
+      SetState(id, DensityRole::NONE, NOISE_CLUSTER);
+      hood.clear();
+      VisitNeighbors(xs[id], ys[id], [this](size_t j) { hood.push_back(j); });
+      for (size_t j : hood) {
+        if (--neighbor_counts[j] >= min_pts || roles[j] != DensityRole::CORE) continue;
+        lost_cores.push_back(j);
+        lost_roots.push_back(Label(j));
+        SetState(j, DensityRole::NOISE, NOISE_CLUSTER);
+      }
+
+      // Each cluster that lost cores either vanished (no cores left next to the lost ones), stayed
+      // whole, or split.
+      std::sort(lost_roots.begin(), lost_roots.end());
+      lost_roots.erase(std::unique(lost_roots.begin(), lost_roots.end()), lost_roots.end());
+      for (size_t root : lost_roots) {
+        emp::vector<size_t> seeds;
+        for (size_t l : lost_cores) {
+          VisitNeighbors(xs[l], ys[l], [this, root, &seeds](size_t q) {
+            if (roles[q] == DensityRole::CORE && clusters.Find(point_clusters[q]) == root) seeds.push_back(q);
+          });
+        }
+        std::sort(seeds.begin(), seeds.end());
+        seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+        if (seeds.empty()) --num_clusters;
+        else SplitCluster(seeds);
+      }
+
+      for (size_t l : lost_cores) RefreshBorders(xs[l], ys[l]);
+      for (size_t c : moved_cores) RefreshBorders(xs[c], ys[c]);
+      EndEdit();
+      return true;
+    }
+  };
+
+}
+
+#endif
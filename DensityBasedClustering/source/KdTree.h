@@ -0,0 +1,169 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Static kd-tree over a PointSet (any dimension), for nearest-neighbor style searches whose
+//  pruning rules live with the caller (HDBSCAN's Boruvka pass). Each node splits its points at the
+//  median of its widest dimension, down to leaves of at most leaf_size points. Nodes are stored in
+//  pre-order (children always come after their parent, the root is node 0), with bounding boxes;
+//  points are permuted into tree order with their coordinates copied row by row, so a leaf is one
+//  contiguous scan.
+
+#ifndef CLUSTERING_KD_TREE_H
+#define CLUSTERING_KD_TREE_H
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "base/vector.h"
+
+#include "../../KMeansClusteringExample/source/PointSet.h"
+
+namespace clustering {
+
+  class PointKdTree {
+  public:
+    struct Node {
+      size_t begin;   //< Points (tree positions) [begin, end).
+      size_t end;
+      size_t left;    //< Child nodes; 0 for leaves (the root is never a child).
+      size_t right;
+      bool IsLeaf() const { return left == 0; }
+    };
+
+  protected:
+    size_t dims;
+    size_t leaf_size;
+    emp::vector<Node> nodes;
+    emp::vector<double> box_lo;        //< dims per node: bounding box corners.
+    emp::vector<double> box_hi;
+    emp::vector<size_t> order;         //< Point ids in tree order.
+    emp::vector<double> rows;          //< Coordinates in tree order, dims per point.
+    emp::vector<size_t> point_pos;     //< Tree position of each point.
+
+    /// Make the node for points order[begin, end), then its subtree; returns its index.
+    size_t BuildNode(const PointSet & points, size_t begin, size_t end) {
+      const size_t id = nodes.size();
+      nodes.push_back({ begin, end, 0, 0 });
+      box_lo.resize(box_lo.size() + dims);
+      box_hi.resize(box_hi.size() + dims);
+      size_t split_dim = 0;
+      double widest = -1.0;
+      for (size_t d = 0; d < dims; ++d) {
+        const double * column = points.GetColumn(d);
+        double lo = column[order[begin]], hi = lo;
+        for (size_t pos = begin + 1; pos < end; ++pos) {
+          lo = std::min(lo, column[order[pos]]);
+          hi = std::max(hi, column[order[pos]]);
+        }
+        box_lo[id * dims + d] = lo;
+        box_hi[id * dims + d] = hi;
+        if (hi - lo > widest) { widest = hi - lo; split_dim = d; }
+      }
+      if (end - begin <= leaf_size || widest <= 0.0) return id;
+
+      const size_t mid = begin + (end - begin) / 2;
+      const double * column = points.GetColumn(split_dim);
+      std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                       [column](size_t a, size_t b) { return column[a] < column[b]; });
+      const size_t left = BuildNode(points, begin, mid);
+      const size_t right = BuildNode(points, mid, end);
+      nodes[id].left = left;
+      nodes[id].right = right;
+      return id;
+    }
+
+    /// Keep the k smallest squared distances from x seen so far in heap (a max-heap).
+    void KthNearest(size_t node, const double * x, size_t k, emp::vector<double> & heap) const {
+      const Node & cur = nodes[node];
+      if (cur.IsLeaf()) {
+        for (size_t pos = cur.begin; pos < cur.end; ++pos) {
+          const double dist_sq = DistSq(pos, x);
+          if (heap.size() < k) {
+            heap.push_back(dist_sq);
+            std::push_heap(heap.begin(), heap.end());
+          } else if (dist_sq < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = dist_sq;
+            std::push_heap(heap.begin(), heap.end());
+          }
+        }
+        return;
+      }
+      double near_dist = BoxDistSq(cur.left, x), far_dist = BoxDistSq(cur.right, x);
+      size_t near = cur.left, far = cur.right;
+      if (far_dist < near_dist) { std::swap(near, far); std::swap(near_dist, far_dist); }
+      if (heap.size() < k || near_dist < heap.front()) KthNearest(near, x, k, heap);
+      if (heap.size() < k || far_dist < heap.front()) KthNearest(far, x, k, heap);
+    }
+
+  public:
+    PointKdTree() : dims(0), leaf_size(16), nodes(), box_lo(), box_hi(), order(), rows(), point_pos() { ; }
+
+    size_t GetSize() const { return order.size(); }
+    size_t GetDims() const { return dims; }
+    size_t GetNumNodes() const { return nodes.size(); }
+    const Node & GetNode(size_t node) const { return nodes[node]; }
+    /// Id of the point at tree position pos (walking positions keeps nearby points together).
+    size_t GetSortedId(size_t pos) const { return order[pos]; }
+    /// Tree position of point i.
+    size_t GetPosition(size_t i) const { return point_pos[i]; }
+    /// Coordinates of the point at tree position pos.
+    const double * GetRow(size_t pos) const { return rows.data() + pos * dims; }
+
+    /// Index points, with at most _leaf_size points per leaf.
+    void Build(const PointSet & points, size_t _leaf_size = 16) {
+      const size_t n = points.GetSize();
+      dims = points.GetDims();
+      leaf_size = std::max<size_t>(_leaf_size, 1);
+      nodes.clear();
+      box_lo.clear();
+      box_hi.clear();
+      order.resize(n);
+      for (size_t i = 0; i < n; ++i) order[i] = i;
+      if (n) BuildNode(points, 0, n);
+      rows.resize(n * dims);
+      point_pos.resize(n);
+      for (size_t pos = 0; pos < n; ++pos) {
+        point_pos[order[pos]] = pos;
+        for (size_t d = 0; d < dims; ++d) rows[pos * dims + d] = points.GetColumn(d)[order[pos]];
+      }
+    }
+
+    /// Squared distance from x to the nearest point of node's bounding box.
+    double BoxDistSq(size_t node, const double * x) const {
+      const double * lo = box_lo.data() + node * dims;
+      const double * hi = box_hi.data() + node * dims;
+      double dist_sq = 0.0;
+      for (size_t d = 0; d < dims; ++d) {
+        const double gap = std::max(lo[d] - x[d], 0.0) + std::max(x[d] - hi[d], 0.0);
+        dist_sq += gap * gap;
+      }
+      return dist_sq;
+    }
+
+    /// Squared distance from x to the point at tree position pos.
+    double DistSq(size_t pos, const double * x) const {
+      const double * row = GetRow(pos);
+      double dist_sq = 0.0;
+      for (size_t d = 0; d < dims; ++d) {
+        const double diff = row[d] - x[d];
+        dist_sq += diff * diff;
+      }
+      return dist_sq;
+    }
+
+    /// Squared distance from point i to its k-th nearest point, i itself included (so k = 1 gives
+    /// 0); infinite if there are fewer than k points. heap is scratch space.
+    double KthNearestSq(size_t i, size_t k, emp::vector<double> & heap) const {
+      if (k == 0 || k > order.size()) return std::numeric_limits<double>::infinity();
+      heap.clear();
+      KthNearest(0, GetRow(point_pos[i]), k, heap);
+      return heap.front();
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,212 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  OPTICS (Ankerst et al., 1999): one pass at a generating radius (max_epsilon) computes every
+//  point's core distance and a reachability ordering; after that, the DBSCAN clustering for any
+//  epsilon <= max_epsilon (same minPts) is an O(n) walk over the ordering (Extract()), so
+//  epsilon can be swept interactively.
+//
+//  Distances are kept squared and compared with SquaredRadiusBelow(epsilon), exactly as DBSCAN
+//  does, so an extraction agrees with DBSCAN::Run() at that epsilon on every point's role (core,
+//  edge or noise) and on the clusters of core points, numbered the same way (by smallest point id).
+//  An edge point within epsilon of several clusters may be attached to a different one of them:
+//  Extract() uses the core point with the smallest reachability to it (recorded during Run())
+//  rather than the nearest one, which would need a neighborhood query.
+//
+//  Neighborhoods come from a GridIndex at the generating radius. Core distances are computed in
+//  parallel (SetNumThreads()); the ordering itself is inherently sequential.
+
+#ifndef CLUSTERING_OPTICS_H
+#define CLUSTERING_OPTICS_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "base/vector.h"
+
+#include "../../KMeansClusteringExample/source/PointSet.h"
+#include "../../KMeansClusteringExample/source/ThreadPool.h"
+#include "DBSCAN.h"
+#include "GridIndex.h"
+
+namespace clustering {
+
+  /// Core/reachability distance of points that have none (squared or not).
+  constexpr double UNDEFINED_DISTANCE = std::numeric_limits<double>::infinity();
+
+  class OPTICS {
+  protected:
+    double max_epsilon;                 //< Generating radius (exclusive).
+    size_t min_pts;                     //< Neighbors (self included) needed to be a core point.
+    GridIndex index;                    //< Grid at the generating radius over the last points run.
+    emp::vector<size_t> ordering;       //< Point ids in reachability order.
+    emp::vector<double> core_sq;        //< Squared core distance of each point (UNDEFINED_DISTANCE if not core).
+    emp::vector<double> reach_sq;       //< Squared reachability distance of each point when ordered.
+    emp::vector<double> border_sq;      //< Smallest squared reachability of each point from any core point.
+    emp::vector<size_t> border_core;    //< The core point it is reached from (lowest id on ties).
+    emp::vector<uint8_t> processed;     //< Scratch: already placed in the ordering?
+    emp::vector<emp::vector<double>> thread_dists;  //< Scratch: per-thread neighbor distances.
+    emp::vector<size_t> thread_queries; //< Scratch: per-thread query counts.
+    size_t neighbor_queries;            //< Neighborhood queries issued by the last run.
+    emp::vector<DensityRole> roles;     //< Core/edge/noise for each point, from the last extraction.
+    emp::vector<size_t> labels;         //< Cluster of each point (NOISE_CLUSTER for noise), likewise.
+    emp::vector<size_t> cluster_ids;    //< Scratch: final id of each cluster in ordering order.
+    ThreadPool pool;                    //< Worker threads (just the caller by default).
+
+    using seed_t = std::pair<double, size_t>;   //< (squared reachability, point id)
+    using seed_queue_t = std::priority_queue<seed_t, emp::vector<seed_t>, std::greater<seed_t>>;
+
+    /// Add core point o's neighbors to the seeds (or lower their reachability), and offer o as
+    /// the core point each neighbor is reached from.
+    void Update(size_t o, double max_dist_sq, seed_queue_t & seeds) {
+      const double core = core_sq[o];
+      index.VisitNeighbors(o, max_dist_sq, [this, o, core, &seeds](size_t j, double dist_sq) {
+        const double reach = std::max(core, dist_sq);
+        if (reach < border_sq[j] || (reach == border_sq[j] && o < border_core[j])) {
+          border_sq[j] = reach;
+          border_core[j] = o;
+        }
+        if (!processed[j] && reach < reach_sq[j]) {
+          reach_sq[j] = reach;
+          seeds.emplace(reach, j);
+        }
+        return false;
+      });
+    }
+
+  public:
+    OPTICS(double _max_epsilon = 1.0, size_t _min_pts = 5)
+      : max_epsilon(_max_epsilon), min_pts(_min_pts), index(), ordering(), core_sq(), reach_sq(), border_sq(),
+        border_core(), processed(), thread_dists(), thread_queries(), neighbor_queries(0), roles(), labels(),
+        cluster_ids(), pool(1) { ; }
+
+    double GetMaxEpsilon() const { return max_epsilon; }
+    size_t GetMinPts() const { return min_pts; }
+    size_t GetNumThreads() const { return pool.GetNumThreads(); }
+    size_t GetSize() const { return ordering.size(); }
+    const emp::vector<size_t> & GetOrdering() const { return ordering; }
+    /// Core distance of point i (infinite if it has fewer than minPts neighbors within max_epsilon).
+    double GetCoreDistance(size_t i) const { return std::sqrt(core_sq[i]); }
+    /// Reachability distance of point i in the ordering (infinite where a new region starts).
+    double GetReachDistance(size_t i) const { return std::sqrt(reach_sq[i]); }
+    size_t GetNeighborQueries() const { return neighbor_queries; }
+    const emp::vector<DensityRole> & GetRoles() const { return roles; }
+    DensityRole GetRole(size_t i) const { return roles[i]; }
+    const emp::vector<size_t> & GetLabels() const { return labels; }
+    size_t GetLabel(size_t i) const { return labels[i]; }
+
+    void SetMaxEpsilon(double _max_epsilon) { max_epsilon = _max_epsilon; }
+    void SetMinPts(size_t _min_pts) { min_pts = _min_pts; }
+    /// How many threads should core distances use? (0 = one per hardware thread.)
+    void SetNumThreads(size_t num_threads) { pool.SetNumThreads(num_threads); }
+
+    /// Compute core distances and the reachability ordering of the points at max_epsilon.
+    void Run(const PointSet & points) {
+      const size_t n = points.GetSize();
+      const double max_dist_sq = SquaredRadiusBelow(max_epsilon);
+      index.Build(points, max_epsilon);
+      core_sq.assign(n, UNDEFINED_DISTANCE);
+      thread_dists.resize(pool.GetNumThreads());
+      thread_queries.assign(pool.GetNumThreads(), 0);
+
+      // Core distance: the min_pts-th smallest squared distance to a neighbor (self included).
+      pool.ForRanges(n, [this, max_dist_sq](size_t t, size_t begin, size_t end) {
+        emp::vector<double> & dists = thread_dists[t];
+        for (size_t pos = begin; pos < end; ++pos) {
+          const size_t i = index.GetSortedId(pos);
+          if (min_pts == 0) { core_sq[i] = -UNDEFINED_DISTANCE; continue; }   // Core at any epsilon.
+          dists.clear();
+          index.VisitNeighbors(i, max_dist_sq, [&dists](size_t, double dist_sq) {
+            dists.push_back(dist_sq);
+            return false;
+          });
+          if (dists.size() < min_pts) continue;
+          std::nth_element(dists.begin(), dists.begin() + (min_pts - 1), dists.end());
+          core_sq[i] = dists[min_pts - 1];
+        }
+        thread_queries[t] += end - begin;
+      });
+
+      // Ordering: repeatedly take the unprocessed point with the smallest reachability (lowest id
+      // on ties), starting a new region from the next point in grid order when the seeds run out.
+      ordering.clear();
+      ordering.reserve(n);
+      reach_sq.assign(n, UNDEFINED_DISTANCE);
+      border_sq.assign(n, UNDEFINED_DISTANCE);
+      border_core.assign(n, NOISE_CLUSTER);
+      processed.assign(n, 0);
+      neighbor_queries = 0;
+      seed_queue_t seeds;
+      for (size_t pos = 0; pos < n; ++pos) {
+        size_t i = index.GetSortedId(pos);
+        if (processed[i]) continue;
+        while (true) {
+          processed[i] = 1;
+          ordering.push_back(i);
+          if (core_sq[i] <= max_dist_sq) { Update(i, max_dist_sq, seeds); ++neighbor_queries; }
+          // Skip stale entries (points since processed, or reached more closely later).
+          while (!seeds.empty() && (processed[seeds.top().second] || seeds.top().first > reach_sq[seeds.top().second])) {
+            seeds.pop();
+          }
+          if (seeds.empty()) break;
+          i = seeds.top().second;
+          seeds.pop();
+        }
+      }
+      for (size_t queries : thread_queries) neighbor_queries += queries;
+      roles.assign(n, DensityRole::NONE);
+      labels.assign(n, NOISE_CLUSTER);
+    }
+
+    /// DBSCAN clustering at epsilon (capped at max_epsilon) from the last Run(), in O(n).
+    /// Roles and labels are then available through GetRole()/GetLabel().
+    DBSCANResult Extract(double epsilon) {
+      const size_t n = ordering.size();
+      const double max_dist_sq = SquaredRadiusBelow(std::min(epsilon, max_epsilon));
+      roles.assign(n, DensityRole::NONE);
+      labels.assign(n, NOISE_CLUSTER);
+
+      // Core points: a new cluster starts wherever reachability exceeds epsilon.
+      size_t num_regions = 0;
+      for (size_t i : ordering) {
+        if (!(core_sq[i] <= max_dist_sq)) continue;
+        if (!(reach_sq[i] <= max_dist_sq)) ++num_regions;
+        roles[i] = DensityRole::CORE;
+        labels[i] = num_regions - 1;
+      }
+
+      // Renumber the clusters in order of their smallest point, as DBSCAN does.
+      DBSCANResult result{0, 0, 0, 0};
+      cluster_ids.assign(num_regions, NOISE_CLUSTER);
+      for (size_t i = 0; i < n; ++i) {
+        if (roles[i] != DensityRole::CORE) continue;
+        size_t & id = cluster_ids[labels[i]];
+        if (id == NOISE_CLUSTER) id = result.num_clusters++;
+        labels[i] = id;
+        ++result.num_core;
+      }
+
+      // Everything else is an edge point if some core point reaches it within epsilon.
+      for (size_t i = 0; i < n; ++i) {
+        if (roles[i] == DensityRole::CORE) continue;
+        if (border_sq[i] <= max_dist_sq) {
+          roles[i] = DensityRole::EDGE;
+          labels[i] = labels[border_core[i]];
+          ++result.num_edge;
+        } else {
+          roles[i] = DensityRole::NOISE;
+          ++result.num_noise;
+        }
+      }
+      return result;
+    }
+  };
+
+}
+
+#endif
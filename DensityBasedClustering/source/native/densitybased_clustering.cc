@@ -1,8 +1,149 @@
 // This is the main function for the NATIVE version of this project.
+//
+// Usage: densitybased_clustering POINTS_FILE [options]
+//        densitybased_clustering --generate MODE [options]
+//   --eps E           neighborhood radius (exclusive; default: 1)
+//   --min-pts N       neighbors (self included) a core point needs (default: 5)
+//   --binary D        POINTS_FILE is packed float64 coordinates with D dimensions (default: CSV); D must be 2
+//   --f32             binary coordinates are float32 instead of float64
+//   --threads N       worker threads (default: 0 = one per hardware thread)
+//   --out FILE        write one cluster id per line to FILE (-1 for noise)
+//   --generate MODE   cluster a synthetic 2-D dataset instead of a file: blobs, rings or uniform
+//   --points N        with --generate: how many points (default: 100000)
+//   --blobs B         with --generate blobs/rings: how many blobs/rings (default: 8)
+//   --seed S          with --generate: random seed (default: 1)
+//   --save FILE       with --generate: also write the points to FILE as CSV
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <string>
 
-int main()
+#include "tools/Random.h"
+
+#include "../../../KMeansClusteringExample/source/PointSet.h"
+#include "../../../KMeansClusteringExample/source/PointIO.h"
+#include "../../../KMeansClusteringExample/source/PointGenerator.h"
+#include "../DBSCAN.h"
+
+void PrintUsage() {
+  std::cout << "Usage: densitybased_clustering POINTS_FILE [--eps E] [--min-pts N] [--binary 2] [--f32]"
+               " [--threads N] [--out FILE]" << std::endl;
+  std::cout << "       densitybased_clustering --generate blobs|rings|uniform [--points N] [--blobs B] [--seed S]"
+               " [--save FILE] [options]" << std::endl;
+}
+
+/// Peak resident memory of this process in kB (Linux only; 0 if unknown).
+size_t GetPeakMemoryKB() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) return std::stoul(line.substr(6));
+  }
+  return 0;
+}
+
+/// Build a synthetic 2-D dataset (see --generate). Returns false (and sets error) for unknown modes.
+bool GeneratePoints(const std::string & mode, size_t n, size_t num_blobs, emp::Random & random,
+                    clustering::PointSet & points, std::string & error) {
+  constexpr double EXTENT = 1000.0;
+  points.Reset(2);
+  if (mode == "blobs") clustering::GenerateBlobs(n, 2, num_blobs, EXTENT, EXTENT / (8.0 * (double) num_blobs), random, points);
+  else if (mode == "rings") clustering::GenerateRings(n, num_blobs, 0.5 * EXTENT, EXTENT / 200.0, random, points);
+  else if (mode == "uniform") clustering::GenerateUniform(n, 2, EXTENT, random, points);
+  else { error = "unknown generator '" + mode + "'"; return false; }
+  return true;
+}
+
+int main(int argc, char * argv[])
 {
-  std::cout << "Hello World!" << std::endl;
+  std::string in_path;
+  std::string out_path;
+  double epsilon = 1.0;
+  size_t min_pts = 5;
+  size_t binary_dims = 0;
+  bool is_float32 = false;
+  size_t num_threads = 0;
+  std::string generate_mode;
+  std::string save_path;
+  size_t num_points = 100000;
+  size_t num_blobs = 8;
+  int seed = 1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_val = i + 1 < argc;
+    if (arg == "--eps" && has_val) epsilon = std::stod(argv[++i]);
+    else if (arg == "--min-pts" && has_val) min_pts = std::stoul(argv[++i]);
+    else if (arg == "--binary" && has_val) binary_dims = std::stoul(argv[++i]);
+    else if (arg == "--f32") is_float32 = true;
+    else if (arg == "--threads" && has_val) num_threads = std::stoul(argv[++i]);
+    else if (arg == "--out" && has_val) out_path = argv[++i];
+    else if (arg == "--generate" && has_val) generate_mode = argv[++i];
+    else if (arg == "--points" && has_val) num_points = std::stoul(argv[++i]);
+    else if (arg == "--blobs" && has_val) num_blobs = std::stoul(argv[++i]);
+    else if (arg == "--seed" && has_val) seed = std::stoi(argv[++i]);
+    else if (arg == "--save" && has_val) save_path = argv[++i];
+    else if (arg == "-h" || arg == "--help") { PrintUsage(); return 0; }
+    else if (in_path.empty() && arg[0] != '-') in_path = arg;
+    else { std::cerr << "Unknown argument: " << arg << std::endl; PrintUsage(); return 1; }
+  }
+  if (in_path.empty() == generate_mode.empty()) { PrintUsage(); return 1; }
+
+  // Load (or generate) the points.
+  clustering::PointSet points;
+  std::string error;
+  auto load_start = std::chrono::steady_clock::now();
+  if (generate_mode.size()) {
+    emp::Random gen_random(seed);
+    if (!GeneratePoints(generate_mode, num_points, std::max<size_t>(num_blobs, 1), gen_random, points, error)) {
+      std::cerr << "Error: " << error << std::endl; PrintUsage(); return 1;
+    }
+    if (save_path.size()) {
+      std::ofstream save(save_path);
+      save.precision(17);
+      for (size_t i = 0; i < points.GetSize(); ++i) save << points.Get(i, 0) << "," << points.Get(i, 1) << '\n';
+    }
+  } else {
+    const bool loaded = binary_dims ? clustering::LoadBinary(in_path, binary_dims, is_float32, points, error)
+                                    : clustering::LoadCSV(in_path, points, error);
+    if (!loaded) { std::cerr << "Error: " << error << std::endl; return 1; }
+  }
+  auto load_end = std::chrono::steady_clock::now();
+  std::cout << (generate_mode.size() ? "Generated " : "Loaded ") << points.GetSize() << " " << points.GetDims()
+            << "-D points in " << std::chrono::duration<double>(load_end - load_start).count() << " s" << std::endl;
+  if (points.GetSize() && points.GetDims() != 2) {
+    std::cerr << "Error: DBSCAN needs 2-D points (got " << points.GetDims() << "-D)" << std::endl;
+    return 1;
+  }
+
+  clustering::DBSCAN dbscan(epsilon, min_pts);
+  dbscan.SetNumThreads(num_threads);
+  auto run_start = std::chrono::steady_clock::now();
+  const clustering::DBSCANResult result = dbscan.Run(points);
+  auto run_end = std::chrono::steady_clock::now();
+  const clustering::DBSCANStats & stats = dbscan.GetStats();
+  std::cout << "Epsilon: " << dbscan.GetEpsilon() << std::endl;
+  std::cout << "minPts: " << dbscan.GetMinPts() << std::endl;
+  std::cout << "Threads: " << dbscan.GetNumThreads() << std::endl;
+  std::cout << "Grid: " << dbscan.GetIndex().GetNumCells() << " cells (" << stats.index_seconds << " s)" << std::endl;
+  std::cout << "Core points: " << stats.core_queries << " queries (" << stats.core_seconds << " s)" << std::endl;
+  std::cout << "Linking: " << stats.link_queries << " queries (" << stats.link_seconds << " s)" << std::endl;
+  std::cout << "Edge points: " << stats.border_queries << " queries (" << stats.border_seconds << " s)" << std::endl;
+  std::cout << "Labeling: " << stats.label_seconds << " s" << std::endl;
+  std::cout << "Neighbor queries: " << dbscan.GetNeighborQueries() << std::endl;
+  std::cout << "Clusters: " << result.num_clusters << std::endl;
+  std::cout << "Core / edge / noise points: " << result.num_core << " / " << result.num_edge << " / "
+            << result.num_noise << std::endl;
+  std::cout << "Wall time: " << std::chrono::duration<double>(run_end - run_start).count() << " s" << std::endl;
+  if (const size_t peak_kb = GetPeakMemoryKB()) std::cout << "Peak resident memory: " << peak_kb / 1024.0 << " MB" << std::endl;
+
+  if (out_path.size()) {
+    std::ofstream out(out_path);
+    for (size_t i = 0; i < points.GetSize(); ++i) {
+      if (dbscan.GetLabel(i) == clustering::NOISE_CLUSTER) out << "-1\n";
+      else out << dbscan.GetLabel(i) << '\n';
+    }
+  }
+  return 0;
 }
@@ -16,11 +16,19 @@
 #include "web/JSWrap.h"
 #include "web/color_map.h"
 
+#include "../../../KMeansClusteringExample/source/PointSet.h"
+#include "../../../KMeansClusteringExample/source/PointGenerator.h"
+#include "../OPTICS.h"
+#include "../HDBSCAN.h"
+#include "../IncrementalDBSCAN.h"
+
 namespace UI = emp::web;
 
 // density clustering params
 constexpr size_t default_minPts = 5;
 constexpr double default_epsilon = 200.0;
+constexpr double max_epsilon = 500.0;   // Epsilon slider range (and the OPTICS generating radius).
+constexpr size_t max_minPts = 50;       // minPts slider range.
 
 // enums for density id
 constexpr size_t denid_none = 0;
@@ -28,7 +36,6 @@ constexpr size_t denid_core = 1;
 constexpr size_t denid_edge = 2;
 constexpr size_t denid_noise = 3;
 
-constexpr size_t MAX_RANDOMIZE_TRIES = 10000; //< How many times should we retry dropping random points to avoid point-collisions?
 constexpr size_t RANDOM_POINT_DROP_CNT = 10;
 /// WARNING: DensityBasedExample does not support having multiple instances on the same HTML page.
 /// WARNING: DensityBasedExample makes assumptions about the associated .html page. Not really meant to be
@@ -39,6 +46,7 @@ protected:
 UI::Document viewer;        //< Div that contains the canvas viewer.
 UI::Document data_dash;     //< Div that contains the data configuration dashboard.
 UI::Document cluster_dash;  //< Div that contains the cluster configuration dashboard.
+UI::Document param_dash;    //< Div that contains the (always live) density parameter sliders.
 UI::Animate anim;
 
 emp::Random random;   //< The RNGod.
@@ -58,16 +66,45 @@ double canvas_pos_y;  //< Internally-used variable to keep track of canvas y pos
 
 size_t cluster_iteration; //< What iteration of the clustering algorithm are we on?
 size_t num_bins;          //< How many K-means clustering bins should we have?
+size_t num_clusters;      //< How many clusters did the last DBSCAN run find?
 
 emp::vector<emp::Circle> points;    //< Vector to keep track of data points.
 emp::vector<size_t> cluster_ids;    //< Vector to keep track of which cluster each point belongs to.
 emp::vector<emp::Circle> centroids; //< Vector to keep track of cluster centroids.
+clustering::PointSet data;          //< Flat copy of point coordinates (what the clustering engine works on).
+clustering::OPTICS optics;          //< Reachability ordering: any epsilon up to max_epsilon in O(n).
+bool optics_stale;                  //< Have points or minPts changed since the ordering was computed?
+clustering::HDBSCAN hdbscan;        //< Hierarchical alternative: no epsilon, clusters of varying density.
+bool use_hdbscan;                   //< Cluster with HDBSCAN instead of (OPTICS-extracted) DBSCAN?
+clustering::IncrementalDBSCAN live; //< Follows clicks: each new point only updates its own neighborhood.
+bool labels_from_live;              //< Did the labels on screen come from the live engine (not OPTICS/HDBSCAN)?
 
 enum class Mode { CLUSTER, CONFIG } page_mode;  //< What mode is the page in?
 
 /// This function is wrapped in javascript. Used to update canvas position from javascript.
 void SetCanvasPositionInternal(double x, double y) { canvas_pos_x = x; canvas_pos_y = y; }
 
+/// Wrapped in javascript: the epsilon slider moved. Only re-extracts from the OPTICS ordering.
+void SetEpsilonInternal(double value) {
+  epsilon = value;
+  UpdateLive();
+}
+
+/// Wrapped in javascript: the minPts slider moved. Core distances change, so the ordering is redone.
+void SetMinPtsInternal(double value) {
+  minPts = (size_t) value;
+  optics_stale = true;
+  UpdateLive();
+}
+
+/// In cluster mode, parameter changes show up right away.
+void UpdateLive() {
+  if (page_mode != Mode::CLUSTER) return;
+  ClusterSingleStep();
+  Draw();
+  cluster_dash.Redraw();
+}
+
 /// Given a field name, field_id, and field value: generate the HTML for a numeric input field.
 /// WARNING: this function calls a function (see below) that is copy-pasta from some old, possibly
 ///          out-dated code. Shit still works and looks okay, though.
@@ -76,6 +113,24 @@ std::string GenerateParamNumberField(std::string field_name, std::string field_i
   return GenerateParamField(field_name, field_id, default_value, "Number");
 }
 
+/// Given a field name, field_id, value and range: generate the HTML for a slider whose label
+/// shows its current value.
+template<typename FieldType>
+std::string GenerateParamSlider(std::string field_name, std::string field_id, FieldType default_value,
+                                FieldType min_value, FieldType max_value) {
+  std::stringstream param_html;
+    param_html << "<div class=\"input-group\">";
+      param_html << "<span class=\"input-group-addon\" id=\"" << field_id << "-addon\">" << field_name << ": " << default_value << "</span>  ";
+      param_html << "<input type=\"range\""
+                 << " class=\"form-control\""
+                 << " aria-describedby=\"" << field_id << "-addon\""
+                 << " id=\"" << field_id << "-param\""
+                 << " min=\"" << min_value << "\" max=\"" << max_value << "\" step=\"1\""
+                 << " value=\"" << default_value << "\">";
+    param_html << "</div>";
+  return param_html.str();
+}
+
 /// Given a field name, field_id, field value, and input type: generate the HTML for an input field
 /// of the provided type.
 /// WARNING: Pulled this function out of some old code. No promises on whether or not it uses good
@@ -100,17 +155,23 @@ public:
     : viewer("emp_viewer"),
       data_dash("emp_data_dash"),
       cluster_dash("emp_cluster_dash"),
+      param_dash("emp_param_dash"),
       anim([this]() { this->Animate(anim); } ),
       random(),
       width(500), height(500),
       point_radius(10),
       cluster_iteration(0),
       num_bins(5),
-      points(), cluster_ids(), density_ids(), centroids(),
+      num_clusters(0),
+      points(), cluster_ids(), density_ids(), centroids(), data(2), optics(max_epsilon), optics_stale(true),
+      hdbscan(), use_hdbscan(false), live(default_epsilon, default_minPts),
+      labels_from_live(false),
       page_mode(Mode::CONFIG)
   {
     // Wrap some necessary functions for js<-->c++ comms.
     emp::JSWrap([this](double x, double y) { this->SetCanvasPositionInternal(x, y); }, "DensityBasedExample__SetCanvasPosition");
+    emp::JSWrap([this](double value) { this->SetEpsilonInternal(value); }, "DensityBasedExample__SetEpsilon");
+    emp::JSWrap([this](double value) { this->SetMinPtsInternal(value); }, "DensityBasedExample__SetMinPts");
 
     // -- Configure page. --
     // Add a canvas to the page, paint it black, and center.
@@ -123,17 +184,31 @@ public:
     data_dash << UI::Button([this]() { this->DoAddPoints(); }, "Drop Points", "drop_points_button");
     data_dash << UI::Button([this]() { this->DoClear(); }, "Clear", "clear_button");
     data_dash << UI::Button([this]() { this->DoToggleMode(); }, "Cluster Mode", "cluster_mode_button");
-    data_dash << GenerateParamNumberField("minPts", "minPts", minPts);
-    data_dash << GenerateParamNumberField("epsilon", "epsilon", epsilon);
+
+    // Build parameter dashboard. Sliders report every move (delegated handlers: the div may be redrawn).
+    param_dash << GenerateParamSlider("minPts", "minPts", minPts, (size_t) 1, max_minPts);
+    param_dash << GenerateParamSlider("epsilon", "epsilon", epsilon, 1.0, max_epsilon);
+    EM_ASM({
+      $(document).on("input", "#minPts-param", function() {
+        $("#minPts-addon").text("minPts: " + this.value);
+        emp.DensityBasedExample__SetMinPts(parseFloat(this.value));
+      });
+      $(document).on("input", "#epsilon-param", function() {
+        $("#epsilon-addon").text("epsilon: " + this.value);
+        emp.DensityBasedExample__SetEpsilon(parseFloat(this.value));
+      });
+    });
 
     // Build cluster dashboard.
     cluster_dash << UI::Button([this]() { this->DoToggleRun(); }, "Run", "run_pause_button");
     cluster_dash << UI::Button([this]() { this->DoStep(); }, "Step", "step_button");
     cluster_dash << UI::Button([this]() { this->Reset(); }, "Reset", "reset_button");
     cluster_dash << UI::Button([this]() { this->DoToggleMode(); }, "Data Mode", "config_mode_button");
+    cluster_dash << UI::Button([this]() { this->DoToggleAlgorithm(); }, "Use HDBSCAN", "algorithm_button");
     cluster_dash << "<br/>";
     cluster_dash << "<h2><span class=\"badge badge-secondary" << "\" style=\"margin-left:5px\">" << "minPts: " << UI::Live([this]() { return this->minPts; }) << "</span></h2>";
     cluster_dash << "<h2><span class=\"badge badge-secondary" << "\" style=\"margin-left:5px\">" << "epsilon: " << UI::Live([this]() { return this->epsilon; }) << "</span></h2>";
+    cluster_dash << "<h2><span class=\"badge badge-secondary" << "\" style=\"margin-left:5px\">" << "clusters: " << UI::Live([this]() { return this->num_clusters; }) << "</span></h2>";
 
     // Configure all 'da buttons.
     // - They'll be bootstrap buttons: class="btn"
@@ -159,6 +234,9 @@ public:
     auto cg_button = cluster_dash.Button("config_mode_button");
     cg_button.SetAttr("class", "btn btn-primary");
     cg_button.SetAttr("style", "margin:5px");
+    auto al_button = cluster_dash.Button("algorithm_button");
+    al_button.SetAttr("class", "btn btn-primary");
+    al_button.SetAttr("style", "margin:5px");
 
     // Get init.
     InitConfigMode(); // Initialize configuration mode.
@@ -176,9 +254,44 @@ public:
     int x = event.clientX - canvas_pos_x;
     int y = event.clientY - canvas_pos_y;
     AddPoint(x, y, point_radius);
+    // Once clustering has started, DBSCAN labels follow each click without a full rerun.
+    if (page_mode == Mode::CLUSTER && cluster_iteration && !use_hdbscan) {
+      ApplyLiveEdit();
+      cluster_dash.Redraw();
+    }
     Draw();
   }
 
+  /// Is the incremental engine tracking exactly the current points and parameters?
+  bool LiveInSync() const {
+    return live.GetEpsilon() == epsilon && live.GetMinPts() == minPts && live.GetSize() == data.GetSize();
+  }
+
+  /// Copy the incremental engine's view of point i into the demo's ids.
+  void CopyLiveLabel(size_t i) {
+    density_ids[i] = (size_t) live.GetRole(i);
+    cluster_ids[i] = (density_ids[i] == denid_noise) ? 0 : live.GetLabel(i);
+  }
+
+  /// Take the labels after the last point added from the incremental engine. Only the points it
+  /// reports as changed are copied, unless clusters merged, the engine had to be rebuilt (epsilon or
+  /// minPts moved since it was last used), or the labels on screen came from another engine (which
+  /// numbers clusters, and attaches edge points, differently).
+  void ApplyLiveEdit() {
+    const bool rebuild = !LiveInSync();
+    if (rebuild) {
+      live.Reset(epsilon, minPts);
+      for (size_t i = 0; i < data.GetSize(); ++i) live.Insert(data.Get(i, 0), data.Get(i, 1));
+    }
+    if (rebuild || !labels_from_live || !live.GetMerges().empty()) {
+      for (size_t i = 0; i < points.size(); ++i) CopyLiveLabel(i);
+      labels_from_live = true;
+    } else {
+      for (size_t i : live.GetChanged()) CopyLiveLabel(i);
+    }
+    num_clusters = live.GetNumClusters();
+  }
+
   /// Animate function: called every step of animation/running algorithm (i.e. this is the body of the run loop).
   void Animate(const UI::Animate & anim) {
     // 1) Update (iterate the clustering algorithm)
@@ -211,6 +324,14 @@ public:
     return true;
   }
 
+  /// Switch between DBSCAN (at the epsilon slider's value) and HDBSCAN (which ignores epsilon).
+  void DoToggleAlgorithm() {
+    use_hdbscan = !use_hdbscan;
+    auto algorithm_but = cluster_dash.Button("algorithm_button");
+    algorithm_but.Label(use_hdbscan ? "Use DBSCAN" : "Use HDBSCAN");
+    UpdateLive();
+  }
+
   /// Called on Drop Points button press. Drops some random points on the canvas.
   void DoAddPoints() {
     AddPoints(RANDOM_POINT_DROP_CNT);
@@ -222,6 +343,10 @@ public:
     cluster_ids.clear();
     density_ids.clear();
     centroids.clear();
+    data.Clear();
+    optics_stale = true;
+    live.Reset(epsilon, minPts);
+    labels_from_live = false;
     Draw();
   }
 
@@ -240,11 +365,14 @@ public:
   void Draw() {
     auto canvas = viewer.Canvas("DataViewer");
     canvas.Clear("black");
-    const auto & color_map = emp::GetHueMap(10, 0.0, 330);
-    // Draw points.
+    const auto & color_map = emp::GetHueMap(std::max<size_t>(num_clusters, 10), 0.0, 330);
+    // Draw points: one color per cluster, edge points as rings, noise in grey.
     for (size_t i = 0; i < points.size(); ++i) {
-      std::string color = (cluster_iteration) ? color_map[density_ids[i]] : "yellow";
-      canvas.Circle(points[i], color);
+      if (!cluster_iteration) { canvas.Circle(points[i], "yellow"); continue; }
+      if (density_ids[i] == denid_noise) { canvas.Circle(points[i], "grey"); continue; }
+      const std::string & color = color_map[cluster_ids[i] % color_map.size()];   // Incremental ids aren't dense.
+      if (density_ids[i] == denid_edge) canvas.Circle(points[i], "black", color);
+      else canvas.Circle(points[i], color);
     }
     // Draw centroids.
     for (size_t i = 0; i < centroids.size(); ++i) {
@@ -278,10 +406,12 @@ public:
   void Reset() {
     // Cluster reset.
     cluster_iteration = 0;
+    num_clusters = 0;
     centroids.clear(); centroids.resize(num_bins);
     for (size_t i = 0; i < centroids.size(); ++i) { centroids[i].Set(0, 0, 0); }
     for (size_t i = 0; i < cluster_ids.size(); ++i) { cluster_ids[i] = 0; }
     for (size_t i = 0; i < density_ids.size(); ++i) { density_ids[i] = 0; }
+    labels_from_live = false;
     Draw();
   }
 
@@ -290,8 +420,6 @@ public:
   /// Does everything that needs doing to enter cluster mode.
   void InitClusterMode() {
     page_mode = Mode::CLUSTER;
-    epsilon = std::min(std::max(1, EM_ASM_INT_V({ return $("#epsilon-param").val(); })), (int)points.size());
-    minPts = std::min(std::max(1, EM_ASM_INT_V({ return $("#minPts-param").val(); })), (int)points.size());
     Reset();
     UpdateDash();
   }
@@ -317,6 +445,9 @@ public:
     points.emplace_back(circ);
     cluster_ids.emplace_back(0);
     density_ids.emplace_back(0);
+    if (LiveInSync()) live.Insert(circ.GetCenterX(), circ.GetCenterY());
+    data.AddPoint(circ.GetCenterX(), circ.GetCenterY());
+    optics_stale = true;
   }
 
   /// Add a single point to data.
@@ -324,75 +455,57 @@ public:
     points.emplace_back(x, y, r);
     cluster_ids.emplace_back(0);
     density_ids.emplace_back(0);
+    if (LiveInSync()) live.Insert(x, y);
+    data.AddPoint(x, y);
+    optics_stale = true;
   }
 
-  /// Generate n random points.
+  /// Generate n random points that don't overlap each other or any existing point (Poisson-disk
+  /// sampling over a spatial hash, so each drop is O(n) overall). Once the canvas is full, fewer
+  /// than n points are dropped.
   void AddPoints(size_t n) {
     // range: 0 + point_radius : width - point_radius
     // range: 0 + point_radius : height - point_radius
-    size_t counter = 0;
-    for (size_t i = 0; i < n; ++i) {
-      emp::Circle c = emp::Circle(0, 0, point_radius);
-      bool sat;
-      while (counter < MAX_RANDOMIZE_TRIES) {
-        double y = random.GetDouble(point_radius, height - point_radius);
-        double x = random.GetDouble(point_radius, width - point_radius);
-        c.SetCenter(x, y);
-        sat = true;
-        for (size_t j = 0; j < points.size(); ++j) {
-          if (c.HasOverlap(points[j])) { sat = false; break; }
-        }
-        if (sat) { break; }
-        ++counter;
-      }
-      AddPoint(c);
-    }
+    clustering::PoissonDiskSampler sampler(point_radius, point_radius, width - point_radius,
+                                           height - point_radius, 2.0 * point_radius);
+    for (const auto & pt : points) sampler.Insert(pt.GetCenterX(), pt.GetCenterY());
+    clustering::PointSet dropped(2);
+    const size_t placed = sampler.AddPoints(n, random, dropped);
+    for (size_t i = 0; i < placed; ++i) AddPoint(dropped.Get(i, 0), dropped.Get(i, 1), point_radius);
+    if (placed < n) std::cout << "Canvas is full: dropped " << placed << " of " << n << " points." << std::endl;
     Draw();
   }
 
-  /// Take a single step in the k-means clustering algorithm.
+  /// Take a single step in the density-based clustering algorithm.
   void ClusterSingleStep() {
     // If no points have been laid down... do nothing.
     if (points.empty()) return;
-    // Assign membership.
-
-      // go through and look for core points
+    labels_from_live = false;
+    // HDBSCAN: points are either in a cluster or noise (there is no core/edge distinction).
+    if (use_hdbscan) {
+      hdbscan.SetMinPts(minPts);
+      num_clusters = hdbscan.Run(data).num_clusters;
       for (size_t i = 0; i < points.size(); ++i) {
-        size_t close_count = 0;
-        for (size_t c = 0; c < points.size(); ++c) {
-          double pt_dist = Distance(points[i], points[c]);
-          if (pt_dist < epsilon) { ++close_count; }
-        }
-        if (close_count >= minPts) { density_ids[i] = denid_core; }
-        else { density_ids[i] = denid_none;}
+        const bool noise = hdbscan.GetLabel(i) == clustering::NOISE_CLUSTER;
+        density_ids[i] = noise ? denid_noise : denid_core;
+        cluster_ids[i] = noise ? 0 : hdbscan.GetLabel(i);
       }
-
-      // go through and look for edge points
-      for (size_t i = 0; i < points.size(); ++i) {
-        if (density_ids[i] != denid_core) {
-          for (size_t c = 0; c < points.size(); ++c) {
-            if (density_ids[c] == denid_core) {
-              double pt_dist = Distance(points[i], points[c]);
-              if (pt_dist < epsilon) { density_ids[i] = denid_edge; }
-            }
-          }
-        }
-      }
-
-      // go through and look for noise points
-      for (size_t i = 0; i < points.size(); ++i) {
-        if (density_ids[i] == denid_none) {
-          density_ids[i] = denid_noise;
-        }
-      }
-
       ++cluster_iteration;
-}
-
-  /// Compute the euclidean distance between two points (a, b).
-  /// Used here as the point similarity metric for k-means clustering algorithm.
-  double Distance(const emp::Circle & a, const emp::Circle & b) {
-    return (std::sqrt( std::pow(a.GetCenterX() - b.GetCenterX(), 2) + std::pow(a.GetCenterY() - b.GetCenterY(), 2) ));
+      return;
+    }
+    // Order the points once per point set and minPts; every epsilon is then an O(n) extraction.
+    if (optics_stale) {
+      optics.SetMinPts(minPts);
+      optics.Run(data);
+      optics_stale = false;
+    }
+    // Label core, edge and noise points, and which cluster each belongs to.
+    num_clusters = optics.Extract(epsilon).num_clusters;
+    for (size_t i = 0; i < points.size(); ++i) {
+      density_ids[i] = (size_t) optics.GetRole(i);
+      cluster_ids[i] = (density_ids[i] == denid_noise) ? 0 : optics.GetLabel(i);
+    }
+    ++cluster_iteration;
   }
 
 };
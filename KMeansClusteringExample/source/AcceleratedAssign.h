@@ -0,0 +1,344 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Triangle-inequality accelerated nearest-centroid assignment.
+//  - HamerlyBounds: one upper bound (to the assigned centroid) and one lower bound (to every other
+//    centroid) per point. O(n) extra memory; best at low/moderate dimensionality.
+//  - ElkanBounds: one upper bound plus K lower bounds per point. O(nK) extra memory; prunes more
+//    per point, which pays off when distances are expensive (high dimensionality).
+//
+//  Both produce exactly the assignments of the naive loop (nearest centroid, ties to the lower
+//  index): bounds are only used to *skip* work, with a small safety slack so that floating-point
+//  error in the bound bookkeeping can never skip a point whose nearest centroid is in doubt, and
+//  every actual decision compares exact squared distances.
+//
+//  Both are templated on the coordinate type T (double or float, matching the PointSet): distances
+//  are computed in T, exactly as the assignment kernel computes them, and only the bounds are kept
+//  in double. Float distances carry far more rounding error, so they get a wider slack.
+
+#ifndef CLUSTERING_ACCELERATED_ASSIGN_H
+#define CLUSTERING_ACCELERATED_ASSIGN_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "base/vector.h"
+
+#include "PointSet.h"
+#include "ThreadPool.h"
+
+namespace clustering {
+
+  /// Squared distance between a gathered point and a row-major centroid. Accumulates dimensions in
+  /// the same order as the assignment kernel, so the result is bit-identical to it.
+  template <typename T>
+  inline T PointCentroidSq(const T * pt, const T * centroid, size_t dims) {
+    T dist = 0;
+    for (size_t d = 0; d < dims; ++d) {
+      const T diff = pt[d] - centroid[d];
+      dist += diff * diff;
+    }
+    return dist;
+  }
+
+  /// Copy point i out of the SoA columns (so repeated distance evaluations stream contiguously).
+  template <typename T>
+  inline void GatherPoint(const T * const * cols, size_t i, size_t dims, T * pt) {
+    for (size_t d = 0; d < dims; ++d) pt[d] = cols[d][i];
+  }
+
+  /// Relative slack applied to bound comparisons.
+  constexpr double BOUND_SLACK = 1e-9;
+  /// ...with float32 distances (relative error up to about dims * 6e-8; covers ~1000 dimensions).
+  constexpr double BOUND_SLACK_FLOAT = 1e-4;
+
+  template <typename T>
+  constexpr double GetBoundSlack() { return sizeof(T) < sizeof(double) ? BOUND_SLACK_FLOAT : BOUND_SLACK; }
+
+  /// Shared centroid-centroid bookkeeping: half the distance from each centroid to its nearest
+  /// neighbor (s[c]) and, for Elkan, the full half-distance matrix.
+  class CentroidSeparation {
+  protected:
+    emp::vector<double> half_dist;   //< K x K: half distance between centroids.
+    emp::vector<double> half_sep;    //< s[c] = min over c' != c of half_dist[c][c'].
+
+  public:
+    template <typename T>
+    void Compute(const T * centroids, size_t num_clusters, size_t dims) {
+      half_dist.assign(num_clusters * num_clusters, 0.0);
+      half_sep.assign(num_clusters, std::numeric_limits<double>::max());
+      for (size_t a = 0; a < num_clusters; ++a) {
+        for (size_t b = a + 1; b < num_clusters; ++b) {
+          double dist = 0.0;
+          for (size_t d = 0; d < dims; ++d) {
+            const double diff = (double) centroids[a * dims + d] - (double) centroids[b * dims + d];
+            dist += diff * diff;
+          }
+          const double half = 0.5 * std::sqrt(dist);
+          half_dist[a * num_clusters + b] = half_dist[b * num_clusters + a] = half;
+          half_sep[a] = std::min(half_sep[a], half);
+          half_sep[b] = std::min(half_sep[b], half);
+        }
+      }
+    }
+    double GetHalfDist(size_t a, size_t b, size_t num_clusters) const { return half_dist[a * num_clusters + b]; }
+    double GetHalfSep(size_t c) const { return half_sep[c]; }
+  };
+
+  template <typename T>
+  class HamerlyBounds {
+  protected:
+    emp::vector<double> upper;   //< Upper bound on distance to assigned centroid.
+    emp::vector<double> lower;   //< Lower bound on distance to any other centroid.
+    CentroidSeparation sep;
+    bool ready;
+    emp::vector<T> centroids_t;           //< Centroids transposed (dims x K) for the block scan.
+    emp::vector<size_t> thread_changed;   //< Per-thread changed-assignment counts.
+    emp::vector<size_t> thread_dists;     //< Per-thread distance counts.
+
+    /// Exact scan of every pending point against all centroids, BLOCK points at a time (gathered
+    /// into a small SoA tile so the compiler vectorizes across points, like the naive kernel).
+    /// Tracks the second-nearest distance for the lower bound. Returns changed assignments.
+    size_t ScanPending(const emp::vector<size_t> & pending, const T * const * cols, size_t num_clusters,
+                       size_t dims, emp::vector<size_t> & assignments) {
+      constexpr size_t BLOCK = 8;
+      size_t changed = 0;
+      emp::vector<T> tile(dims * BLOCK);
+      for (size_t start = 0; start < pending.size(); start += BLOCK) {
+        const size_t count = std::min(BLOCK, pending.size() - start);
+        for (size_t d = 0; d < dims; ++d) {
+          for (size_t j = 0; j < BLOCK; ++j) tile[d * BLOCK + j] = cols[d][pending[start + std::min(j, count - 1)]];
+        }
+        T best[BLOCK], second[BLOCK], acc[BLOCK];
+        size_t best_id[BLOCK];
+        for (size_t j = 0; j < BLOCK; ++j) {
+          best[j] = second[j] = std::numeric_limits<T>::max();
+          best_id[j] = 0;
+        }
+        for (size_t c = 0; c < num_clusters; ++c) {
+          for (size_t j = 0; j < BLOCK; ++j) acc[j] = 0;
+          for (size_t d = 0; d < dims; ++d) {
+            const T cd = centroids_t[d * num_clusters + c];
+            const T * row = tile.data() + d * BLOCK;
+            for (size_t j = 0; j < BLOCK; ++j) { const T diff = row[j] - cd; acc[j] += diff * diff; }
+          }
+          for (size_t j = 0; j < BLOCK; ++j) {
+            const bool lt = acc[j] < best[j];
+            second[j] = lt ? best[j] : std::min(second[j], acc[j]);
+            best[j] = lt ? acc[j] : best[j];
+            best_id[j] = lt ? c : best_id[j];
+          }
+        }
+        for (size_t j = 0; j < count; ++j) {
+          const size_t i = pending[start + j];
+          upper[i] = std::sqrt(best[j]);
+          lower[i] = std::sqrt(second[j]);
+          if (assignments[i] != best_id[j]) { assignments[i] = best_id[j]; ++changed; }
+        }
+      }
+      return changed;
+    }
+
+    /// Points [begin, end): check bounds, tighten, and queue failures for a full scan.
+    size_t AssignRange(size_t begin, size_t end, const T * const * cols, const T * centroids,
+                       size_t num_clusters, size_t dims, bool initializing,
+                       emp::vector<size_t> & assignments, size_t & dist_count) {
+      emp::vector<size_t> pending;
+      if (initializing) {
+        pending.resize(end - begin);
+        for (size_t i = begin; i < end; ++i) pending[i - begin] = i;
+      } else {
+        emp::vector<T> pt(dims);
+        for (size_t i = begin; i < end; ++i) {
+          const size_t a = assignments[i];
+          const double bound = std::max(sep.GetHalfSep(a), lower[i]);
+          if (upper[i] * (1.0 + GetBoundSlack<T>()) < bound) continue;
+          // Tighten the upper bound and try again before paying for a full scan.
+          GatherPoint(cols, i, dims, pt.data());
+          upper[i] = std::sqrt(PointCentroidSq(pt.data(), centroids + a * dims, dims));
+          ++dist_count;
+          if (upper[i] * (1.0 + GetBoundSlack<T>()) < bound) continue;
+          pending.push_back(i);
+        }
+      }
+      dist_count += pending.size() * num_clusters;
+      return ScanPending(pending, cols, num_clusters, dims, assignments);
+    }
+
+  public:
+    HamerlyBounds() : upper(), lower(), sep(), ready(false), centroids_t(), thread_changed(), thread_dists() { ; }
+
+    void Invalidate() { ready = false; }
+    bool IsReady() const { return ready; }
+
+    /// Assign every point (split across pool). Returns number of changed assignments; adds
+    /// point-centroid distance evaluations to dist_count.
+    size_t Assign(const BasicPointSet<T> & points, const T * const * cols, const T * centroids,
+                  size_t num_clusters, emp::vector<size_t> & assignments, ThreadPool & pool, size_t & dist_count) {
+      const size_t n = points.GetSize();
+      const size_t dims = points.GetDims();
+      centroids_t.resize(num_clusters * dims);
+      for (size_t c = 0; c < num_clusters; ++c) {
+        for (size_t d = 0; d < dims; ++d) centroids_t[d * num_clusters + c] = centroids[c * dims + d];
+      }
+      const bool initializing = !ready;
+      if (initializing) {
+        upper.resize(n);
+        lower.resize(n);
+      } else {
+        sep.Compute(centroids, num_clusters, dims);
+      }
+      thread_changed.assign(pool.GetNumThreads(), 0);
+      thread_dists.assign(pool.GetNumThreads(), 0);
+      pool.ForRanges(n, [&](size_t t, size_t begin, size_t end) {
+        thread_changed[t] = AssignRange(begin, end, cols, centroids, num_clusters, dims, initializing,
+                                        assignments, thread_dists[t]);
+      });
+      ready = true;
+      size_t changed = 0;
+      for (size_t t = 0; t < thread_changed.size(); ++t) { changed += thread_changed[t]; dist_count += thread_dists[t]; }
+      return changed;
+    }
+
+    /// Centroids moved by drift[c] (Euclidean): loosen bounds accordingly.
+    void ApplyDrift(const double * drift, size_t num_clusters, const emp::vector<size_t> & assignments, ThreadPool & pool) {
+      if (!ready) return;
+      // Largest and second largest drift (a point's own centroid doesn't count toward its lower bound).
+      size_t max_id = 0;
+      double max_drift = 0.0, second_drift = 0.0;
+      for (size_t c = 0; c < num_clusters; ++c) {
+        if (drift[c] > max_drift) { second_drift = max_drift; max_drift = drift[c]; max_id = c; }
+        else if (drift[c] > second_drift) second_drift = drift[c];
+      }
+      pool.ForRanges(upper.size(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          const size_t a = assignments[i];
+          upper[i] += drift[a];
+          lower[i] -= (a == max_id) ? second_drift : max_drift;
+        }
+      });
+    }
+  };
+
+  template <typename T>
+  class ElkanBounds {
+  protected:
+    emp::vector<double> upper;   //< Upper bound on distance to assigned centroid.
+    emp::vector<double> lower;   //< n x K lower bounds on distance to each centroid.
+    emp::vector<double> drift;   //< Centroid movement not yet folded into the lower bounds.
+    CentroidSeparation sep;
+    size_t num_clusters;
+    bool ready;
+    emp::vector<size_t> thread_changed;   //< Per-thread changed-assignment counts.
+    emp::vector<size_t> thread_dists;     //< Per-thread distance counts.
+
+    /// First pass: exact distances to every centroid become the lower bounds.
+    size_t InitRange(size_t begin, size_t end, const T * const * cols, const T * centroids,
+                     size_t dims, emp::vector<size_t> & assignments) {
+      const size_t K = num_clusters;
+      emp::vector<T> pt(dims);
+      size_t changed = 0;
+      for (size_t i = begin; i < end; ++i) {
+        T best = std::numeric_limits<T>::max();
+        size_t best_id = 0;
+        GatherPoint(cols, i, dims, pt.data());
+        for (size_t c = 0; c < K; ++c) {
+          const T dist = PointCentroidSq(pt.data(), centroids + c * dims, dims);
+          lower[i * K + c] = std::sqrt(dist);
+          if (dist < best) { best = dist; best_id = c; }
+        }
+        upper[i] = std::sqrt(best);
+        if (best_id != assignments[i]) { assignments[i] = best_id; ++changed; }
+      }
+      return changed;
+    }
+
+    size_t AssignRange(size_t begin, size_t end, const T * const * cols, const T * centroids,
+                       size_t dims, emp::vector<size_t> & assignments, size_t & dist_count) {
+      const size_t K = num_clusters;
+      emp::vector<T> point_buf(dims);
+      T * pt = point_buf.data();
+      size_t changed = 0;
+      for (size_t i = begin; i < end; ++i) {
+        size_t a = assignments[i];
+        double u = upper[i];
+        // Lower bounds are loosened here rather than in ApplyDrift() so the n x K table is only
+        // swept once per iteration.
+        double * l = lower.data() + i * K;
+        for (size_t c = 0; c < K; ++c) l[c] = std::max(0.0, l[c] - drift[c]);
+        if (u * (1.0 + GetBoundSlack<T>()) < sep.GetHalfSep(a)) continue;
+        bool tight = false;
+        T u_sq = 0;
+        for (size_t c = 0; c < K; ++c) {
+          if (c == a) continue;
+          const double prune = std::max(l[c], sep.GetHalfDist(a, c, K));
+          if (u * (1.0 + GetBoundSlack<T>()) < prune) continue;
+          if (!tight) {
+            GatherPoint(cols, i, dims, pt);
+            u_sq = PointCentroidSq(pt, centroids + a * dims, dims);
+            u = std::sqrt(u_sq);
+            l[a] = u;
+            tight = true;
+            ++dist_count;
+            if (u * (1.0 + GetBoundSlack<T>()) < prune) continue;
+          }
+          const T dist_sq = PointCentroidSq(pt, centroids + c * dims, dims);
+          ++dist_count;
+          l[c] = std::sqrt(dist_sq);
+          if (dist_sq < u_sq || (dist_sq == u_sq && c < a)) { a = c; u_sq = dist_sq; u = l[c]; }
+        }
+        upper[i] = u;
+        if (a != assignments[i]) { assignments[i] = a; ++changed; }
+      }
+      return changed;
+    }
+
+  public:
+    ElkanBounds() : upper(), lower(), drift(), sep(), num_clusters(0), ready(false),
+                    thread_changed(), thread_dists() { ; }
+
+    void Invalidate() { ready = false; }
+    bool IsReady() const { return ready; }
+
+    size_t Assign(const BasicPointSet<T> & points, const T * const * cols, const T * centroids,
+                  size_t _num_clusters, emp::vector<size_t> & assignments, ThreadPool & pool, size_t & dist_count) {
+      const size_t n = points.GetSize();
+      const size_t dims = points.GetDims();
+      const bool initializing = !ready || num_clusters != _num_clusters;
+      num_clusters = _num_clusters;
+      if (initializing) {
+        upper.resize(n);
+        lower.resize(n * num_clusters);
+        drift.assign(num_clusters, 0.0);
+        dist_count += n * num_clusters;
+      } else {
+        sep.Compute(centroids, num_clusters, dims);
+      }
+      thread_changed.assign(pool.GetNumThreads(), 0);
+      thread_dists.assign(pool.GetNumThreads(), 0);
+      pool.ForRanges(n, [&](size_t t, size_t begin, size_t end) {
+        thread_changed[t] = initializing ? InitRange(begin, end, cols, centroids, dims, assignments)
+                                         : AssignRange(begin, end, cols, centroids, dims, assignments, thread_dists[t]);
+      });
+      std::fill(drift.begin(), drift.end(), 0.0);
+      ready = true;
+      size_t changed = 0;
+      for (size_t t = 0; t < thread_changed.size(); ++t) { changed += thread_changed[t]; dist_count += thread_dists[t]; }
+      return changed;
+    }
+
+    /// Centroids moved by _drift[c] (Euclidean): loosen upper bounds now, lower bounds lazily.
+    void ApplyDrift(const double * _drift, size_t K, const emp::vector<size_t> & assignments, ThreadPool & pool) {
+      if (!ready) return;
+      for (size_t c = 0; c < K; ++c) drift[c] += _drift[c];
+      pool.ForRanges(upper.size(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) upper[i] += _drift[assignments[i]];
+      });
+    }
+  };
+
+}
+
+#endif
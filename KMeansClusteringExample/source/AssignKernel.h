@@ -0,0 +1,250 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Nearest-centroid assignment kernel. Points come in as SoA columns, centroids as a transposed
+//  (dims x K) buffer, and distances are compared squared (no sqrt/pow).
+//  - AVX-512: 16 doubles / 32 floats per iteration (two 8- / 16-wide registers).
+//  - AVX2:     8 doubles / 16 floats per iteration (two 4- / 8-wide registers).
+//  - Portable: 8-double / 16-float blocks written so the compiler can vectorize them (used for
+//    web builds).
+//  Float32 points (PointSetF) are compared in float32 against float32 centroids: twice the lanes
+//  and half the memory traffic of the double kernel.
+//  The ISA is picked at compile time (-march=native enables the wide paths); define
+//  CLUSTERING_NO_SIMD to force the portable path. Every path accumulates dimensions in the same
+//  order with separate multiply/add and breaks ties toward the lower centroid index, so all paths
+//  produce identical assignments (build with -ffp-contract=off so the scalar code isn't fused).
+
+#ifndef CLUSTERING_ASSIGN_KERNEL_H
+#define CLUSTERING_ASSIGN_KERNEL_H
+
+#include <cstddef>
+#include <limits>
+
+#if !defined(CLUSTERING_NO_SIMD) && (defined(__AVX512F__) || defined(__AVX2__))
+#include <immintrin.h>
+#endif
+
+namespace clustering {
+
+  /// Which SIMD path was compiled in?
+  inline const char * GetAssignKernelName() {
+#if !defined(CLUSTERING_NO_SIMD) && defined(__AVX512F__)
+    return "avx512";
+#elif !defined(CLUSTERING_NO_SIMD) && defined(__AVX2__)
+    return "avx2";
+#else
+    return "portable";
+#endif
+  }
+
+  /// Squared distance from point i (SoA columns) to centroid c (transposed, dims x K).
+  template <typename T>
+  inline T SquaredDistanceSoA(const T * const * cols, size_t i, const T * cent_t,
+                              size_t num_clusters, size_t c, size_t dims) {
+    T dist = 0;
+    for (size_t d = 0; d < dims; ++d) {
+      const T diff = cols[d][i] - cent_t[d * num_clusters + c];
+      dist += diff * diff;
+    }
+    return dist;
+  }
+
+  namespace internal {
+
+    /// Scalar tail: points [begin, end).
+    template <typename T>
+    inline void AssignScalar(const T * const * cols, size_t dims, size_t begin, size_t end,
+                             const T * cent_t, size_t num_clusters, size_t * out_ids, T * out_dists) {
+      for (size_t i = begin; i < end; ++i) {
+        T best = std::numeric_limits<T>::max();
+        size_t best_id = 0;
+        for (size_t c = 0; c < num_clusters; ++c) {
+          const T dist = SquaredDistanceSoA(cols, i, cent_t, num_clusters, c, dims);
+          if (dist < best) { best = dist; best_id = c; }
+        }
+        out_ids[i] = best_id;
+        out_dists[i] = best;
+      }
+    }
+
+  }
+
+  /// For every point in [begin, end), find the nearest centroid. Writes the centroid index into
+  /// out_ids[i] and the squared distance into out_dists[i].
+  ///   cols   - dims pointers, one per coordinate column
+  ///   cent_t - centroid coordinates transposed: cent_t[d * num_clusters + c]
+  inline void AssignNearestBlock(const double * const * cols, size_t dims, size_t begin, size_t end,
+                                 const double * cent_t, size_t num_clusters,
+                                 size_t * out_ids, double * out_dists) {
+    size_t i = begin;
+#if !defined(CLUSTERING_NO_SIMD) && defined(__AVX512F__)
+    for (; i + 16 <= end; i += 16) {
+      __m512d best0 = _mm512_set1_pd(std::numeric_limits<double>::max()), best1 = best0;
+      __m512d id0 = _mm512_setzero_pd(), id1 = id0;
+      for (size_t c = 0; c < num_clusters; ++c) {
+        __m512d acc0 = _mm512_setzero_pd(), acc1 = acc0;
+        for (size_t d = 0; d < dims; ++d) {
+          const __m512d cd = _mm512_set1_pd(cent_t[d * num_clusters + c]);
+          const __m512d diff0 = _mm512_sub_pd(_mm512_loadu_pd(cols[d] + i), cd);
+          const __m512d diff1 = _mm512_sub_pd(_mm512_loadu_pd(cols[d] + i + 8), cd);
+          acc0 = _mm512_add_pd(acc0, _mm512_mul_pd(diff0, diff0));
+          acc1 = _mm512_add_pd(acc1, _mm512_mul_pd(diff1, diff1));
+        }
+        const __m512d cid = _mm512_set1_pd((double)c);
+        const __mmask8 lt0 = _mm512_cmp_pd_mask(acc0, best0, _CMP_LT_OQ);
+        const __mmask8 lt1 = _mm512_cmp_pd_mask(acc1, best1, _CMP_LT_OQ);
+        best0 = _mm512_mask_blend_pd(lt0, best0, acc0);
+        best1 = _mm512_mask_blend_pd(lt1, best1, acc1);
+        id0 = _mm512_mask_blend_pd(lt0, id0, cid);
+        id1 = _mm512_mask_blend_pd(lt1, id1, cid);
+      }
+      alignas(64) double ids[16];
+      _mm512_store_pd(ids, id0);
+      _mm512_store_pd(ids + 8, id1);
+      _mm512_storeu_pd(out_dists + i, best0);
+      _mm512_storeu_pd(out_dists + i + 8, best1);
+      for (size_t j = 0; j < 16; ++j) out_ids[i + j] = (size_t)ids[j];
+    }
+#elif !defined(CLUSTERING_NO_SIMD) && defined(__AVX2__)
+    for (; i + 8 <= end; i += 8) {
+      __m256d best0 = _mm256_set1_pd(std::numeric_limits<double>::max()), best1 = best0;
+      __m256d id0 = _mm256_setzero_pd(), id1 = id0;
+      for (size_t c = 0; c < num_clusters; ++c) {
+        __m256d acc0 = _mm256_setzero_pd(), acc1 = acc0;
+        for (size_t d = 0; d < dims; ++d) {
+          const __m256d cd = _mm256_set1_pd(cent_t[d * num_clusters + c]);
+          const __m256d diff0 = _mm256_sub_pd(_mm256_loadu_pd(cols[d] + i), cd);
+          const __m256d diff1 = _mm256_sub_pd(_mm256_loadu_pd(cols[d] + i + 4), cd);
+          acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(diff0, diff0));
+          acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(diff1, diff1));
+        }
+        const __m256d cid = _mm256_set1_pd((double)c);
+        const __m256d lt0 = _mm256_cmp_pd(acc0, best0, _CMP_LT_OQ);
+        const __m256d lt1 = _mm256_cmp_pd(acc1, best1, _CMP_LT_OQ);
+        best0 = _mm256_blendv_pd(best0, acc0, lt0);
+        best1 = _mm256_blendv_pd(best1, acc1, lt1);
+        id0 = _mm256_blendv_pd(id0, cid, lt0);
+        id1 = _mm256_blendv_pd(id1, cid, lt1);
+      }
+      alignas(32) double ids[8];
+      _mm256_store_pd(ids, id0);
+      _mm256_store_pd(ids + 4, id1);
+      _mm256_storeu_pd(out_dists + i, best0);
+      _mm256_storeu_pd(out_dists + i + 4, best1);
+      for (size_t j = 0; j < 8; ++j) out_ids[i + j] = (size_t)ids[j];
+    }
+#else
+    constexpr size_t BLOCK = 8;
+    for (; i + BLOCK <= end; i += BLOCK) {
+      double best[BLOCK], acc[BLOCK];
+      size_t best_id[BLOCK];
+      for (size_t j = 0; j < BLOCK; ++j) { best[j] = std::numeric_limits<double>::max(); best_id[j] = 0; }
+      for (size_t c = 0; c < num_clusters; ++c) {
+        for (size_t j = 0; j < BLOCK; ++j) acc[j] = 0.0;
+        for (size_t d = 0; d < dims; ++d) {
+          const double * col = cols[d] + i;
+          const double cd = cent_t[d * num_clusters + c];
+          for (size_t j = 0; j < BLOCK; ++j) { const double diff = col[j] - cd; acc[j] += diff * diff; }
+        }
+        for (size_t j = 0; j < BLOCK; ++j) {
+          const bool lt = acc[j] < best[j];
+          best[j] = lt ? acc[j] : best[j];
+          best_id[j] = lt ? c : best_id[j];
+        }
+      }
+      for (size_t j = 0; j < BLOCK; ++j) { out_ids[i + j] = best_id[j]; out_dists[i + j] = best[j]; }
+    }
+#endif
+    internal::AssignScalar(cols, dims, i, end, cent_t, num_clusters, out_ids, out_dists);
+  }
+
+  /// Float32 version of the above (same contract; distances are accumulated in float32).
+  inline void AssignNearestBlock(const float * const * cols, size_t dims, size_t begin, size_t end,
+                                 const float * cent_t, size_t num_clusters,
+                                 size_t * out_ids, float * out_dists) {
+    size_t i = begin;
+#if !defined(CLUSTERING_NO_SIMD) && defined(__AVX512F__)
+    for (; i + 32 <= end; i += 32) {
+      __m512 best0 = _mm512_set1_ps(std::numeric_limits<float>::max()), best1 = best0;
+      __m512 id0 = _mm512_setzero_ps(), id1 = id0;   // Exact as floats up to 2^24 centroids.
+      for (size_t c = 0; c < num_clusters; ++c) {
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = acc0;
+        for (size_t d = 0; d < dims; ++d) {
+          const __m512 cd = _mm512_set1_ps(cent_t[d * num_clusters + c]);
+          const __m512 diff0 = _mm512_sub_ps(_mm512_loadu_ps(cols[d] + i), cd);
+          const __m512 diff1 = _mm512_sub_ps(_mm512_loadu_ps(cols[d] + i + 16), cd);
+          acc0 = _mm512_add_ps(acc0, _mm512_mul_ps(diff0, diff0));
+          acc1 = _mm512_add_ps(acc1, _mm512_mul_ps(diff1, diff1));
+        }
+        const __m512 cid = _mm512_set1_ps((float)c);
+        const __mmask16 lt0 = _mm512_cmp_ps_mask(acc0, best0, _CMP_LT_OQ);
+        const __mmask16 lt1 = _mm512_cmp_ps_mask(acc1, best1, _CMP_LT_OQ);
+        best0 = _mm512_mask_blend_ps(lt0, best0, acc0);
+        best1 = _mm512_mask_blend_ps(lt1, best1, acc1);
+        id0 = _mm512_mask_blend_ps(lt0, id0, cid);
+        id1 = _mm512_mask_blend_ps(lt1, id1, cid);
+      }
+      alignas(64) float ids[32];
+      _mm512_store_ps(ids, id0);
+      _mm512_store_ps(ids + 16, id1);
+      _mm512_storeu_ps(out_dists + i, best0);
+      _mm512_storeu_ps(out_dists + i + 16, best1);
+      for (size_t j = 0; j < 32; ++j) out_ids[i + j] = (size_t)ids[j];
+    }
+#elif !defined(CLUSTERING_NO_SIMD) && defined(__AVX2__)
+    for (; i + 16 <= end; i += 16) {
+      __m256 best0 = _mm256_set1_ps(std::numeric_limits<float>::max()), best1 = best0;
+      __m256 id0 = _mm256_setzero_ps(), id1 = id0;
+      for (size_t c = 0; c < num_clusters; ++c) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = acc0;
+        for (size_t d = 0; d < dims; ++d) {
+          const __m256 cd = _mm256_set1_ps(cent_t[d * num_clusters + c]);
+          const __m256 diff0 = _mm256_sub_ps(_mm256_loadu_ps(cols[d] + i), cd);
+          const __m256 diff1 = _mm256_sub_ps(_mm256_loadu_ps(cols[d] + i + 8), cd);
+          acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(diff0, diff0));
+          acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(diff1, diff1));
+        }
+        const __m256 cid = _mm256_set1_ps((float)c);
+        const __m256 lt0 = _mm256_cmp_ps(acc0, best0, _CMP_LT_OQ);
+        const __m256 lt1 = _mm256_cmp_ps(acc1, best1, _CMP_LT_OQ);
+        best0 = _mm256_blendv_ps(best0, acc0, lt0);
+        best1 = _mm256_blendv_ps(best1, acc1, lt1);
+        id0 = _mm256_blendv_ps(id0, cid, lt0);
+        id1 = _mm256_blendv_ps(id1, cid, lt1);
+      }
+      alignas(32) float ids[16];
+      _mm256_store_ps(ids, id0);
+      _mm256_store_ps(ids + 8, id1);
+      _mm256_storeu_ps(out_dists + i, best0);
+      _mm256_storeu_ps(out_dists + i + 8, best1);
+      for (size_t j = 0; j < 16; ++j) out_ids[i + j] = (size_t)ids[j];
+    }
+#else
+    constexpr size_t BLOCK = 16;
+    for (; i + BLOCK <= end; i += BLOCK) {
+      float best[BLOCK], acc[BLOCK];
+      size_t best_id[BLOCK];
+      for (size_t j = 0; j < BLOCK; ++j) { best[j] = std::numeric_limits<float>::max(); best_id[j] = 0; }
+      for (size_t c = 0; c < num_clusters; ++c) {
+        for (size_t j = 0; j < BLOCK; ++j) acc[j] = 0.0f;
+        for (size_t d = 0; d < dims; ++d) {
+          const float * col = cols[d] + i;
+          const float cd = cent_t[d * num_clusters + c];
+          for (size_t j = 0; j < BLOCK; ++j) { const float diff = col[j] - cd; acc[j] += diff * diff; }
+        }
+        for (size_t j = 0; j < BLOCK; ++j) {
+          const bool lt = acc[j] < best[j];
+          best[j] = lt ? acc[j] : best[j];
+          best_id[j] = lt ? c : best_id[j];
+        }
+      }
+      for (size_t j = 0; j < BLOCK; ++j) { out_ids[i + j] = best_id[j]; out_dists[i + j] = best[j]; }
+    }
+#endif
+    internal::AssignScalar(cols, dims, i, end, cent_t, num_clusters, out_ids, out_dists);
+  }
+
+}
+
+#endif
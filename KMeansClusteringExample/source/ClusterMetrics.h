@@ -0,0 +1,71 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Comparing a clustering to a reference labeling (e.g., the blobs a synthetic dataset was drawn
+//  from). Labels are arbitrary ids; nothing has to be numbered densely or match up between the
+//  two labelings.
+//  - AdjustedRandIndex (Hubert & Arabie, 1985): pair-counting agreement corrected for chance;
+//    1 for identical partitions, about 0 for independent ones (can be negative).
+
+#ifndef CLUSTERING_CLUSTER_METRICS_H
+#define CLUSTERING_CLUSTER_METRICS_H
+
+#include <algorithm>
+#include <cstdint>
+
+#include "base/vector.h"
+
+namespace clustering {
+
+  namespace internal {
+    /// Number of unordered pairs among count items.
+    inline double Pairs(size_t count) { return 0.5 * (double) count * (double) (count - (count > 0)); }
+
+    /// Renumber labels 0..(distinct - 1); returns how many distinct labels there are.
+    inline size_t DenseLabels(const emp::vector<size_t> & labels, size_t n, emp::vector<uint64_t> & dense) {
+      emp::vector<size_t> distinct(labels.begin(), labels.begin() + n);
+      std::sort(distinct.begin(), distinct.end());
+      distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+      dense.resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        dense[i] = (uint64_t) (std::lower_bound(distinct.begin(), distinct.end(), labels[i]) - distinct.begin());
+      }
+      return distinct.size();
+    }
+
+    /// Sum of Pairs() over the multiplicities of values (sorted in place).
+    inline double SumPairs(emp::vector<uint64_t> & values) {
+      std::sort(values.begin(), values.end());
+      double total = 0.0;
+      for (size_t i = 0; i < values.size(); ) {
+        size_t j = i + 1;
+        while (j < values.size() && values[j] == values[i]) ++j;
+        total += Pairs(j - i);
+        i = j;
+      }
+      return total;
+    }
+  }
+
+  /// Adjusted Rand index between two labelings of the same points. O(n log n).
+  inline double AdjustedRandIndex(const emp::vector<size_t> & a, const emp::vector<size_t> & b) {
+    const size_t n = std::min(a.size(), b.size());
+    if (n < 2) return 1.0;
+    // Contingency table cells as sorted keys (sparse: no K_a x K_b table).
+    emp::vector<uint64_t> dense_a, dense_b, cells(n);
+    internal::DenseLabels(a, n, dense_a);
+    const size_t num_b = internal::DenseLabels(b, n, dense_b);
+    for (size_t i = 0; i < n; ++i) cells[i] = dense_a[i] * num_b + dense_b[i];
+    const double sum_cells = internal::SumPairs(cells);
+    const double sum_a = internal::SumPairs(dense_a);
+    const double sum_b = internal::SumPairs(dense_b);
+    const double expected = sum_a * sum_b / internal::Pairs(n);
+    const double max_index = 0.5 * (sum_a + sum_b);
+    if (max_index == expected) return 1.0;   // Both trivial (all one cluster, or all singletons).
+    return (sum_cells - expected) / (max_index - expected);
+  }
+
+}
+
+#endif
@@ -0,0 +1,198 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Streaming coresets for k-means: compress a stream of points, in one pass, into a small weighted
+//  point set whose k-means cost approximates the full set's for any K centroids. Clustering the
+//  coreset (KMeans::SetWeights()) then gives nearly the same centroids for a fraction of the work.
+//  - Reduce (sensitivity sampling; Feldman & Langberg, 2011, in the form given by Bachem, Lucic
+//    & Krause, "Practical Coreset Constructions for Machine Learning", 2017): cluster the weighted
+//    input roughly (weighted k-means++ plus a Lloyd iteration), bound each point's
+//    sensitivity by s(p) = w(p) D(p)^2 / cost + w(p) / W(its cluster), and draw m points i.i.d.
+//    with probability q(p) = s(p) / sum(s), each weighted w(p) / (m q(p)). The estimate of the
+//    cost is unbiased for any centroids; points that are far out or in small clusters are the
+//    likeliest to be kept.
+//  - Merge-and-reduce (Har-Peled & Mazumdar, 2004): buffer m raw points; a full buffer becomes a
+//    level-0 coreset, and two coresets on the same level are merged and reduced into one on the
+//    next level (a binary counter). Only O(m log(n / m)) points are held at any time, and the
+//    reductions add up to O(n K dims) work, so the pass over the data dominates.
+//  Error compounds with each level a point passes through, so m should be sized for the target
+//  error divided by about log2(n / m); a few thousand points is typically plenty for modest K.
+
+#ifndef CLUSTERING_CORESET_H
+#define CLUSTERING_CORESET_H
+
+#include <algorithm>
+#include <utility>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "PointSet.h"
+#include "KMeans.h"
+
+namespace clustering {
+
+  class CoresetBuilder {
+  protected:
+    static constexpr size_t ROUGH_ITERATIONS = 2;   //< Seeding plus one Lloyd update: rough is enough.
+
+    size_t num_clusters;              //< K the coreset should serve.
+    size_t dims;
+    size_t coreset_size;              //< m: points per reduced coreset.
+    size_t points_seen;
+    double weight_seen;               //< Total weight added.
+    PointSet buffer;                  //< Raw points not yet part of a coreset.
+    emp::vector<double> buffer_weights;
+    emp::vector<PointSet> levels;     //< levels[j]: a coreset summarizing m 2^j buffers (or empty).
+    emp::vector<emp::vector<double>> level_weights;
+    KMeans rough;                     //< Rough clustering used to bound sensitivities.
+    emp::vector<double> sensitivity;  //< Scratch: running sum of sensitivities.
+    emp::vector<double> picked;       //< Scratch: weight of each input point in the reduced set.
+
+    /// Reduce the weighted set (points, weights) to at most m points, in place.
+    void Reduce(PointSet & points, emp::vector<double> & weights, emp::Random & random) {
+      const size_t n = points.GetSize();
+      if (n <= coreset_size) return;
+      rough.SetK(std::min(num_clusters, n));
+      rough.SetWeights(weights);
+      rough.InvalidatePoints();   // New points, possibly as many as last time.
+      rough.Run(points, random, ROUGH_ITERATIONS);
+      const size_t k = rough.GetK();
+      const emp::vector<size_t> & ids = rough.GetAssignments();
+      const emp::vector<double> & centroids = rough.GetCentroids();
+
+      // Sensitivity bounds: cost share plus share of the cluster's weight.
+      emp::vector<double> cluster_weight(k, 0.0);
+      sensitivity.resize(n);
+      double cost = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+        double dist = 0.0;
+        for (size_t d = 0; d < dims; ++d) {
+          const double diff = points.Get(i, d) - centroids[ids[i] * dims + d];
+          dist += diff * diff;
+        }
+        sensitivity[i] = weights[i] * dist;
+        cost += sensitivity[i];
+        cluster_weight[ids[i]] += weights[i];
+      }
+      double total = 0.0;
+      for (size_t i = 0; i < n; ++i) {
+        const double s = ((cost > 0.0) ? sensitivity[i] / cost : 0.0) + weights[i] / cluster_weight[ids[i]];
+        total += s;
+        sensitivity[i] = total;   // Running sum, for sampling by binary search.
+      }
+
+      // m i.i.d. draws; a point drawn more than once just collects more weight.
+      picked.assign(n, 0.0);
+      for (size_t draw = 0; draw < coreset_size; ++draw) {
+        const double target = random.GetDouble(total);
+        const size_t i = std::min((size_t) (std::upper_bound(sensitivity.begin(), sensitivity.end(), target) - sensitivity.begin()), n - 1);
+        const double q = (sensitivity[i] - (i ? sensitivity[i - 1] : 0.0)) / total;
+        picked[i] += weights[i] / ((double) coreset_size * q);
+      }
+      PointSet reduced(dims);
+      emp::vector<double> reduced_weights;
+      emp::vector<double> pt(dims);
+      for (size_t i = 0; i < n; ++i) {
+        if (picked[i] <= 0.0) continue;
+        points.GetPoint(i, pt.data());
+        reduced.AddPoint(pt.data());
+        reduced_weights.push_back(picked[i]);
+      }
+      points = std::move(reduced);
+      weights = std::move(reduced_weights);
+    }
+
+    /// Append (src, src_weights) to (dest, dest_weights).
+    void Append(const PointSet & src, const emp::vector<double> & src_weights, PointSet & dest,
+                emp::vector<double> & dest_weights) const {
+      emp::vector<double> pt(dims);
+      for (size_t i = 0; i < src.GetSize(); ++i) {
+        src.GetPoint(i, pt.data());
+        dest.AddPoint(pt.data());
+      }
+      dest_weights.insert(dest_weights.end(), src_weights.begin(), src_weights.end());
+    }
+
+    /// Carry a coreset up the levels, merging and reducing with each occupied level it meets.
+    void Carry(PointSet & set, emp::vector<double> & weights, emp::Random & random) {
+      size_t level = 0;
+      while (level < levels.size() && !levels[level].IsEmpty()) {
+        Append(levels[level], level_weights[level], set, weights);
+        Reduce(set, weights, random);
+        levels[level].Reset(dims);
+        level_weights[level].clear();
+        ++level;
+      }
+      if (level == levels.size()) { levels.emplace_back(dims); level_weights.emplace_back(); }
+      levels[level] = std::move(set);
+      level_weights[level] = std::move(weights);
+      set.Reset(dims);
+      weights.clear();
+    }
+
+  public:
+    /// Summarize for k-means with K = k, keeping coresets of coreset_size points.
+    CoresetBuilder(size_t k, size_t _dims, size_t _coreset_size = 4096)
+      : num_clusters(std::max<size_t>(k, 1)), dims(_dims), coreset_size(std::max(_coreset_size, num_clusters)),
+        points_seen(0), weight_seen(0.0), buffer(_dims), buffer_weights(), levels(), level_weights(),
+        rough(), sensitivity(), picked() { ; }
+
+    size_t GetK() const { return num_clusters; }
+    size_t GetDims() const { return dims; }
+    size_t GetCoresetSize() const { return coreset_size; }
+    size_t GetPointsSeen() const { return points_seen; }
+    double GetWeightSeen() const { return weight_seen; }
+    size_t GetNumLevels() const { return levels.size(); }
+
+    /// How many points are held right now (buffer plus every level).
+    size_t GetHeldPoints() const {
+      size_t held = buffer.GetSize();
+      for (const PointSet & level : levels) held += level.GetSize();
+      return held;
+    }
+
+    /// Start over with (possibly) new dimensionality.
+    void Reset(size_t _dims) {
+      dims = _dims;
+      points_seen = 0;
+      weight_seen = 0.0;
+      buffer.Reset(dims);
+      buffer_weights.clear();
+      levels.clear();
+      level_weights.clear();
+    }
+
+    /// Stream in one point (weight > 0; e.g., an already-summarized point).
+    void AddPoint(const double * pt, emp::Random & random, double weight = 1.0) {
+      buffer.AddPoint(pt);
+      buffer_weights.push_back(weight);
+      ++points_seen;
+      weight_seen += weight;
+      if (buffer.GetSize() == coreset_size) Carry(buffer, buffer_weights, random);
+    }
+
+    /// Stream in every point of a set.
+    void AddPoints(const PointSet & points, emp::Random & random) {
+      emp::vector<double> pt(dims);
+      for (size_t i = 0; i < points.GetSize(); ++i) {
+        points.GetPoint(i, pt.data());
+        AddPoint(pt.data(), random);
+      }
+    }
+
+    /// The coreset for everything streamed so far: the union of all levels and the buffer,
+    /// reduced to at most m points. Streaming can continue afterwards.
+    void GetCoreset(emp::Random & random, PointSet & out, emp::vector<double> & out_weights) {
+      out.Reset(dims);
+      out_weights.clear();
+      Append(buffer, buffer_weights, out, out_weights);
+      for (size_t level = 0; level < levels.size(); ++level) Append(levels[level], level_weights[level], out, out_weights);
+      Reduce(out, out_weights, random);
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,284 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Incremental k-means state for interactive editing. Keeps per-cluster running sums, so
+//  inserting or removing a point updates its centroid in O(dims), and only re-checks the points
+//  whose assignment could have been affected.
+//
+//  Every point carries Hamerly-style bounds: an upper bound on the distance to its own centroid and
+//  a lower bound on the distance to any other centroid. Bounds are stored relative to cumulative
+//  drift counters (per-cluster for upper bounds, global for lower bounds), so moving a centroid
+//  loosens every bound in O(1). Each cluster keeps a max-heap of (upper - lower) gaps; Refine()
+//  pops just the points whose loosened bounds overlap and re-checks those exactly.
+
+#ifndef CLUSTERING_INCREMENTAL_KMEANS_H
+#define CLUSTERING_INCREMENTAL_KMEANS_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include "base/vector.h"
+
+#include "PointSet.h"
+
+namespace clustering {
+
+  class IncrementalKMeans {
+  protected:
+    /// Heap entry: a point and the gap between its stored bounds (stale if version doesn't match).
+    struct GapEntry {
+      double gap;
+      size_t point;
+      size_t version;
+      bool operator<(const GapEntry & other) const { return gap < other.gap; }
+    };
+
+    static constexpr double TOLERANCE = 1e-9;   //< Relative slack so rounding never hides a violation.
+
+    size_t num_clusters;               //< K
+    size_t dims;
+    emp::vector<double> centroids;     //< Row-major K x dims.
+    emp::vector<double> sums;          //< Running per-cluster coordinate sums.
+    emp::vector<size_t> counts;        //< Running per-cluster point counts.
+    emp::vector<size_t> assignments;   //< Cluster of each point.
+    emp::vector<double> upper;         //< Stored upper bound (effective = upper + cluster_drift[a]).
+    emp::vector<double> lower;         //< Stored lower bound (effective = lower - total_drift).
+    emp::vector<size_t> versions;      //< Bumped whenever a point's heap entry is superseded.
+    emp::vector<double> cluster_drift; //< Cumulative distance each centroid has moved.
+    double total_drift;                //< Cumulative distance all centroids have moved.
+    emp::vector<std::priority_queue<GapEntry>> gaps;  //< Per-cluster max-heaps of bound gaps.
+    emp::vector<size_t> changed;       //< Points whose assignment changed since ClearChanged().
+    emp::vector<double> point_buf;
+    size_t num_checks;                 //< Exact re-checks performed (for stats).
+    size_t next_version;
+    bool ready;
+
+    double SquaredDistance(const double * pt, size_t c) const {
+      double dist = 0.0;
+      for (size_t d = 0; d < dims; ++d) {
+        const double diff = pt[d] - centroids[c * dims + d];
+        dist += diff * diff;
+      }
+      return dist;
+    }
+
+    /// Exact nearest and second-nearest centroid of pt.
+    size_t FindNearest(const double * pt, double & best, double & second) const {
+      best = second = std::numeric_limits<double>::max();
+      size_t best_id = 0;
+      for (size_t c = 0; c < num_clusters; ++c) {
+        const double dist = SquaredDistance(pt, c);
+        if (dist < best) { second = best; best = dist; best_id = c; }
+        else if (dist < second) second = dist;
+      }
+      best = std::sqrt(best);
+      second = std::sqrt(second);
+      return best_id;
+    }
+
+    /// Record exact bounds for point i (assigned to a) against the current drift counters.
+    GapEntry StoreBounds(size_t i, size_t a, double dist, double second, bool push = true) {
+      upper[i] = dist - cluster_drift[a];
+      lower[i] = second + total_drift;
+      versions[i] = next_version++;
+      const GapEntry entry{upper[i] - lower[i], i, versions[i]};
+      if (push) gaps[a].push(entry);
+      return entry;
+    }
+
+    /// Recompute centroid c from its running sums and charge the movement to the drift counters.
+    void MoveCentroid(size_t c) {
+      if (counts[c] == 0) return;   // Empty clusters keep their old position.
+      double moved = 0.0;
+      for (size_t d = 0; d < dims; ++d) {
+        const double next = sums[c * dims + d] / (double) counts[c];
+        const double diff = next - centroids[c * dims + d];
+        moved += diff * diff;
+        centroids[c * dims + d] = next;
+      }
+      moved = std::sqrt(moved);
+      cluster_drift[c] += moved;
+      total_drift += moved;
+    }
+
+    void AddToCluster(const double * pt, size_t c, double sign) {
+      for (size_t d = 0; d < dims; ++d) sums[c * dims + d] += sign * pt[d];
+      if (sign > 0) ++counts[c]; else --counts[c];
+    }
+
+    /// Could point i's assignment be wrong? (Its loosened bounds overlap.)
+    bool IsViolated(double gap, size_t a) const {
+      const double threshold = -(cluster_drift[a] + total_drift);
+      return gap >= threshold - TOLERANCE * (1.0 + std::abs(threshold) + std::abs(gap));
+    }
+
+  public:
+    IncrementalKMeans()
+      : num_clusters(0), dims(0), centroids(), sums(), counts(), assignments(), upper(), lower(),
+        versions(), cluster_drift(), total_drift(0.0), gaps(), changed(), point_buf(),
+        num_checks(0), next_version(0), ready(false) { ; }
+
+    bool IsReady() const { return ready; }
+    size_t GetK() const { return num_clusters; }
+    size_t GetSize() const { return assignments.size(); }
+    size_t GetAssignment(size_t i) const { return assignments[i]; }
+    const emp::vector<size_t> & GetAssignments() const { return assignments; }
+    const double * GetCentroid(size_t c) const { return centroids.data() + c * dims; }
+    size_t GetNumChecks() const { return num_checks; }
+
+    /// Points whose assignment changed since the last ClearChanged() (may contain repeats).
+    const emp::vector<size_t> & GetChanged() const { return changed; }
+    void ClearChanged() { changed.clear(); }
+
+    /// Forget everything; the next Init() starts over.
+    void Clear() {
+      ready = false;
+      assignments.clear();
+      gaps.clear();
+      changed.clear();
+    }
+
+    /// Start from an existing clustering (e.g., a converged KMeans run). O(nK).
+    void Init(const PointSet & points, size_t k, const emp::vector<size_t> & start_assignments) {
+      const size_t n = points.GetSize();
+      num_clusters = std::max<size_t>(k, 1);
+      dims = points.GetDims();
+      sums.assign(num_clusters * dims, 0.0);
+      counts.assign(num_clusters, 0);
+      centroids.assign(num_clusters * dims, 0.0);
+      point_buf.resize(dims);
+      for (size_t i = 0; i < n; ++i) {
+        points.GetPoint(i, point_buf.data());
+        AddToCluster(point_buf.data(), start_assignments[i], 1.0);
+      }
+      for (size_t c = 0; c < num_clusters; ++c) {
+        if (counts[c] == 0) continue;
+        for (size_t d = 0; d < dims; ++d) centroids[c * dims + d] = sums[c * dims + d] / (double) counts[c];
+      }
+      assignments = start_assignments;
+      upper.resize(n);
+      lower.resize(n);
+      versions.resize(n);
+      cluster_drift.assign(num_clusters, 0.0);
+      total_drift = 0.0;
+      gaps.assign(num_clusters, std::priority_queue<GapEntry>());
+      changed.clear();
+      num_checks = 0;
+      next_version = 0;
+      ready = true;
+      // Points that aren't at their nearest centroid yet will show up as violations in Refine().
+      for (size_t i = 0; i < n; ++i) {
+        points.GetPoint(i, point_buf.data());
+        const size_t a = assignments[i];
+        double best, second;
+        FindNearest(point_buf.data(), best, second);
+        // Upper bound = distance to own centroid; lower = nearest *other* centroid (which is
+        // 'best' if we're not currently at the nearest one).
+        const double own = std::sqrt(SquaredDistance(point_buf.data(), a));
+        StoreBounds(i, a, own, (own <= best) ? second : best);
+      }
+    }
+
+    /// The last point in points was just added: assign it and update its centroid. O(K * dims).
+    /// Call Refine() afterwards to repair any other assignments the moved centroid affects.
+    size_t InsertPoint(const PointSet & points) {
+      const size_t i = points.GetSize() - 1;
+      points.GetPoint(i, point_buf.data());
+      double best, second;
+      const size_t a = FindNearest(point_buf.data(), best, second);
+      assignments.push_back(a);
+      upper.push_back(0.0);
+      lower.push_back(0.0);
+      versions.push_back(0);
+      StoreBounds(i, a, best, second);
+      AddToCluster(point_buf.data(), a, 1.0);
+      MoveCentroid(a);
+      changed.push_back(i);
+      return a;
+    }
+
+    /// Remove point i from points (the last point takes its index, as in PointSet::SwapRemove()) and
+    /// update its centroid. Call Refine() afterwards.
+    void RemovePoint(PointSet & points, size_t i) {
+      points.GetPoint(i, point_buf.data());
+      const size_t a = assignments[i];
+      AddToCluster(point_buf.data(), a, -1.0);
+      MoveCentroid(a);
+      const size_t last = assignments.size() - 1;
+      points.SwapRemove(i);
+      if (i != last) {
+        // The last point moves into slot i: re-file its heap entry under the new index.
+        assignments[i] = assignments[last];
+        upper[i] = upper[last];
+        lower[i] = lower[last];
+        versions[i] = next_version++;
+        gaps[assignments[i]].push(GapEntry{upper[i] - lower[i], i, versions[i]});
+        changed.push_back(i);
+      }
+      assignments.pop_back();
+      upper.pop_back();
+      lower.pop_back();
+      versions.pop_back();
+    }
+
+    /// Re-check points whose bounds were loosened too far, moving them (and their centroids) as
+    /// needed, until everything is consistent or max_checks exact checks have been made.
+    /// Returns true if the state is stable (every point is at its nearest centroid).
+    bool Refine(const PointSet & points, size_t max_checks = std::numeric_limits<size_t>::max()) {
+      size_t checks = 0;
+      bool found = true;
+      // Points exactly tied between two centroids stay violated even with exact bounds; park them
+      // until the end of this pass so they don't get re-checked forever.
+      emp::vector<std::pair<size_t, GapEntry>> parked;
+      auto file = [this, &parked](size_t c, const GapEntry & entry) {
+        if (IsViolated(entry.gap, c)) parked.emplace_back(c, entry);
+        else gaps[c].push(entry);
+      };
+      auto unpark = [this, &parked]() { for (const auto & p : parked) gaps[p.first].push(p.second); };
+      while (found) {
+        found = false;
+        for (size_t a = 0; a < num_clusters; ++a) {
+          auto & heap = gaps[a];
+          while (!heap.empty()) {
+            const GapEntry top = heap.top();
+            const bool stale = top.point >= assignments.size() || versions[top.point] != top.version
+                               || assignments[top.point] != a;
+            if (stale) { heap.pop(); continue; }
+            if (!IsViolated(top.gap, a)) break;
+            if (checks == max_checks) { unpark(); return false; }
+            heap.pop();
+            ++checks;
+            ++num_checks;
+            found = true;
+            const size_t i = top.point;
+            points.GetPoint(i, point_buf.data());
+            double best, second;
+            const size_t b = FindNearest(point_buf.data(), best, second);
+            const double own = std::sqrt(SquaredDistance(point_buf.data(), a));
+            if (b == a || own <= best) {
+              file(a, StoreBounds(i, a, own, (b == a) ? second : best, false));
+              continue;
+            }
+            // Move i from a to b: store exact bounds first, then charge both centroid moves.
+            assignments[i] = b;
+            file(b, StoreBounds(i, b, best, second, false));
+            AddToCluster(point_buf.data(), a, -1.0);
+            AddToCluster(point_buf.data(), b, 1.0);
+            MoveCentroid(a);
+            MoveCentroid(b);
+            changed.push_back(i);
+          }
+        }
+      }
+      unpark();
+      return true;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,381 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  UI-free k-means (Lloyd's algorithm) engine over a PointSet. Used by both the native
+//  command-line tool and the web demo (KMeansExample).
+//
+//  The assignment step can run naively (every point against every centroid, SIMD kernel), use
+//  triangle-inequality bounds (Hamerly or Elkan) to skip most distance computations once the
+//  centroids start settling, or filter candidate centroids down a kd-tree (low dimensionality).
+//  All strategies produce identical assignments. (The kd-tree strategy sums centroids from cached
+//  per-node sums, so its centroids can differ from the others' in the last bits.)
+//
+//  Assignment and centroid accumulation are split across a ThreadPool (SetNumThreads()); results
+//  are bit-for-bit reproducible for a fixed thread count.
+//
+//  Points may carry weights (SetWeights(); e.g., a coreset standing in for a much larger set):
+//  seeding, centroid means and inertia then treat a point of weight w as w copies of itself.
+//
+//  The engine is templated on the coordinate type: KMeans clusters a PointSet (double), KMeansF a
+//  PointSetF (float32). In float32, points and the centroid copy the distances are measured
+//  against are single precision (twice the SIMD lanes, half the memory traffic), while centroid
+//  sums, the centroids themselves and the inertia stay in double, so rounding doesn't pile up over
+//  large clusters. Pick one at run time by loading the points into either kind of set.
+
+#ifndef CLUSTERING_KMEANS_H
+#define CLUSTERING_KMEANS_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+#include "tools/random_utils.h"
+
+#include "PointSet.h"
+#include "AssignKernel.h"
+#include "AcceleratedAssign.h"
+#include "KdTreeFilter.h"
+#include "Seeding.h"
+#include "ThreadPool.h"
+
+namespace clustering {
+
+  /// How should the assignment step find each point's nearest centroid?
+  enum class AssignStrategy { AUTO, NAIVE, HAMERLY, ELKAN, KDTREE };
+
+  inline const char * GetAssignStrategyName(AssignStrategy strategy) {
+    switch (strategy) {
+      case AssignStrategy::NAIVE: return "naive";
+      case AssignStrategy::HAMERLY: return "hamerly";
+      case AssignStrategy::ELKAN: return "elkan";
+      case AssignStrategy::KDTREE: return "kdtree";
+      default: return "auto";
+    }
+  }
+
+  /// Parse a strategy name (as printed by GetAssignStrategyName). Returns false if unknown.
+  inline bool ParseAssignStrategy(const std::string & name, AssignStrategy & strategy) {
+    for (AssignStrategy s : { AssignStrategy::AUTO, AssignStrategy::NAIVE, AssignStrategy::HAMERLY, AssignStrategy::ELKAN,
+                              AssignStrategy::KDTREE }) {
+      if (name == GetAssignStrategyName(s)) { strategy = s; return true; }
+    }
+    return false;
+  }
+
+  /// Summary of a k-means run.
+  struct KMeansResult {
+    size_t iterations;  //< How many iterations did we run?
+    double inertia;     //< Sum of squared distances from each point to its centroid.
+    bool converged;     //< Did we stop because assignments stopped changing?
+  };
+
+  template <typename T>
+  class BasicKMeans {
+  protected:
+    size_t num_clusters;              //< K
+    size_t dims;                      //< Dimensionality of the points being clustered.
+    size_t iteration;                 //< What iteration of the algorithm are we on?
+    emp::vector<size_t> assignments;  //< Which cluster does each point belong to?
+    emp::vector<double> centroids;    //< Flat (row-major) K x dims centroid buffer.
+    ThreadBuffers<double> sums;       //< Scratch: per-thread, per-cluster coordinate sums.
+    ThreadBuffers<size_t> counts;     //< Scratch: per-thread, per-cluster point counts.
+    ThreadBuffers<double> masses;     //< Scratch: per-thread, per-cluster weight totals (weighted only).
+    emp::vector<double> weights;      //< Per-point weights (empty = all 1).
+    emp::vector<size_t> thread_changed; //< Scratch: per-thread changed-assignment counts.
+    emp::vector<T> kernel_centroids;  //< Centroids rounded to T: what distances are measured against.
+    emp::vector<const T *> cols;      //< Scratch: column pointers handed to the assignment kernel.
+    emp::vector<T> centroids_t;       //< Scratch: centroids transposed to dims x K for the kernel.
+    emp::vector<size_t> nearest;      //< Scratch: kernel output (nearest centroid per point).
+    emp::vector<T> nearest_dist;      //< Scratch: kernel output (squared distance to it).
+    emp::vector<T> old_centroids;     //< Scratch: kernel centroids before the update (for drift).
+    emp::vector<double> drift;        //< Scratch: how far each centroid moved in the last update.
+
+    AssignStrategy strategy;          //< Requested assignment strategy.
+    AssignStrategy active_strategy;   //< Strategy actually in use (AUTO resolved).
+    HamerlyBounds<T> hamerly;
+    ElkanBounds<T> elkan;
+    KdTreeFilter<T> kdtree;
+    bool sums_ready;                  //< Did the last assignment already fill sums/counts (kd-tree)?
+    size_t dist_computed;             //< Point-centroid distances evaluated since Reset().
+    size_t dist_naive;                //< ...and how many the naive loop would have evaluated.
+    SeedMethod seed_method;           //< How are initial centroids chosen?
+    ThreadPool pool;                  //< Worker threads (just the caller by default).
+
+    /// Pick a concrete strategy for AUTO. The naive SIMD kernel is hard to beat when there are too
+    /// few centroids to prune. At low dimensionality kd-tree filtering overtakes it from about
+    /// K = 32 (see the native tool's --crossover benchmark); bounds only kick in for larger K.
+    /// Hamerly keeps O(n) bounds and wins at moderate dimensionality; Elkan's per-centroid
+    /// bounds pay off at high dimensionality, as long as the n x K bound table stays modest.
+    AssignStrategy ResolveStrategy(size_t num_points) const {
+      if (strategy != AssignStrategy::AUTO) return strategy;
+      if (dims < 8) return (num_clusters >= 32) ? AssignStrategy::KDTREE : AssignStrategy::NAIVE;
+      if (num_clusters < 48) return AssignStrategy::NAIVE;
+      const size_t ELKAN_MAX_BOUNDS = (size_t) 1 << 26;   // 512 MB of lower bounds.
+      if (dims >= 32 && num_clusters >= 64 && num_points * num_clusters <= ELKAN_MAX_BOUNDS) {
+        return AssignStrategy::ELKAN;
+      }
+      return AssignStrategy::HAMERLY;
+    }
+
+    void InvalidateBounds() { hamerly.Invalidate(); elkan.Invalidate(); }
+
+    void LoadColumns(const BasicPointSet<T> & points) {
+      cols.resize(dims);
+      for (size_t d = 0; d < dims; ++d) cols[d] = points.GetColumn(d);
+    }
+
+    void RoundCentroids() { kernel_centroids.assign(centroids.begin(), centroids.end()); }
+
+    void TransposeCentroids() {
+      centroids_t.resize(num_clusters * dims);
+      for (size_t c = 0; c < num_clusters; ++c) {
+        for (size_t d = 0; d < dims; ++d) centroids_t[d * num_clusters + c] = kernel_centroids[c * dims + d];
+      }
+    }
+
+    /// Assign each point to its nearest centroid. Returns how many assignments changed.
+    size_t AssignNearest(const BasicPointSet<T> & points) {
+      const size_t n = points.GetSize();
+      LoadColumns(points);
+      RoundCentroids();
+      dist_naive += n * num_clusters;
+      if (active_strategy == AssignStrategy::HAMERLY) {
+        return hamerly.Assign(points, cols.data(), kernel_centroids.data(), num_clusters, assignments, pool, dist_computed);
+      }
+      if (active_strategy == AssignStrategy::ELKAN) {
+        return elkan.Assign(points, cols.data(), kernel_centroids.data(), num_clusters, assignments, pool, dist_computed);
+      }
+      if (active_strategy == AssignStrategy::KDTREE) {
+        sums_ready = weights.empty();   // Cached node sums are unweighted.
+        return kdtree.Assign(points, kernel_centroids.data(), num_clusters, assignments, sums, counts, pool, dist_computed);
+      }
+      dist_computed += n * num_clusters;
+      TransposeCentroids();
+      nearest.resize(n);
+      nearest_dist.resize(n);
+      thread_changed.assign(pool.GetNumThreads(), 0);
+      pool.ForRanges(n, [this](size_t t, size_t begin, size_t end) {
+        AssignNearestBlock(cols.data(), dims, begin, end, centroids_t.data(), num_clusters, nearest.data(), nearest_dist.data());
+        size_t changed = 0;
+        for (size_t i = begin; i < end; ++i) {
+          if (assignments[i] != nearest[i]) { assignments[i] = nearest[i]; ++changed; }
+        }
+        thread_changed[t] = changed;
+      });
+      size_t changed = 0;
+      for (size_t count : thread_changed) changed += count;
+      return changed;
+    }
+
+    /// Sum each cluster's members into sums/counts buffer 0. Each thread sums its own range of
+    /// points into a private buffer; the buffers are then combined with a fixed-shape tree, so
+    /// results are bit-identical for a given thread count.
+    void AccumulateCentroids(const BasicPointSet<T> & points) {
+      const size_t num_threads = pool.GetNumThreads();
+      const bool weighted = !weights.empty();
+      sums.Resize(num_threads, num_clusters * dims);
+      counts.Resize(num_threads, num_clusters);
+      if (weighted) masses.Resize(num_threads, num_clusters);
+      pool.ForRanges(points.GetSize(), [this, &points, weighted](size_t t, size_t begin, size_t end) {
+        sums.Clear(t);
+        counts.Clear(t);
+        double * thread_sums = sums.Get(t);
+        size_t * thread_counts = counts.Get(t);
+        if (weighted) {
+          masses.Clear(t);
+          double * thread_masses = masses.Get(t);
+          for (size_t d = 0; d < dims; ++d) {
+            const T * col = points.GetColumn(d);
+            for (size_t i = begin; i < end; ++i) thread_sums[assignments[i] * dims + d] += weights[i] * col[i];
+          }
+          for (size_t i = begin; i < end; ++i) thread_masses[assignments[i]] += weights[i];
+        } else {
+          for (size_t d = 0; d < dims; ++d) {
+            const T * col = points.GetColumn(d);
+            for (size_t i = begin; i < end; ++i) thread_sums[assignments[i] * dims + d] += col[i];
+          }
+        }
+        for (size_t i = begin; i < end; ++i) ++thread_counts[assignments[i]];
+      });
+      sums.TreeReduce(pool);
+      counts.TreeReduce(pool);
+      if (weighted) masses.TreeReduce(pool);
+    }
+
+    /// Move each centroid to the mean of its members. Empty clusters keep their old position.
+    /// (The kd-tree strategy already summed each cluster during assignment.)
+    void UpdateCentroids(const BasicPointSet<T> & points) {
+      if (sums_ready) sums_ready = false;
+      else AccumulateCentroids(points);
+      const double * total_sums = sums.Get(0);
+      const size_t * total_counts = counts.Get(0);
+      const double * total_masses = weights.empty() ? nullptr : masses.Get(0);
+      for (size_t c = 0; c < num_clusters; ++c) {
+        if (total_counts[c] == 0) continue;
+        const double mass = total_masses ? total_masses[c] : (double)total_counts[c];
+        if (mass <= 0.0) continue;
+        for (size_t d = 0; d < dims; ++d) centroids[c * dims + d] = total_sums[c * dims + d] / mass;
+      }
+    }
+
+    /// After UpdateCentroids(): measure how far each centroid moved and loosen the bounds.
+    void UpdateBounds() {
+      if (active_strategy == AssignStrategy::NAIVE || active_strategy == AssignStrategy::KDTREE) return;
+      RoundCentroids();
+      drift.resize(num_clusters);
+      for (size_t c = 0; c < num_clusters; ++c) {
+        double dist = 0.0;
+        for (size_t d = 0; d < dims; ++d) {
+          const double diff = (double) kernel_centroids[c * dims + d] - (double) old_centroids[c * dims + d];
+          dist += diff * diff;
+        }
+        drift[c] = std::sqrt(dist);
+      }
+      if (active_strategy == AssignStrategy::HAMERLY) hamerly.ApplyDrift(drift.data(), num_clusters, assignments, pool);
+      else elkan.ApplyDrift(drift.data(), num_clusters, assignments, pool);
+    }
+
+  public:
+    BasicKMeans(size_t k = 1) : num_clusters(std::max<size_t>(k, 1)), dims(0), iteration(0),
+                                assignments(), centroids(), sums(), counts(), masses(), weights(), thread_changed(),
+                                kernel_centroids(), cols(), centroids_t(), nearest(), nearest_dist(), old_centroids(),
+                                drift(), strategy(AssignStrategy::AUTO), active_strategy(AssignStrategy::NAIVE),
+                                hamerly(), elkan(), kdtree(), sums_ready(false), dist_computed(0), dist_naive(0),
+                                seed_method(SeedMethod::KMEANS_PLUS_PLUS), pool(1) { ; }
+
+    size_t GetK() const { return num_clusters; }
+    size_t GetIteration() const { return iteration; }
+    const emp::vector<size_t> & GetAssignments() const { return assignments; }
+    size_t GetAssignment(size_t i) const { return assignments[i]; }
+    const emp::vector<double> & GetCentroids() const { return centroids; }
+    const double * GetCentroid(size_t c) const { return centroids.data() + c * dims; }
+    AssignStrategy GetStrategy() const { return strategy; }
+    AssignStrategy GetActiveStrategy() const { return active_strategy; }
+
+    /// Fraction of point-centroid distance computations skipped (vs. the naive loop) since Reset().
+    double GetSkippedRatio() const {
+      return dist_naive ? 1.0 - (double) dist_computed / (double) dist_naive : 0.0;
+    }
+    size_t GetDistanceCount() const { return dist_computed; }
+
+    SeedMethod GetSeedMethod() const { return seed_method; }
+    size_t GetNumThreads() const { return pool.GetNumThreads(); }
+
+    /// Choose how the initial centroids are picked (takes effect on the next Reset()).
+    void SetSeedMethod(SeedMethod method) { seed_method = method; }
+    /// How many threads should the engine use? (0 = one per hardware thread.)
+    void SetNumThreads(size_t num_threads) { pool.SetNumThreads(num_threads); }
+
+    /// Choose how assignments are computed. Doesn't change the results, only how fast they arrive.
+    void SetStrategy(AssignStrategy _strategy) { strategy = _strategy; InvalidateBounds(); }
+
+    /// Set the number of clusters; resets the algorithm.
+    void SetK(size_t k) { num_clusters = std::max<size_t>(k, 1); Reset(); }
+
+    /// The points were edited in place (or removed and re-added, keeping the count): drop anything
+    /// built over them (bounds and the kd-tree). Changes in size or dimensionality are detected.
+    void InvalidatePoints() { InvalidateBounds(); kdtree.Invalidate(); }
+
+    /// Weight each point (one positive weight per point, in the order of the PointSet passed to
+    /// Step/Run; e.g., a coreset's weights). Empty means every point has weight 1. Resets the
+    /// algorithm.
+    void SetWeights(const emp::vector<double> & _weights) { weights = _weights; Reset(); }
+    const emp::vector<double> & GetWeights() const { return weights; }
+
+    /// Start from the given centroids (row-major K x dims, e.g., a warm start from a related
+    /// solution) instead of seeding: the next Step assigns every point to them.
+    void SetCentroids(const emp::vector<double> & _centroids) {
+      Reset();
+      dims = _centroids.size() / num_clusters;
+      centroids = _centroids;
+      iteration = 1;
+    }
+
+    /// Start over (next Step re-initializes memberships). Anything built over the points alone
+    /// (the kd-tree) is kept; call InvalidatePoints() if they were edited.
+    void Reset() {
+      iteration = 0;
+      assignments.clear();
+      centroids.assign(num_clusters * dims, 0.0);
+      InvalidateBounds();
+      dist_computed = dist_naive = 0;
+    }
+
+    /// Take a single iteration of the k-means algorithm. Returns how many points changed clusters.
+    /// Iteration 0 seeds the centroids (k-means++ or k-means||) and assigns every point to its
+    /// nearest one, or with SeedMethod::RANDOM_PARTITION randomly partitions the points into K
+    /// equal-ish groups.
+    size_t Step(const BasicPointSet<T> & points, emp::Random & random) {
+      // If no points have been laid down... do nothing.
+      if (points.IsEmpty()) return 0;
+      if (points.GetDims() != dims || assignments.size() != points.GetSize()) {
+        // Data changed underneath us: make sure our buffers fit.
+        dims = points.GetDims();
+        centroids.resize(num_clusters * dims, 0.0);
+        assignments.resize(points.GetSize(), 0);
+        InvalidatePoints();
+      }
+      const AssignStrategy next_strategy = ResolveStrategy(points.GetSize());
+      if (next_strategy != active_strategy) { active_strategy = next_strategy; InvalidateBounds(); }
+      size_t changed;
+      if (iteration == 0 && seed_method == SeedMethod::RANDOM_PARTITION) {
+        for (size_t i = 0; i < assignments.size(); ++i) { assignments[i] = i % num_clusters; }
+        emp::Shuffle(random, assignments);
+        changed = assignments.size();
+      } else if (iteration == 0) {
+        const double * seed_weights = weights.empty() ? nullptr : weights.data();
+        if (seed_method == SeedMethod::KMEANS_PARALLEL) SeedKMeansParallel(points, num_clusters, random, pool, centroids, seed_weights);
+        else SeedKMeansPlusPlus(points, num_clusters, random, pool, centroids, seed_weights);
+        InvalidateBounds();
+        AssignNearest(points);
+        changed = assignments.size();
+      } else {
+        changed = AssignNearest(points);
+      }
+      if (active_strategy == AssignStrategy::HAMERLY || active_strategy == AssignStrategy::ELKAN) {
+        RoundCentroids();
+        old_centroids = kernel_centroids;
+      }
+      UpdateCentroids(points);
+      UpdateBounds();
+      ++iteration;
+      return changed;
+    }
+
+    /// Iterate until assignments stop changing (or max_iterations is reached).
+    KMeansResult Run(const BasicPointSet<T> & points, emp::Random & random, size_t max_iterations = 300) {
+      KMeansResult result{0, 0.0, false};
+      while (result.iterations < max_iterations) {
+        const size_t changed = Step(points, random);
+        ++result.iterations;
+        if (changed == 0) { result.converged = true; break; }
+      }
+      result.inertia = Inertia(points);
+      return result;
+    }
+
+    /// Sum of squared distances from each point to its assigned centroid (times its weight).
+    double Inertia(const BasicPointSet<T> & points) const {
+      double total = 0.0;
+      for (size_t i = 0; i < assignments.size(); ++i) {
+        double dist = 0.0;
+        for (size_t d = 0; d < dims; ++d) {
+          const double diff = (double) points.Get(i, d) - centroids[assignments[i] * dims + d];
+          dist += diff * diff;
+        }
+        total += weights.empty() ? dist : weights[i] * dist;
+      }
+      return total;
+    }
+  };
+
+  using KMeans = BasicKMeans<double>;
+  using KMeansF = BasicKMeans<float>;
+
+}
+
+#endif
@@ -0,0 +1,339 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Automatic K selection: cluster for every K in a range and score each solution.
+//  - Silhouette, approximated on a fixed random sample of points: pairwise distances within the
+//    sample are computed once and reused for every K, so each K costs O(S^2) instead of O(n^2).
+//  - BIC of a spherical Gaussian mixture (as in X-means; Pelleg & Moore, 2000).
+//  - Gap statistic (Tibshirani et al., 2001) against uniform reference sets drawn from the data's
+//    bounding box. References are small (gap_ref_size points), so dispersion is compared per
+//    point: log(W_k / n).
+//
+//  Warm starts: each K starts from the K - 1 solution with its worst cluster (largest SSE) split
+//  in two along its principal axis, which usually converges in a few iterations. That makes the
+//  chain of K values sequential, so the range is cut into contiguous segments of segment_length K
+//  values; each segment seeds its first K with k-means++ (from its own seed) and warm-starts the
+//  rest, and threads take whole segments. The layout and seeds don't depend on the thread count,
+//  so neither do the scores or the chosen K. A fresh seeding can land in a worse local optimum
+//  than the warm start would have (inertia may tick up at a segment's first K), so each row
+//  reports the segment it came from.
+
+#ifndef CLUSTERING_K_SWEEP_H
+#define CLUSTERING_K_SWEEP_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "PointSet.h"
+#include "KMeans.h"
+#include "Seeding.h"
+#include "ThreadPool.h"
+
+namespace clustering {
+
+  /// Scores for one K.
+  struct KSweepRow {
+    size_t k;
+    size_t iterations;  //< Lloyd iterations (after the warm start, if any).
+    bool converged;
+    double inertia;     //< Sum of squared distances to assigned centroids.
+    double silhouette;  //< Mean silhouette over the sample (-1..1; higher is better).
+    double bic;         //< Higher is better.
+    double gap;         //< Gap statistic (0 if gap references are disabled).
+    double gap_sd;      //< Its standard error (s_k).
+    double seconds;     //< Time spent clustering this K (including its gap references).
+    size_t segment;     //< Warm-start segment this K came from (its first K is seeded fresh).
+  };
+
+  struct KSweepResult {
+    emp::vector<KSweepRow> rows;   //< One per K, ascending.
+    size_t best_silhouette = 0;    //< K with the highest silhouette.
+    size_t best_bic = 0;           //< K with the highest BIC.
+    size_t best_gap = 0;           //< Smallest K with gap(K) >= gap(K + 1) - s(K + 1).
+  };
+
+  class KSweep {
+  protected:
+    size_t k_min;
+    size_t k_max;
+    size_t max_iterations;           //< Per K.
+    size_t silhouette_sample;        //< Points in the silhouette sample (S).
+    size_t gap_refs;                 //< Uniform reference sets for the gap statistic (B; 0 = off).
+    size_t gap_ref_size;             //< Points per reference set.
+    size_t segment_length;           //< K values per warm-start segment (0 = one segment).
+    ThreadPool pool;
+
+    emp::vector<size_t> sample_ids;     //< Silhouette sample.
+    emp::vector<double> sample_dists;   //< S x S distances within the sample.
+
+    void PrepareSilhouette(const PointSet & points, emp::Random & random) {
+      const size_t n = points.GetSize();
+      const size_t dims = points.GetDims();
+      const size_t S = std::min(n, silhouette_sample);
+      // Partial Fisher-Yates: S distinct points.
+      emp::vector<size_t> ids(n);
+      for (size_t i = 0; i < n; ++i) ids[i] = i;
+      for (size_t i = 0; i < S; ++i) std::swap(ids[i], ids[i + random.GetUInt(n - i)]);
+      sample_ids.assign(ids.begin(), ids.begin() + S);
+      sample_dists.assign(S * S, 0.0);
+      emp::vector<double> rows(S * dims);
+      for (size_t i = 0; i < S; ++i) points.GetPoint(sample_ids[i], rows.data() + i * dims);
+      pool.ForRanges(S, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          for (size_t j = 0; j < S; ++j) {
+            double dist = 0.0;
+            for (size_t d = 0; d < dims; ++d) {
+              const double diff = rows[i * dims + d] - rows[j * dims + d];
+              dist += diff * diff;
+            }
+            sample_dists[i * S + j] = std::sqrt(dist);
+          }
+        }
+      });
+    }
+
+    /// Mean silhouette of the sample under the given labeling. O(S^2 + S K).
+    double SampledSilhouette(const emp::vector<size_t> & assignments, size_t k,
+                             emp::vector<double> & sums, emp::vector<size_t> & counts) const {
+      const size_t S = sample_ids.size();
+      if (S < 2 || k < 2) return 0.0;
+      counts.assign(k, 0);
+      for (size_t i = 0; i < S; ++i) ++counts[assignments[sample_ids[i]]];
+      double total = 0.0;
+      for (size_t i = 0; i < S; ++i) {
+        const size_t own = assignments[sample_ids[i]];
+        if (counts[own] < 2) continue;   // Singletons score 0.
+        sums.assign(k, 0.0);
+        const double * row = sample_dists.data() + i * S;
+        for (size_t j = 0; j < S; ++j) sums[assignments[sample_ids[j]]] += row[j];
+        const double a = sums[own] / (double) (counts[own] - 1);
+        double b = std::numeric_limits<double>::max();
+        for (size_t c = 0; c < k; ++c) {
+          if (c != own && counts[c]) b = std::min(b, sums[c] / (double) counts[c]);
+        }
+        if (b == std::numeric_limits<double>::max()) continue;
+        const double scale = std::max(a, b);
+        if (scale > 0.0) total += (b - a) / scale;
+      }
+      return total / (double) S;
+    }
+
+    /// BIC of the clustering as a mixture of spherical Gaussians with one shared variance.
+    static double ComputeBIC(const emp::vector<size_t> & assignments, size_t k, size_t dims, double inertia) {
+      const double n = (double) assignments.size();
+      if (assignments.size() <= k) return -std::numeric_limits<double>::infinity();
+      emp::vector<size_t> counts(k, 0);
+      for (size_t id : assignments) ++counts[id];
+      const double variance = std::max(inertia / ((double) dims * (n - (double) k)), std::numeric_limits<double>::min());
+      double log_lik = -0.5 * n * (double) dims * std::log(2.0 * M_PI * variance) - 0.5 * (double) dims * (n - (double) k);
+      for (size_t count : counts) {
+        if (count) log_lik += (double) count * std::log((double) count / n);
+      }
+      const double num_params = (double) (k - 1) + (double) (k * dims) + 1.0;
+      return log_lik - 0.5 * num_params * std::log(n);
+    }
+
+    /// Warm start for K + 1: split the cluster with the largest SSE at +/- sqrt(2 lambda / pi) along
+    /// its principal axis (lambda = variance along it; the two half-Gaussians' means).
+    static void SplitWorstCluster(const PointSet & points, const emp::vector<size_t> & assignments,
+                                  const emp::vector<double> & centroids, size_t k, emp::Random & random,
+                                  emp::vector<double> & out) {
+      const size_t dims = points.GetDims();
+      const size_t n = points.GetSize();
+      emp::vector<double> sse(k, 0.0);
+      for (size_t i = 0; i < n; ++i) {
+        const double * centroid = centroids.data() + assignments[i] * dims;
+        double dist = 0.0;
+        for (size_t d = 0; d < dims; ++d) {
+          const double diff = points.Get(i, d) - centroid[d];
+          dist += diff * diff;
+        }
+        sse[assignments[i]] += dist;
+      }
+      const size_t worst = (size_t) (std::max_element(sse.begin(), sse.end()) - sse.begin());
+      const double * center = centroids.data() + worst * dims;
+      // Members, centered (row-major), for a few rounds of power iteration.
+      emp::vector<double> members;
+      for (size_t i = 0; i < n; ++i) {
+        if (assignments[i] != worst) continue;
+        for (size_t d = 0; d < dims; ++d) members.push_back(points.Get(i, d) - center[d]);
+      }
+      const size_t m = members.size() / dims;
+      emp::vector<double> axis(dims), next(dims);
+      for (double & val : axis) val = random.GetRandNormal();
+      double lambda = 0.0;
+      constexpr size_t POWER_ROUNDS = 8;
+      for (size_t round = 0; round < POWER_ROUNDS && m; ++round) {
+        double norm = 0.0;
+        for (double val : axis) norm += val * val;
+        norm = std::sqrt(norm);
+        if (norm == 0.0) break;
+        for (double & val : axis) val /= norm;
+        std::fill(next.begin(), next.end(), 0.0);
+        lambda = 0.0;
+        for (size_t i = 0; i < m; ++i) {
+          const double * row = members.data() + i * dims;
+          double proj = 0.0;
+          for (size_t d = 0; d < dims; ++d) proj += row[d] * axis[d];
+          for (size_t d = 0; d < dims; ++d) next[d] += proj * row[d];
+          lambda += proj * proj;
+        }
+        lambda /= (double) m;
+        std::swap(axis, next);
+      }
+      double norm = 0.0;
+      for (double val : axis) norm += val * val;
+      norm = std::sqrt(norm);
+      const double offset = (norm > 0.0) ? std::sqrt(2.0 * lambda / M_PI) / norm : 0.0;
+      out = centroids;
+      out.resize((k + 1) * dims);
+      for (size_t d = 0; d < dims; ++d) {
+        out[worst * dims + d] = center[d] - offset * axis[d];
+        out[k * dims + d] = center[d] + offset * axis[d];
+      }
+    }
+
+    /// Cluster points for k (seeding if warm is empty, else warm-starting from it). Returns the
+    /// new model's state through kmeans.
+    KMeansResult Solve(KMeans & kmeans, const PointSet & points, size_t k, const emp::vector<double> & warm,
+                       emp::Random & random) const {
+      kmeans.SetK(k);
+      if (warm.size()) kmeans.SetCentroids(warm);
+      return kmeans.Run(points, random, max_iterations);
+    }
+
+    /// Sweep [first, last] (segment number segment) sequentially with warm starts, filling rows[k - k_min].
+    void RunSegment(const PointSet & points, const emp::vector<PointSet> & refs, size_t segment, size_t first,
+                    size_t last, int seed, emp::vector<KSweepRow> & rows) const {
+      emp::Random random(seed);
+      const size_t dims = points.GetDims();
+      KMeans kmeans;
+      emp::vector<KMeans> ref_models(refs.size());
+      emp::vector<double> warm;
+      emp::vector<emp::vector<double>> ref_warm(refs.size());
+      emp::vector<double> sil_sums;
+      emp::vector<size_t> sil_counts;
+      for (size_t k = first; k <= last; ++k) {
+        auto start = std::chrono::steady_clock::now();
+        KSweepRow & row = rows[k - k_min];
+        const KMeansResult result = Solve(kmeans, points, k, warm, random);
+        row.k = k;
+        row.segment = segment;
+        row.iterations = result.iterations;
+        row.converged = result.converged;
+        row.inertia = result.inertia;
+        row.silhouette = SampledSilhouette(kmeans.GetAssignments(), k, sil_sums, sil_counts);
+        row.bic = ComputeBIC(kmeans.GetAssignments(), k, dims, result.inertia);
+        if (k < last) SplitWorstCluster(points, kmeans.GetAssignments(), kmeans.GetCentroids(), k, random, warm);
+
+        // Gap: mean log dispersion of the references minus ours (both per point).
+        const double log_w = std::log(std::max(result.inertia / (double) points.GetSize(), std::numeric_limits<double>::min()));
+        double ref_sum = 0.0, ref_sq = 0.0;
+        for (size_t b = 0; b < refs.size(); ++b) {
+          const size_t ref_k = std::min(k, refs[b].GetSize());
+          const KMeansResult ref_result = Solve(ref_models[b], refs[b], ref_k, ref_warm[b], random);
+          const double ref_log_w = std::log(std::max(ref_result.inertia / (double) refs[b].GetSize(), std::numeric_limits<double>::min()));
+          ref_sum += ref_log_w;
+          ref_sq += ref_log_w * ref_log_w;
+          if (k < last && ref_k == k) {
+            SplitWorstCluster(refs[b], ref_models[b].GetAssignments(), ref_models[b].GetCentroids(), ref_k, random, ref_warm[b]);
+          } else {
+            ref_warm[b].clear();
+          }
+        }
+        if (refs.size()) {
+          const double B = (double) refs.size();
+          const double mean = ref_sum / B;
+          row.gap = mean - log_w;
+          row.gap_sd = std::sqrt(std::max(ref_sq / B - mean * mean, 0.0)) * std::sqrt(1.0 + 1.0 / B);
+        } else {
+          row.gap = row.gap_sd = 0.0;
+        }
+        row.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      }
+    }
+
+  public:
+    KSweep(size_t _k_min = 2, size_t _k_max = 20)
+      : k_min(std::max<size_t>(_k_min, 1)), k_max(std::max(_k_max, _k_min)), max_iterations(100),
+        silhouette_sample(1000), gap_refs(5), gap_ref_size(2000), segment_length(8), pool(1), sample_ids(), sample_dists() { ; }
+
+    /// Which K values to try (inclusive).
+    void SetRange(size_t _k_min, size_t _k_max) { k_min = std::max<size_t>(_k_min, 1); k_max = std::max(_k_max, k_min); }
+    /// Cap on Lloyd iterations per K.
+    void SetMaxIterations(size_t iters) { max_iterations = std::max<size_t>(iters, 1); }
+    /// Silhouette sample size (larger is more precise; cost is quadratic in it).
+    void SetSilhouetteSample(size_t size) { silhouette_sample = size; }
+    /// Gap statistic references: how many uniform sets, and how many points each (0 sets = off).
+    void SetGapReferences(size_t count, size_t size) { gap_refs = count; gap_ref_size = std::max<size_t>(size, 1); }
+    /// K values per warm-start segment (0 = warm-start across the whole range, on one thread).
+    void SetSegmentLength(size_t length) { segment_length = length; }
+    size_t GetSegmentLength() const { return segment_length; }
+    /// How many K segments to run concurrently. (0 = one per hardware thread.)
+    void SetNumThreads(size_t num_threads) { pool.SetNumThreads(num_threads); }
+    size_t GetNumThreads() const { return pool.GetNumThreads(); }
+
+    KSweepResult Run(const PointSet & points, emp::Random & random) {
+      KSweepResult result;
+      const size_t n = points.GetSize();
+      const size_t dims = points.GetDims();
+      if (n == 0) return result;
+      const size_t last = std::min(k_max, n);
+      if (k_min > last) return result;
+      PrepareSilhouette(points, random);
+
+      // Uniform references over the bounding box.
+      emp::vector<double> lo(dims, std::numeric_limits<double>::max()), hi(dims, std::numeric_limits<double>::lowest());
+      for (size_t d = 0; d < dims; ++d) {
+        const double * col = points.GetColumn(d);
+        for (size_t i = 0; i < n; ++i) { lo[d] = std::min(lo[d], col[i]); hi[d] = std::max(hi[d], col[i]); }
+      }
+      emp::vector<PointSet> refs(gap_refs, PointSet(dims));
+      emp::vector<double> pt(dims);
+      for (PointSet & ref : refs) {
+        for (size_t i = 0; i < gap_ref_size; ++i) {
+          for (size_t d = 0; d < dims; ++d) pt[d] = random.GetDouble(lo[d], hi[d]);
+          ref.AddPoint(pt.data());
+        }
+      }
+
+      // Fixed-length segments, each with its own seed; thread t takes segments t, t + T, ...
+      const size_t num_k = last - k_min + 1;
+      const size_t length = segment_length ? segment_length : num_k;
+      const size_t num_segments = (num_k + length - 1) / length;
+      emp::vector<int> seeds(num_segments);
+      for (int & seed : seeds) seed = (int) random.GetUInt(1000000000);
+
+      result.rows.resize(num_k);
+      pool.RunOnAll([&](size_t t) {
+        for (size_t seg = t; seg < num_segments; seg += pool.GetNumThreads()) {
+          const size_t first = k_min + seg * length;
+          RunSegment(points, refs, seg, first, std::min(first + length - 1, last), seeds[seg], result.rows);
+        }
+      });
+
+      // Pick K by each criterion.
+      double best_sil = std::numeric_limits<double>::lowest(), best_bic = best_sil;
+      for (const KSweepRow & row : result.rows) {
+        if (row.k >= 2 && row.silhouette > best_sil) { best_sil = row.silhouette; result.best_silhouette = row.k; }
+        if (row.bic > best_bic) { best_bic = row.bic; result.best_bic = row.k; }
+      }
+      if (gap_refs) {
+        result.best_gap = result.rows.back().k;
+        for (size_t i = 0; i + 1 < result.rows.size(); ++i) {
+          if (result.rows[i].gap >= result.rows[i + 1].gap - result.rows[i + 1].gap_sd) { result.best_gap = result.rows[i].k; break; }
+        }
+      }
+      return result;
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,290 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Kd-tree filtering assignment (Kanungo et al., "An Efficient k-Means Clustering Algorithm:
+//  Analysis and Implementation", 2002).
+//
+//  A kd-tree is built once over the point set; every node caches its bounding box and the sum and
+//  count of the points below it. Each iteration walks the tree with a shrinking list of candidate
+//  centroids: at every node, the candidate nearest the box midpoint (z*) prunes every candidate z
+//  that is farther than z* from the box vertex extreme in the direction z - z* (and therefore from
+//  every point in the box). Once one candidate is left, the whole node goes to it and its cached
+//  sum/count feed the centroid update directly, without touching its points' coordinates.
+//
+//  Pruning is conservative (with the same slack as the triangle-inequality strategies) and
+//  leaves compare exact squared distances in candidate order, so assignments match the naive loop.
+//  Pays off at low dimensionality, where boxes stay tight; at high dimensionality almost nothing
+//  gets pruned. Templated on the coordinate type T like the bounds: points and leaf distances are
+//  in T, boxes and node sums in double.
+
+#ifndef CLUSTERING_KD_TREE_FILTER_H
+#define CLUSTERING_KD_TREE_FILTER_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "base/vector.h"
+
+#include "PointSet.h"
+#include "AcceleratedAssign.h"
+#include "ThreadPool.h"
+
+namespace clustering {
+
+  template <typename T>
+  class KdTreeFilter {
+  protected:
+    static constexpr size_t LEAF_SIZE = 16;    //< Max points in a leaf.
+    static constexpr size_t MAX_DEPTH = 64;    //< Deeper nodes become leaves regardless of size.
+
+    struct Node {
+      size_t begin;   //< Range of order[] covered by this node.
+      size_t end;
+      size_t left;    //< Child node ids (0 for leaves; the root is never a child).
+      size_t right;
+    };
+
+    size_t dims;
+    emp::vector<Node> nodes;           //< nodes[0] is the root.
+    emp::vector<double> box_lo;        //< nodes x dims: bounding box minimum.
+    emp::vector<double> box_hi;        //< nodes x dims: bounding box maximum.
+    emp::vector<double> node_sums;     //< nodes x dims: coordinate sums of the points below.
+    emp::vector<size_t> order;         //< Point ids in tree order (every node is a contiguous run).
+    emp::vector<T> rows;               //< Points in tree order, row-major (leaf scans stream these).
+    emp::vector<size_t> roots;         //< Subtrees handed out to threads (in tree order).
+    size_t max_depth;
+    bool ready;
+
+    emp::vector<size_t> thread_changed;    //< Per-thread changed-assignment counts.
+    emp::vector<size_t> thread_dists;      //< Per-thread distance counts.
+    emp::vector<emp::vector<size_t>> thread_cands;  //< Per-thread candidate stacks (one K-slot level per depth).
+
+    size_t GetCount(size_t node) const { return nodes[node].end - nodes[node].begin; }
+
+    void SwapRows(size_t a, size_t b) {
+      std::swap(order[a], order[b]);
+      for (size_t d = 0; d < dims; ++d) std::swap(rows[a * dims + d], rows[b * dims + d]);
+    }
+
+    /// Split rows [begin, end) on coordinate dim around the median of a small sample, moving whole
+    /// rows (and their ids) so every node's points stay contiguous. Returns the first row of the
+    /// upper half; both halves are non-empty as long as the coordinate isn't constant.
+    size_t Partition(size_t begin, size_t end, size_t dim, double min_val) {
+      constexpr size_t SAMPLES = 31;
+      const size_t n = end - begin;
+      const size_t num_samples = std::min(n, SAMPLES);
+      double sample[SAMPLES];
+      for (size_t j = 0; j < num_samples; ++j) sample[j] = rows[(begin + j * n / num_samples) * dims + dim];
+      std::nth_element(sample, sample + num_samples / 2, sample + num_samples);
+      const double pivot = sample[num_samples / 2];
+      // Values equal to the pivot go up, unless the pivot is the minimum (then they go down).
+      const bool pivot_is_min = !(pivot > min_val);
+      size_t i = begin, j = end;
+      while (true) {
+        while (i < j && (rows[i * dims + dim] < pivot || (pivot_is_min && rows[i * dims + dim] == pivot))) ++i;
+        while (i < j && !(rows[(j - 1) * dims + dim] < pivot || (pivot_is_min && rows[(j - 1) * dims + dim] == pivot))) --j;
+        if (i >= j) return i;
+        SwapRows(i++, --j);
+      }
+    }
+
+    /// Build the subtree over rows [begin, end): split the widest box dimension at the median.
+    size_t Build(size_t begin, size_t end, size_t depth) {
+      const size_t id = nodes.size();
+      nodes.push_back(Node{begin, end, 0, 0});
+      max_depth = std::max(max_depth, depth);
+      box_lo.resize(nodes.size() * dims);
+      box_hi.resize(nodes.size() * dims);
+      node_sums.resize(nodes.size() * dims, 0.0);
+      double * lo = box_lo.data() + id * dims;
+      double * hi = box_hi.data() + id * dims;
+      double * sum = node_sums.data() + id * dims;
+      std::copy(rows.begin() + begin * dims, rows.begin() + (begin + 1) * dims, lo);
+      std::copy(lo, lo + dims, hi);
+      for (size_t i = begin; i < end; ++i) {
+        const T * pt = rows.data() + i * dims;
+        for (size_t d = 0; d < dims; ++d) {
+          lo[d] = std::min(lo[d], (double) pt[d]);
+          hi[d] = std::max(hi[d], (double) pt[d]);
+          sum[d] += pt[d];
+        }
+      }
+      size_t split_dim = 0;
+      for (size_t d = 1; d < dims; ++d) {
+        if (hi[d] - lo[d] > hi[split_dim] - lo[split_dim]) split_dim = d;
+      }
+      // (The depth cap only matters for pathological inputs: a deep, unsplit leaf is just slower.)
+      if (end - begin <= LEAF_SIZE || hi[split_dim] <= lo[split_dim] || depth >= MAX_DEPTH) return id;
+      const size_t mid = Partition(begin, end, split_dim, lo[split_dim]);
+      const size_t left = Build(begin, mid, depth + 1);
+      const size_t right = Build(mid, end, depth + 1);
+      nodes[id].left = left;
+      nodes[id].right = right;
+      return id;
+    }
+
+    /// Can every point in node's box be shown to be strictly closer to centroid best than to cand?
+    bool Dominates(size_t node, const T * best, const T * cand) const {
+      const double * lo = box_lo.data() + node * dims;
+      const double * hi = box_hi.data() + node * dims;
+      double dist_best = 0.0, dist_cand = 0.0, diag = 0.0;
+      for (size_t d = 0; d < dims; ++d) {
+        const double vertex = (cand[d] > best[d]) ? hi[d] : lo[d];
+        const double diff_best = vertex - (double) best[d];
+        const double diff_cand = vertex - (double) cand[d];
+        dist_best += diff_best * diff_best;
+        dist_cand += diff_cand * diff_cand;
+        diag += (hi[d] - lo[d]) * (hi[d] - lo[d]);
+      }
+      // Points elsewhere in the box can be up to one diagonal farther away; scale the slack to that.
+      const double slack = GetBoundSlack<T>() * (2.0 * (dist_best + dist_cand) + 8.0 * diag);
+      return dist_cand - dist_best > slack;
+    }
+
+    /// Filter candidates cands[0, num_cands) at node and recurse. Fills sums/counts for every point
+    /// below it and updates their assignments.
+    void Filter(size_t node, size_t * cands, size_t num_cands, const T * centroids,
+                size_t num_clusters, emp::vector<size_t> & assignments, double * sums, size_t * counts,
+                size_t & changed, size_t & dist_count) {
+      const Node & cur = nodes[node];
+      if (num_cands > 1) {
+        // z*: the candidate nearest the box midpoint.
+        const double * lo = box_lo.data() + node * dims;
+        const double * hi = box_hi.data() + node * dims;
+        size_t best = cands[0];
+        double best_dist = std::numeric_limits<double>::max();
+        for (size_t j = 0; j < num_cands; ++j) {
+          const T * centroid = centroids + cands[j] * dims;
+          double dist = 0.0;
+          for (size_t d = 0; d < dims; ++d) {
+            const double diff = 0.5 * (lo[d] + hi[d]) - (double) centroid[d];
+            dist += diff * diff;
+          }
+          if (dist < best_dist) { best_dist = dist; best = cands[j]; }
+        }
+        dist_count += 3 * num_cands;   // Midpoint distance, then two vertex distances.
+        // Keep survivors in index order (leaves break ties toward the lower index, like the naive loop).
+        size_t * next = cands + num_clusters;
+        size_t num_next = 0;
+        for (size_t j = 0; j < num_cands; ++j) {
+          if (cands[j] == best || !Dominates(node, centroids + best * dims, centroids + cands[j] * dims)) {
+            next[num_next++] = cands[j];
+          }
+        }
+        cands = next;
+        num_cands = num_next;
+      }
+
+      if (num_cands == 1) {
+        // The whole node goes to one centroid: use the cached sums.
+        const size_t c = cands[0];
+        for (size_t i = cur.begin; i < cur.end; ++i) {
+          const size_t id = order[i];
+          if (assignments[id] != c) { assignments[id] = c; ++changed; }
+        }
+        for (size_t d = 0; d < dims; ++d) sums[c * dims + d] += node_sums[node * dims + d];
+        counts[c] += GetCount(node);
+        return;
+      }
+
+      if (cur.left == 0) {
+        // Leaf with several candidates left: check its points exactly.
+        dist_count += GetCount(node) * num_cands;
+        for (size_t i = cur.begin; i < cur.end; ++i) {
+          const T * pt = rows.data() + i * dims;
+          size_t best = cands[0];
+          T best_dist = std::numeric_limits<T>::max();
+          for (size_t j = 0; j < num_cands; ++j) {
+            const T dist = PointCentroidSq(pt, centroids + cands[j] * dims, dims);
+            if (dist < best_dist) { best_dist = dist; best = cands[j]; }
+          }
+          const size_t id = order[i];
+          if (assignments[id] != best) { assignments[id] = best; ++changed; }
+          for (size_t d = 0; d < dims; ++d) sums[best * dims + d] += pt[d];
+          ++counts[best];
+        }
+        return;
+      }
+
+      Filter(cur.left, cands, num_cands, centroids, num_clusters, assignments, sums, counts, changed, dist_count);
+      Filter(cur.right, cands, num_cands, centroids, num_clusters, assignments, sums, counts, changed, dist_count);
+    }
+
+  public:
+    KdTreeFilter() : dims(0), nodes(), box_lo(), box_hi(), node_sums(), order(), rows(), roots(),
+                     max_depth(0), ready(false), thread_changed(), thread_dists(), thread_cands() { ; }
+
+    /// The points changed: rebuild the tree on the next Assign().
+    void Invalidate() { ready = false; }
+    bool IsReady() const { return ready; }
+    size_t GetNumNodes() const { return nodes.size(); }
+
+    /// Build the tree over points. O(n log n); only needed when the points change.
+    void Build(const BasicPointSet<T> & points, size_t num_threads) {
+      const size_t n = points.GetSize();
+      dims = points.GetDims();
+      nodes.clear();
+      max_depth = 0;
+      order.resize(n);
+      rows.resize(n * dims);
+      box_lo.clear();
+      box_hi.clear();
+      node_sums.clear();
+      for (size_t i = 0; i < n; ++i) {
+        order[i] = i;
+        for (size_t d = 0; d < dims; ++d) rows[i * dims + d] = points.Get(i, d);
+      }
+      Build(0, n, 0);
+      // Hand each thread whole subtrees: split nodes (widest first) until there are a few per thread.
+      roots.assign(1, 0);
+      const size_t target = (num_threads > 1) ? 4 * num_threads : 1;
+      while (roots.size() < target) {
+        size_t widest = 0;
+        for (size_t j = 1; j < roots.size(); ++j) {
+          if (GetCount(roots[j]) > GetCount(roots[widest])) widest = j;
+        }
+        const Node & cur = nodes[roots[widest]];
+        if (cur.left == 0) break;
+        roots[widest] = cur.left;
+        roots.insert(roots.begin() + widest + 1, cur.right);
+      }
+      ready = true;
+    }
+
+    /// Assign every point (splitting subtrees across pool) and accumulate each cluster's coordinate
+    /// sums and counts into buffer 0 of sums/counts (fully reduced). Returns number of changed
+    /// assignments; adds distance evaluations (point-centroid and box-centroid) to dist_count.
+    size_t Assign(const BasicPointSet<T> & points, const T * centroids, size_t num_clusters,
+                  emp::vector<size_t> & assignments, ThreadBuffers<double> & sums,
+                  ThreadBuffers<size_t> & counts, ThreadPool & pool, size_t & dist_count) {
+      const size_t num_threads = pool.GetNumThreads();
+      if (!ready) Build(points, num_threads);
+      sums.Resize(num_threads, num_clusters * dims);
+      counts.Resize(num_threads, num_clusters);
+      thread_changed.assign(num_threads, 0);
+      thread_dists.assign(num_threads, 0);
+      thread_cands.resize(num_threads);
+      pool.ForRanges(roots.size(), [&](size_t t, size_t begin, size_t end) {
+        sums.Clear(t);
+        counts.Clear(t);
+        emp::vector<size_t> & cands = thread_cands[t];
+        cands.resize((max_depth + 2) * num_clusters);   // Each level filters into the next K slots.
+        for (size_t j = begin; j < end; ++j) {
+          for (size_t c = 0; c < num_clusters; ++c) cands[c] = c;
+          Filter(roots[j], cands.data(), num_clusters, centroids, num_clusters, assignments,
+                 sums.Get(t), counts.Get(t), thread_changed[t], thread_dists[t]);
+        }
+      });
+      sums.TreeReduce(pool);
+      counts.TreeReduce(pool);
+      size_t changed = 0;
+      for (size_t t = 0; t < num_threads; ++t) { changed += thread_changed[t]; dist_count += thread_dists[t]; }
+      return changed;
+    }
+  };
+
+}
+
+#endif
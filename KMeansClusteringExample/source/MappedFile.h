@@ -0,0 +1,105 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Minimal RAII wrapper around a memory-mapped file (POSIX; native builds only), plus access-pattern
+//  hints. Used to work on point files larger than RAM: the kernel pages data in as it's touched,
+//  and Advise() lets callers ask for read-ahead (WILL_NEED) and release pages they're done with
+//  (DONT_NEED), so resident memory stays bounded by what's in flight.
+
+#ifndef CLUSTERING_MAPPED_FILE_H
+#define CLUSTERING_MAPPED_FILE_H
+
+#ifndef __EMSCRIPTEN__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace clustering {
+
+  class MappedFile {
+  protected:
+    int fd;
+    void * data;
+    size_t size;
+
+  public:
+    enum class Access { SEQUENTIAL, RANDOM, WILL_NEED, DONT_NEED };
+
+    MappedFile() : fd(-1), data(nullptr), size(0) { ; }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+    ~MappedFile() { Close(); }
+
+    bool IsOpen() const { return fd >= 0; }
+    size_t GetSize() const { return size; }
+    const char * GetData() const { return (const char *) data; }
+    char * GetData() { return (char *) data; }
+
+    /// Map an existing file read-only. Returns false (and sets error) on failure.
+    bool OpenRead(const std::string & path, std::string & error) {
+      Close();
+      fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) { error = "could not open '" + path + "': " + std::strerror(errno); return false; }
+      struct stat info;
+      if (fstat(fd, &info) != 0) { error = "could not stat '" + path + "'"; Close(); return false; }
+      size = (size_t) info.st_size;
+      return Map(PROT_READ, path, error);
+    }
+
+    /// Create (or truncate) a file of _size bytes and map it read-write; writes go back to the file.
+    bool Create(const std::string & path, size_t _size, std::string & error) {
+      Close();
+      fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+      if (fd < 0) { error = "could not create '" + path + "': " + std::strerror(errno); return false; }
+      if (ftruncate(fd, (off_t) _size) != 0) { error = "could not resize '" + path + "'"; Close(); return false; }
+      size = _size;
+      return Map(PROT_READ | PROT_WRITE, path, error);
+    }
+
+    /// Hint how bytes [offset, offset + len) will be used. (Rounded out to whole pages.)
+    void Advise(size_t offset, size_t len, Access access) {
+      if (data == nullptr || offset >= size) return;
+      const size_t page = (size_t) sysconf(_SC_PAGESIZE);
+      const size_t begin = offset / page * page;
+      const size_t end = std::min(offset + len, size);
+      const int advice = (access == Access::SEQUENTIAL) ? MADV_SEQUENTIAL
+                       : (access == Access::RANDOM) ? MADV_RANDOM
+                       : (access == Access::WILL_NEED) ? MADV_WILLNEED : MADV_DONTNEED;
+      madvise((char *) data + begin, end - begin, advice);
+    }
+
+    void Close() {
+      if (data != nullptr) munmap(data, size);
+      if (fd >= 0) close(fd);
+      data = nullptr;
+      fd = -1;
+      size = 0;
+    }
+
+  protected:
+    bool Map(int prot, const std::string & path, std::string & error) {
+      if (size == 0) return true;   // Nothing to map (mmap rejects empty ranges).
+      data = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED) {
+        data = nullptr;
+        error = "could not map '" + path + "': " + std::strerror(errno);
+        Close();
+        return false;
+      }
+      return true;
+    }
+  };
+
+}
+
+#endif
+
+#endif
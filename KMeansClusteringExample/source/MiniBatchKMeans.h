@@ -0,0 +1,189 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Mini-batch / streaming k-means (Sculley, "Web-Scale K-Means Clustering", 2010).
+//  Points are consumed in fixed-size batches: each batch is assigned to the current centroids,
+//  then every point nudges its centroid toward itself with a per-centroid learning rate of
+//  1 / (points that centroid has absorbed so far). Memory is bounded by K + batch_size points no
+//  matter how long the stream is.
+//  - Streaming: feed points one at a time with AddPoint(); a batch runs whenever one fills up.
+//  - In memory: Step() samples one batch from a PointSet (e.g., one batch per animation frame).
+
+#ifndef CLUSTERING_MINI_BATCH_KMEANS_H
+#define CLUSTERING_MINI_BATCH_KMEANS_H
+
+#include <algorithm>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "PointSet.h"
+#include "AssignKernel.h"
+#include "Seeding.h"
+#include "ThreadPool.h"
+
+namespace clustering {
+
+  /// Copy of the model at some point in time (safe to keep while the model keeps learning).
+  struct KMeansSnapshot {
+    size_t num_clusters = 0;
+    size_t dims = 0;
+    size_t batches = 0;             //< Batches processed when the snapshot was taken.
+    size_t points_seen = 0;         //< Points consumed when the snapshot was taken.
+    emp::vector<double> centroids;  //< Row-major K x dims.
+    emp::vector<size_t> counts;     //< Points absorbed by each centroid.
+
+    const double * GetCentroid(size_t c) const { return centroids.data() + c * dims; }
+  };
+
+  class MiniBatchKMeans {
+  protected:
+    size_t num_clusters;              //< K
+    size_t dims;                      //< Dimensionality of the points being clustered.
+    size_t batch_size;                //< Points per update.
+    size_t count_cap;                 //< Cap on per-centroid counts (0 = none): floors the learning rate.
+    size_t batches;                   //< How many batches have been processed?
+    size_t points_seen;               //< How many points have been consumed?
+    bool seeded;                      //< Have centroids been initialized yet?
+    emp::vector<double> centroids;    //< Flat (row-major) K x dims centroid buffer.
+    emp::vector<size_t> counts;       //< Per-centroid counts (learning rate = 1 / count).
+    PointSet batch;                   //< Pending points (never holds more than batch_size).
+    emp::vector<const double *> cols; //< Scratch: column pointers handed to the assignment kernel.
+    emp::vector<double> centroids_t;  //< Scratch: centroids transposed to dims x K for the kernel.
+    emp::vector<size_t> nearest;      //< Scratch: kernel output (nearest centroid per point).
+    emp::vector<double> nearest_dist; //< Scratch: kernel output (squared distance to it).
+
+    void TransposeCentroids() {
+      centroids_t.resize(num_clusters * dims);
+      for (size_t c = 0; c < num_clusters; ++c) {
+        for (size_t d = 0; d < dims; ++d) centroids_t[d * num_clusters + c] = centroids[c * dims + d];
+      }
+    }
+
+    /// Initialize centroids by running k-means++ over the pending (first) batch.
+    void Seed(emp::Random & random) {
+      ThreadPool serial(1);
+      SeedKMeansPlusPlus(batch, num_clusters, random, serial, centroids);
+      std::fill(counts.begin(), counts.end(), 0);
+      seeded = true;
+    }
+
+    /// Assign the pending batch to the current centroids, then move each centroid toward its points.
+    void ProcessBatch(emp::Random & random) {
+      const size_t n = batch.GetSize();
+      if (n == 0) return;
+      if (!seeded) Seed(random);
+      cols.resize(dims);
+      for (size_t d = 0; d < dims; ++d) cols[d] = batch.GetColumn(d);
+      TransposeCentroids();
+      nearest.resize(n);
+      nearest_dist.resize(n);
+      AssignNearestBlock(cols.data(), dims, 0, n, centroids_t.data(), num_clusters, nearest.data(), nearest_dist.data());
+      for (size_t i = 0; i < n; ++i) {
+        const size_t c = nearest[i];
+        if (count_cap == 0 || counts[c] < count_cap) ++counts[c];
+        const double eta = 1.0 / (double) counts[c];
+        double * centroid = centroids.data() + c * dims;
+        for (size_t d = 0; d < dims; ++d) centroid[d] += eta * (cols[d][i] - centroid[d]);
+      }
+      points_seen += n;
+      ++batches;
+      batch.Clear();
+    }
+
+  public:
+    MiniBatchKMeans(size_t k = 1, size_t _dims = 2, size_t _batch_size = 256)
+      : num_clusters(std::max<size_t>(k, 1)), dims(_dims), batch_size(std::max<size_t>(_batch_size, 1)),
+        count_cap(0), batches(0), points_seen(0), seeded(false),
+        centroids(), counts(), batch(_dims), cols(), centroids_t(), nearest(), nearest_dist()
+    {
+      Reset(_dims);
+    }
+
+    size_t GetK() const { return num_clusters; }
+    size_t GetDims() const { return dims; }
+    size_t GetBatchSize() const { return batch_size; }
+    size_t GetCountCap() const { return count_cap; }
+    size_t GetNumBatches() const { return batches; }
+    size_t GetPointsSeen() const { return points_seen; }
+    bool IsSeeded() const { return seeded; }
+    const emp::vector<double> & GetCentroids() const { return centroids; }
+    const double * GetCentroid(size_t c) const { return centroids.data() + c * dims; }
+
+    /// Set the number of clusters; resets the model.
+    void SetK(size_t k) { num_clusters = std::max<size_t>(k, 1); Reset(dims); }
+    /// Set the batch size (takes effect with the next batch).
+    void SetBatchSize(size_t _batch_size) { batch_size = std::max<size_t>(_batch_size, 1); }
+    /// Cap per-centroid counts so the learning rate never drops below 1/cap (0 = no cap). Useful
+    /// for streams whose distribution drifts over time.
+    void SetCountCap(size_t cap) { count_cap = cap; }
+
+    /// Forget everything (and switch to points of the given dimensionality).
+    void Reset(size_t _dims) {
+      dims = _dims;
+      batches = points_seen = 0;
+      seeded = false;
+      centroids.assign(num_clusters * dims, 0.0);
+      counts.assign(num_clusters, 0);
+      batch.Reset(dims);
+      batch.Reserve(std::max(batch_size, num_clusters));
+    }
+
+    /// Streaming: consume one point (GetDims() values). Returns true if this completed a batch.
+    /// The first batch is held until it has at least K points so centroids can be seeded from it.
+    bool AddPoint(const double * pt, emp::Random & random) {
+      batch.AddPoint(pt);
+      const size_t needed = seeded ? batch_size : std::max(batch_size, num_clusters);
+      if (batch.GetSize() < needed) return false;
+      ProcessBatch(random);
+      return true;
+    }
+
+    /// Streaming: process whatever partial batch is pending (e.g., at the end of the stream).
+    bool Flush(emp::Random & random) {
+      if (batch.IsEmpty()) return false;
+      ProcessBatch(random);
+      return true;
+    }
+
+    /// In memory: sample one batch (with replacement) from points and process it.
+    void Step(const PointSet & points, emp::Random & random) {
+      if (points.IsEmpty()) return;
+      if (points.GetDims() != dims) Reset(points.GetDims());
+      const size_t n = seeded ? batch_size : std::max(batch_size, num_clusters);
+      batch.Resize(n);
+      for (size_t i = 0; i < n; ++i) {
+        const size_t id = random.GetUInt(points.GetSize());
+        for (size_t d = 0; d < dims; ++d) batch.Set(i, d, points.Get(id, d));
+      }
+      ProcessBatch(random);
+    }
+
+    /// Label every point in points with its nearest centroid.
+    void Assign(const PointSet & points, emp::vector<size_t> & out_ids) {
+      const size_t n = points.GetSize();
+      out_ids.resize(n);
+      if (n == 0) return;
+      cols.resize(dims);
+      for (size_t d = 0; d < dims; ++d) cols[d] = points.GetColumn(d);
+      TransposeCentroids();
+      nearest_dist.resize(n);
+      AssignNearestBlock(cols.data(), dims, 0, n, centroids_t.data(), num_clusters, out_ids.data(), nearest_dist.data());
+    }
+
+    /// Copy the current model into snapshot (reuses its buffers).
+    void GetSnapshot(KMeansSnapshot & snapshot) const {
+      snapshot.num_clusters = num_clusters;
+      snapshot.dims = dims;
+      snapshot.batches = batches;
+      snapshot.points_seen = points_seen;
+      snapshot.centroids = centroids;
+      snapshot.counts = counts;
+    }
+    KMeansSnapshot GetSnapshot() const { KMeansSnapshot snapshot; GetSnapshot(snapshot); return snapshot; }
+  };
+
+}
+
+#endif
@@ -0,0 +1,227 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Out-of-core k-means (Lloyd's algorithm, as in KMeans) over a memory-mapped file of packed
+//  float32 coordinates (native builds only). Points are never loaded: every iteration streams the
+//  mapping front to back in large chunks, asking the kernel to read ahead one chunk and to drop
+//  each chunk once it's been used. Assignments live in a companion mapped file (one uint32 per
+//  point), so they never occupy heap memory either. Peak memory is O(K * dims + chunk) no matter
+//  how many points the file holds.
+//
+//  Each pass assigns a chunk (same SIMD kernel as KMeans) and immediately adds it to per-thread
+//  centroid sums, so one sequential read per iteration does both halves of a Lloyd step.
+//  Seeding runs k-means++ over a small random sample of the file (O(K) points).
+
+#ifndef CLUSTERING_OUT_OF_CORE_KMEANS_H
+#define CLUSTERING_OUT_OF_CORE_KMEANS_H
+
+#ifndef __EMSCRIPTEN__
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "PointSet.h"
+#include "AssignKernel.h"
+#include "KMeans.h"
+#include "MappedFile.h"
+#include "Seeding.h"
+#include "ThreadPool.h"
+
+namespace clustering {
+
+  class OutOfCoreKMeans {
+  protected:
+    static constexpr size_t SEED_SAMPLE_PER_CLUSTER = 64;   //< Seeding sample size (x K).
+
+    size_t num_clusters;              //< K
+    size_t dims;
+    size_t num_points;
+    size_t chunk_bytes;               //< Bytes of the points file streamed per chunk.
+    size_t iteration;
+    double inertia;                   //< Sum of squared distances measured during the last pass.
+    MappedFile points_file;           //< Packed float32 coordinates (read-only).
+    MappedFile assign_file;           //< One uint32 cluster id per point (read-write).
+    emp::vector<double> centroids;    //< Row-major K x dims.
+    emp::vector<double> centroids_t;  //< Transposed (dims x K) for the assignment kernel.
+    PointSet chunk;                   //< Current chunk, converted to double columns.
+    emp::vector<const double *> cols;
+    emp::vector<size_t> nearest;
+    emp::vector<double> nearest_dist;
+    ThreadBuffers<double> sums;       //< Per-thread centroid sums (accumulated over a whole pass).
+    ThreadBuffers<size_t> counts;
+    emp::vector<size_t> thread_changed;
+    emp::vector<double> thread_inertia;
+    ThreadPool pool;
+
+    const float * GetRaw() const { return (const float *) points_file.GetData(); }
+    uint32_t * GetIds() { return (uint32_t *) assign_file.GetData(); }
+
+    /// Assign points [first, first + count) (already in chunk) and add them to the thread sums.
+    void ProcessChunk(size_t first, size_t count) {
+      const float * raw = GetRaw() + first * dims;
+      uint32_t * ids = GetIds() + first;
+      const bool fresh = (iteration == 0);
+      pool.ForRanges(count, [&](size_t t, size_t begin, size_t end) {
+        for (size_t d = 0; d < dims; ++d) {
+          double * col = chunk.GetColumn(d);
+          for (size_t i = begin; i < end; ++i) col[i] = (double) raw[i * dims + d];
+        }
+        AssignNearestBlock(cols.data(), dims, begin, end, centroids_t.data(), num_clusters,
+                           nearest.data(), nearest_dist.data());
+        double * thread_sums = sums.Get(t);
+        size_t * thread_counts = counts.Get(t);
+        size_t changed = 0;
+        double dist_total = 0.0;
+        for (size_t i = begin; i < end; ++i) {
+          const size_t c = nearest[i];
+          if (fresh || ids[i] != c) { ids[i] = (uint32_t) c; ++changed; }
+          ++thread_counts[c];
+          dist_total += nearest_dist[i];
+        }
+        for (size_t d = 0; d < dims; ++d) {
+          const double * col = chunk.GetColumn(d);
+          for (size_t i = begin; i < end; ++i) thread_sums[nearest[i] * dims + d] += col[i];
+        }
+        thread_changed[t] += changed;
+        thread_inertia[t] += dist_total;
+      });
+    }
+
+  public:
+    OutOfCoreKMeans(size_t k = 1)
+      : num_clusters(std::max<size_t>(k, 1)), dims(0), num_points(0), chunk_bytes((size_t) 1 << 24),
+        iteration(0), inertia(0.0), points_file(), assign_file(), centroids(), centroids_t(), chunk(),
+        cols(), nearest(), nearest_dist(), sums(), counts(), thread_changed(), thread_inertia(), pool(1) { ; }
+
+    size_t GetK() const { return num_clusters; }
+    size_t GetDims() const { return dims; }
+    size_t GetNumPoints() const { return num_points; }
+    size_t GetIteration() const { return iteration; }
+    size_t GetNumThreads() const { return pool.GetNumThreads(); }
+    const emp::vector<double> & GetCentroids() const { return centroids; }
+    const double * GetCentroid(size_t c) const { return centroids.data() + c * dims; }
+    /// Cluster ids (one per point), backed by the assignments file.
+    const uint32_t * GetAssignments() const { return (const uint32_t *) assign_file.GetData(); }
+    /// Inertia measured while assigning during the last pass (i.e., against the centroids before
+    /// that pass's update; identical to the final inertia once converged).
+    double GetInertia() const { return inertia; }
+
+    /// How many threads should the engine use? (0 = one per hardware thread.)
+    void SetNumThreads(size_t num_threads) { pool.SetNumThreads(num_threads); }
+    /// How many bytes of the points file to stream per chunk (default 16 MB).
+    void SetChunkBytes(size_t bytes) { chunk_bytes = std::max<size_t>(bytes, 4096); }
+    /// Start from the given centroids (row-major K x dims) instead of seeding.
+    void SetCentroids(const emp::vector<double> & _centroids) { centroids = _centroids; }
+
+    /// Map the points file (packed float32, _dims values per point) and create the assignments
+    /// file next to it. Returns false (and sets error) on failure.
+    bool Open(const std::string & points_path, size_t _dims, const std::string & assign_path, std::string & error) {
+      if (_dims == 0) { error = "binary input needs a dimensionality"; return false; }
+      if (!points_file.OpenRead(points_path, error)) return false;
+      if (points_file.GetSize() % (sizeof(float) * _dims) != 0) {
+        error = "file size is not a whole number of " + std::to_string(_dims) + "-D float32 points";
+        points_file.Close();
+        return false;
+      }
+      dims = _dims;
+      num_points = points_file.GetSize() / (sizeof(float) * dims);
+      if (!assign_file.Create(assign_path, num_points * sizeof(uint32_t), error)) return false;
+      points_file.Advise(0, points_file.GetSize(), MappedFile::Access::SEQUENTIAL);
+      iteration = 0;
+      centroids.clear();
+      return true;
+    }
+
+    /// Seed with k-means++ over a uniform sample of SEED_SAMPLE_PER_CLUSTER * K points (read with
+    /// random access, so seeding costs O(K) page reads rather than a pass over the file).
+    void Seed(emp::Random & random) {
+      const size_t sample_size = std::min(num_points, SEED_SAMPLE_PER_CLUSTER * num_clusters);
+      emp::vector<size_t> picks(sample_size);
+      for (size_t & pick : picks) pick = std::min((size_t) (random.GetDouble() * (double) num_points), num_points - 1);
+      std::sort(picks.begin(), picks.end());   // Visit the file in order.
+      PointSet sample(dims);
+      sample.Reserve(sample_size);
+      emp::vector<double> pt(dims);
+      points_file.Advise(0, points_file.GetSize(), MappedFile::Access::RANDOM);
+      for (size_t pick : picks) {
+        for (size_t d = 0; d < dims; ++d) pt[d] = (double) GetRaw()[pick * dims + d];
+        sample.AddPoint(pt.data());
+      }
+      points_file.Advise(0, points_file.GetSize(), MappedFile::Access::DONT_NEED);
+      points_file.Advise(0, points_file.GetSize(), MappedFile::Access::SEQUENTIAL);
+      SeedKMeansPlusPlus(sample, num_clusters, random, pool, centroids);
+    }
+
+    /// One Lloyd iteration as a single sequential pass over the file. Returns how many points
+    /// changed clusters (all of them on the first pass).
+    size_t Step(emp::Random & random) {
+      if (num_points == 0) return 0;
+      if (centroids.size() != num_clusters * dims) Seed(random);
+      centroids_t.resize(num_clusters * dims);
+      for (size_t c = 0; c < num_clusters; ++c) {
+        for (size_t d = 0; d < dims; ++d) centroids_t[d * num_clusters + c] = centroids[c * dims + d];
+      }
+      const size_t num_threads = pool.GetNumThreads();
+      sums.Resize(num_threads, num_clusters * dims);
+      counts.Resize(num_threads, num_clusters);
+      for (size_t t = 0; t < num_threads; ++t) { sums.Clear(t); counts.Clear(t); }
+      thread_changed.assign(num_threads, 0);
+      thread_inertia.assign(num_threads, 0.0);
+
+      const size_t point_bytes = sizeof(float) * dims;
+      const size_t chunk_points = std::max<size_t>(chunk_bytes / point_bytes, 1);
+      chunk.Reset(dims);
+      chunk.Resize(std::min(chunk_points, num_points));
+      cols.resize(dims);
+      for (size_t d = 0; d < dims; ++d) cols[d] = chunk.GetColumn(d);
+      nearest.resize(chunk.GetSize());
+      nearest_dist.resize(chunk.GetSize());
+
+      for (size_t first = 0; first < num_points; first += chunk_points) {
+        const size_t count = std::min(chunk_points, num_points - first);
+        // Read ahead the next chunk while this one is processed.
+        points_file.Advise((first + count) * point_bytes, chunk_points * point_bytes, MappedFile::Access::WILL_NEED);
+        ProcessChunk(first, count);
+        // Done with this chunk: release its pages (written ids stay in the page cache / file).
+        points_file.Advise(first * point_bytes, count * point_bytes, MappedFile::Access::DONT_NEED);
+        assign_file.Advise(first * sizeof(uint32_t), count * sizeof(uint32_t), MappedFile::Access::DONT_NEED);
+      }
+
+      sums.TreeReduce(pool);
+      counts.TreeReduce(pool);
+      const double * total_sums = sums.Get(0);
+      const size_t * total_counts = counts.Get(0);
+      for (size_t c = 0; c < num_clusters; ++c) {
+        if (total_counts[c] == 0) continue;   // Empty clusters keep their old position.
+        for (size_t d = 0; d < dims; ++d) centroids[c * dims + d] = total_sums[c * dims + d] / (double) total_counts[c];
+      }
+      size_t changed = 0;
+      inertia = 0.0;
+      for (size_t t = 0; t < num_threads; ++t) { changed += thread_changed[t]; inertia += thread_inertia[t]; }
+      ++iteration;
+      return changed;
+    }
+
+    /// Iterate until assignments stop changing (or max_iterations is reached).
+    KMeansResult Run(emp::Random & random, size_t max_iterations = 300) {
+      KMeansResult result{0, 0.0, false};
+      while (result.iterations < max_iterations) {
+        const size_t changed = Step(random);
+        ++result.iterations;
+        if (changed == 0) { result.converged = true; break; }
+      }
+      result.inertia = inertia;
+      return result;
+    }
+  };
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,263 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Synthetic point generators (shared by the k-means and density-based examples).
+//  - PoissonDiskSampler: drops points in a rectangle so that no two are closer than a minimum
+//    distance (e.g., non-overlapping circles on a canvas). A spatial hash makes each placement
+//    check O(1). Points are first tried at uniformly random positions; once that stops working
+//    (the region is filling up), Bridson's algorithm ("Fast Poisson Disk Sampling in Arbitrary
+//    Dimensions", 2007) searches the annulus around existing points for the remaining gaps. When
+//    no gap is left, fewer points than requested are returned (never overlapping ones).
+//  - GenerateBlobs (plus anisotropic and varying-density variants) / GenerateRings /
+//    GenerateUniform: bulk datasets for benchmarking the engines.
+
+#ifndef CLUSTERING_POINT_GENERATOR_H
+#define CLUSTERING_POINT_GENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "PointSet.h"
+
+namespace clustering {
+
+  class PoissonDiskSampler {
+  protected:
+    static constexpr size_t DART_TRIES = 30;      //< Uniform attempts per point before searching gaps.
+    static constexpr size_t ANNULUS_TRIES = 30;   //< Bridson's k: candidates around an active point.
+    static constexpr size_t NONE = (size_t) -1;
+
+    double x_min, y_min, x_max, y_max;
+    double min_dist;
+    double cell_size;                  //< min_dist / sqrt(2): spaced points never share a cell.
+    size_t grid_w, grid_h;
+    emp::vector<size_t> cell_head;     //< First point in each cell (NONE if empty).
+    emp::vector<size_t> next_in_cell;  //< Per point: next point in the same cell.
+    emp::vector<double> xs, ys;        //< Every point in the sampler (inserted or generated).
+    emp::vector<size_t> active;        //< Points whose surroundings may still have room (Bridson).
+
+    size_t CellX(double x) const { return std::min((size_t) std::max(0.0, (x - x_min) / cell_size), grid_w - 1); }
+    size_t CellY(double y) const { return std::min((size_t) std::max(0.0, (y - y_min) / cell_size), grid_h - 1); }
+
+    void Store(double x, double y) {
+      const size_t id = xs.size();
+      const size_t cell = CellY(y) * grid_w + CellX(x);
+      xs.push_back(x);
+      ys.push_back(y);
+      next_in_cell.push_back(cell_head[cell]);
+      cell_head[cell] = id;
+      active.push_back(id);
+    }
+
+    bool InBounds(double x, double y) const { return x >= x_min && x <= x_max && y >= y_min && y <= y_max; }
+
+  public:
+    /// Sample inside [x_min, x_max] x [y_min, y_max], keeping points at least _min_dist apart.
+    PoissonDiskSampler(double _x_min, double _y_min, double _x_max, double _y_max, double _min_dist)
+      : x_min(_x_min), y_min(_y_min), x_max(std::max(_x_max, _x_min)), y_max(std::max(_y_max, _y_min)),
+        min_dist(std::max(_min_dist, 0.0)), cell_size(1.0), grid_w(1), grid_h(1),
+        cell_head(), next_in_cell(), xs(), ys(), active()
+    {
+      // Keep the grid modest even for tiny min_dist (cells then just hold more points).
+      constexpr size_t MAX_CELLS_PER_SIDE = 4096;
+      const double span = std::max(x_max - x_min, y_max - y_min);
+      cell_size = std::max(min_dist / std::sqrt(2.0), span / (double) MAX_CELLS_PER_SIDE);
+      if (cell_size <= 0.0) cell_size = 1.0;
+      grid_w = (size_t) ((x_max - x_min) / cell_size) + 1;
+      grid_h = (size_t) ((y_max - y_min) / cell_size) + 1;
+      cell_head.assign(grid_w * grid_h, size_t(NONE));   // (Copy, so NONE isn't odr-used.)
+    }
+
+    size_t GetSize() const { return xs.size(); }
+
+    /// Is (x, y) inside the region and at least min_dist from every point so far? O(1).
+    bool IsFree(double x, double y) const {
+      if (!InBounds(x, y)) return false;
+      const size_t reach = (size_t) std::ceil(min_dist / cell_size);
+      const size_t cx = CellX(x), cy = CellY(y);
+      const size_t x0 = cx > reach ? cx - reach : 0, x1 = std::min(cx + reach, grid_w - 1);
+      const size_t y0 = cy > reach ? cy - reach : 0, y1 = std::min(cy + reach, grid_h - 1);
+      const double min_sq = min_dist * min_dist;
+      for (size_t gy = y0; gy <= y1; ++gy) {
+        for (size_t gx = x0; gx <= x1; ++gx) {
+          for (size_t id = cell_head[gy * grid_w + gx]; id != NONE; id = next_in_cell[id]) {
+            const double dx = xs[id] - x, dy = ys[id] - y;
+            if (dx * dx + dy * dy < min_sq) return false;
+          }
+        }
+      }
+      return true;
+    }
+
+    /// Register an existing point (e.g., one placed by hand); it doesn't have to respect min_dist.
+    void Insert(double x, double y) { Store(x, y); }
+
+    /// Add up to n new points to out (which must be 2-D). Returns how many were placed; fewer
+    /// than n means the region is full.
+    size_t AddPoints(size_t n, emp::Random & random, PointSet & out) {
+      size_t placed = 0;
+      while (placed < n) {
+        bool found = false;
+        double x = 0.0, y = 0.0;
+        for (size_t t = 0; t < DART_TRIES && !found; ++t) {
+          x = random.GetDouble(x_min, x_max);
+          y = random.GetDouble(y_min, y_max);
+          found = IsFree(x, y);
+        }
+        // Bridson: look for room in the annulus [min_dist, 2 min_dist) around a random active
+        // point; points whose annulus is full are retired for good.
+        while (!found && active.size()) {
+          const size_t slot = random.GetUInt(active.size());
+          const size_t id = active[slot];
+          for (size_t t = 0; t < ANNULUS_TRIES && !found; ++t) {
+            const double angle = random.GetDouble(0.0, 2.0 * M_PI);
+            const double radius = min_dist * std::sqrt(random.GetDouble(1.0, 4.0));  // Uniform by area.
+            x = xs[id] + radius * std::cos(angle);
+            y = ys[id] + radius * std::sin(angle);
+            found = IsFree(x, y);
+          }
+          if (!found) { active[slot] = active.back(); active.pop_back(); }
+        }
+        if (!found) break;
+        Store(x, y);
+        out.AddPoint(x, y);
+        ++placed;
+      }
+      return placed;
+    }
+
+    /// Fill the whole region (blue noise), appending the new points to out. O(points placed).
+    size_t Fill(emp::Random & random, PointSet & out) {
+      size_t placed = 0;
+      if (xs.empty()) {
+        const double x = random.GetDouble(x_min, x_max), y = random.GetDouble(y_min, y_max);
+        Store(x, y);
+        out.AddPoint(x, y);
+        ++placed;
+      }
+      while (active.size()) {
+        // Pure Bridson: grow outward from the active points until none has room left.
+        const size_t slot = random.GetUInt(active.size());
+        const size_t id = active[slot];
+        bool found = false;
+        for (size_t t = 0; t < ANNULUS_TRIES && !found; ++t) {
+          const double angle = random.GetDouble(0.0, 2.0 * M_PI);
+          const double radius = min_dist * std::sqrt(random.GetDouble(1.0, 4.0));
+          const double x = xs[id] + radius * std::cos(angle);
+          const double y = ys[id] + radius * std::sin(angle);
+          if (IsFree(x, y)) { Store(x, y); out.AddPoint(x, y); ++placed; found = true; }
+        }
+        if (!found) { active[slot] = active.back(); active.pop_back(); }
+      }
+      return placed;
+    }
+  };
+
+  /// Append n points in dims dimensions drawn from num_blobs isotropic Gaussians (std dev spread)
+  /// whose centers are uniform in [0, extent]^dims. Returns the generating blob of each point in
+  /// labels (if given), e.g., to score a clustering against the truth.
+  inline void GenerateBlobs(size_t n, size_t dims, size_t num_blobs, double extent, double spread,
+                            emp::Random & random, PointSet & out, emp::vector<size_t> * labels = nullptr) {
+    num_blobs = std::max<size_t>(num_blobs, 1);
+    emp::vector<double> centers(num_blobs * dims);
+    for (double & coord : centers) coord = random.GetDouble(0.0, extent);
+    if (out.IsEmpty()) out.Reset(dims);
+    emp::vector<double> pt(dims);
+    for (size_t i = 0; i < n; ++i) {
+      const size_t blob = random.GetUInt(num_blobs);
+      for (size_t d = 0; d < dims; ++d) pt[d] = random.GetRandNormal(centers[blob * dims + d], spread);
+      out.AddPoint(pt.data());
+      if (labels) labels->push_back(blob);
+    }
+  }
+
+  /// Like GenerateBlobs, but each blob is stretched and rotated by its own random linear map (so
+  /// clusters are elongated ellipsoids, which k-means' spherical bias handles poorly).
+  inline void GenerateAnisotropicBlobs(size_t n, size_t dims, size_t num_blobs, double extent, double spread,
+                                       emp::Random & random, PointSet & out, emp::vector<size_t> * labels = nullptr) {
+    num_blobs = std::max<size_t>(num_blobs, 1);
+    emp::vector<double> centers(num_blobs * dims);
+    for (double & coord : centers) coord = random.GetDouble(0.0, extent);
+    // Per blob: a dims x dims map with Gaussian entries (random orientation and axis lengths).
+    emp::vector<double> maps(num_blobs * dims * dims);
+    for (double & entry : maps) entry = random.GetRandNormal(0.0, spread / std::sqrt((double) dims));
+    if (out.IsEmpty()) out.Reset(dims);
+    emp::vector<double> z(dims), pt(dims);
+    for (size_t i = 0; i < n; ++i) {
+      const size_t blob = random.GetUInt(num_blobs);
+      for (double & val : z) val = random.GetRandNormal();
+      const double * map = maps.data() + blob * dims * dims;
+      for (size_t d = 0; d < dims; ++d) {
+        double val = centers[blob * dims + d];
+        for (size_t e = 0; e < dims; ++e) val += map[d * dims + e] * z[e];
+        pt[d] = val;
+      }
+      out.AddPoint(pt.data());
+      if (labels) labels->push_back(blob);
+    }
+  }
+
+  /// Like GenerateBlobs, but blobs differ in size and density: blob b gets weight 1 / (b + 1)
+  /// (Zipf) and a spread of spread * 4^u with u uniform in [-1, 1].
+  inline void GenerateVaryingDensityBlobs(size_t n, size_t dims, size_t num_blobs, double extent, double spread,
+                                          emp::Random & random, PointSet & out, emp::vector<size_t> * labels = nullptr) {
+    num_blobs = std::max<size_t>(num_blobs, 1);
+    emp::vector<double> centers(num_blobs * dims);
+    for (double & coord : centers) coord = random.GetDouble(0.0, extent);
+    emp::vector<double> spreads(num_blobs), cumulative(num_blobs);
+    double total = 0.0;
+    for (size_t b = 0; b < num_blobs; ++b) {
+      spreads[b] = spread * std::pow(4.0, random.GetDouble(-1.0, 1.0));
+      total += 1.0 / (double) (b + 1);
+      cumulative[b] = total;
+    }
+    if (out.IsEmpty()) out.Reset(dims);
+    emp::vector<double> pt(dims);
+    for (size_t i = 0; i < n; ++i) {
+      const double pick = random.GetDouble(0.0, total);
+      const size_t blob = std::min((size_t) (std::upper_bound(cumulative.begin(), cumulative.end(), pick) - cumulative.begin()), num_blobs - 1);
+      for (size_t d = 0; d < dims; ++d) pt[d] = random.GetRandNormal(centers[blob * dims + d], spreads[blob]);
+      out.AddPoint(pt.data());
+      if (labels) labels->push_back(blob);
+    }
+  }
+
+  /// Append n 2-D points on num_rings concentric rings around (center, center) (radii center/R,
+  /// 2 center/R, ...), with Gaussian radial noise. A classic case k-means gets wrong and
+  /// density-based clustering gets right. Labels (if given) are the ring of each point.
+  inline void GenerateRings(size_t n, size_t num_rings, double center, double noise,
+                            emp::Random & random, PointSet & out, emp::vector<size_t> * labels = nullptr) {
+    num_rings = std::max<size_t>(num_rings, 1);
+    if (out.IsEmpty()) out.Reset(2);
+    for (size_t i = 0; i < n; ++i) {
+      // Pick rings in proportion to their circumference (ring j has weight j + 1) so density
+      // along each ring is even.
+      double pick = random.GetDouble(0.0, 0.5 * (double) (num_rings * (num_rings + 1)));
+      size_t ring = 0;
+      while (ring + 1 < num_rings && pick >= (double) (ring + 1)) { pick -= (double) (ring + 1); ++ring; }
+      const double radius = center * (double) (ring + 1) / (double) num_rings;
+      const double angle = random.GetDouble(0.0, 2.0 * M_PI);
+      const double r = radius + random.GetRandNormal(0.0, noise);
+      out.AddPoint(center + r * std::cos(angle), center + r * std::sin(angle));
+      if (labels) labels->push_back(ring);
+    }
+  }
+
+  /// Append n points uniform in [0, extent]^dims.
+  inline void GenerateUniform(size_t n, size_t dims, double extent, emp::Random & random, PointSet & out) {
+    if (out.IsEmpty()) out.Reset(dims);
+    emp::vector<double> pt(dims);
+    for (size_t i = 0; i < n; ++i) {
+      for (size_t d = 0; d < dims; ++d) pt[d] = random.GetDouble(0.0, extent);
+      out.AddPoint(pt.data());
+    }
+  }
+
+}
+
+#endif
@@ -0,0 +1,181 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Loading PointSets from disk (native builds).
+//  - CSV: one point per line, comma (or whitespace) separated. Lines that don't parse as numbers
+//    (e.g., a header) are skipped. Dimensionality comes from the first numeric line.
+//  - Raw binary: packed little-endian float64 (or float32) coordinates, point-major; the caller
+//    supplies the dimensionality.
+//  The Stream* variants read the file in fixed-size chunks and hand each point to a callback, so
+//  files larger than memory can be consumed (e.g., by MiniBatchKMeans).
+
+#ifndef CLUSTERING_POINT_IO_H
+#define CLUSTERING_POINT_IO_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "base/vector.h"
+
+#include "PointSet.h"
+
+namespace clustering {
+
+  namespace internal {
+
+    /// Parse one line of numbers into row. Returns false if something on the line isn't a number.
+    inline bool ParseCSVRow(const char * pos, const char * line_end, emp::vector<double> & row) {
+      row.clear();
+      while (pos < line_end) {
+        while (pos < line_end && (*pos == ',' || *pos == ' ' || *pos == '\t' || *pos == '\r')) ++pos;
+        if (pos >= line_end) break;
+        char * num_end = nullptr;
+        const double val = std::strtod(pos, &num_end);
+        if (num_end == pos) return false;
+        row.push_back(val);
+        pos = num_end;
+      }
+      return true;
+    }
+
+  }
+
+  /// Read a CSV file chunk by chunk, calling fun(const double * pt, size_t dims) for each point.
+  /// Returns false (and sets error) on failure.
+  template <typename FUN_T>
+  bool StreamCSV(const std::string & path, FUN_T && fun, std::string & error) {
+    FILE * file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) { error = "could not open '" + path + "'"; return false; }
+    constexpr size_t CHUNK_SIZE = 1 << 22;
+    emp::vector<char> chunk(CHUNK_SIZE);
+    std::string buffer;   // Unparsed text: the tail of the previous chunk plus the current one.
+    emp::vector<double> row;
+    size_t dims = 0;
+    size_t line_num = 0;
+    bool at_eof = false;
+    while (!at_eof) {
+      const size_t bytes_read = std::fread(chunk.data(), 1, CHUNK_SIZE, file);
+      at_eof = bytes_read < CHUNK_SIZE;
+      buffer.append(chunk.data(), bytes_read);
+      const char * cur = buffer.c_str();
+      const char * end = cur + buffer.size();
+      while (cur < end) {
+        const char * line_end = cur;
+        while (line_end < end && *line_end != '\n') ++line_end;
+        if (line_end == end && !at_eof) break;   // Partial line: wait for the next chunk.
+        ++line_num;
+        const bool ok = internal::ParseCSVRow(cur, line_end, row);
+        cur = line_end + 1;
+        if (!ok || row.empty()) continue;   // Header/blank line.
+        if (dims == 0) dims = row.size();
+        if (row.size() != dims) {
+          std::fclose(file);
+          error = "line " + std::to_string(line_num) + " has " + std::to_string(row.size())
+                + " values (expected " + std::to_string(dims) + ")";
+          return false;
+        }
+        fun(row.data(), dims);
+      }
+      buffer.erase(0, std::min((size_t)(cur - buffer.c_str()), buffer.size()));
+    }
+    std::fclose(file);
+    if (dims == 0) { error = "no numeric rows in '" + path + "'"; return false; }
+    return true;
+  }
+
+  /// Load points from a CSV file into points (a PointSet or PointSetF). Returns false (and sets
+  /// error) on failure.
+  template <typename T>
+  inline bool LoadCSV(const std::string & path, BasicPointSet<T> & points, std::string & error) {
+    bool first = true;
+    return StreamCSV(path, [&points, &first](const double * pt, size_t dims) {
+      if (first) { points.Reset(dims); first = false; }
+      points.AddPoint(pt);
+    }, error);
+  }
+
+  /// Read packed binary coordinates chunk by chunk, calling fun(const double * pt, size_t dims)
+  /// for each point. Returns false (and sets error) on failure.
+  template <typename FUN_T>
+  bool StreamBinary(const std::string & path, size_t dims, bool is_float32, FUN_T && fun, std::string & error) {
+    if (dims == 0) { error = "binary input needs a dimensionality"; return false; }
+    FILE * file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) { error = "could not open '" + path + "'"; return false; }
+    std::fseek(file, 0, SEEK_END);
+    const long file_size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    const size_t value_size = is_float32 ? sizeof(float) : sizeof(double);
+    const size_t num_values = (size_t)std::max(file_size, 0L) / value_size;
+    if (num_values % dims != 0) {
+      std::fclose(file);
+      error = "file size is not a whole number of " + std::to_string(dims) + "-D points";
+      return false;
+    }
+    const size_t chunk_points = std::max<size_t>((1 << 20) / dims, 1);
+    emp::vector<float> chunk_f32(is_float32 ? chunk_points * dims : 0);
+    emp::vector<double> chunk(chunk_points * dims);
+    size_t done = 0;
+    const size_t num_points = num_values / dims;
+    while (done < num_points) {
+      const size_t want = std::min(chunk_points, num_points - done);
+      bool ok;
+      if (is_float32) {
+        ok = std::fread(chunk_f32.data(), sizeof(float), want * dims, file) == want * dims;
+        for (size_t i = 0; ok && i < want * dims; ++i) chunk[i] = chunk_f32[i];
+      } else {
+        ok = std::fread(chunk.data(), sizeof(double), want * dims, file) == want * dims;
+      }
+      if (!ok) { std::fclose(file); error = "short read from '" + path + "'"; return false; }
+      for (size_t i = 0; i < want; ++i) fun(chunk.data() + i * dims, dims);
+      done += want;
+    }
+    std::fclose(file);
+    return true;
+  }
+
+  /// Load packed binary coordinates (into a PointSet or PointSetF; float32 files load into a
+  /// PointSetF without a detour through double). Returns false (and sets error) on failure.
+  template <typename T>
+  inline bool LoadBinary(const std::string & path, size_t dims, bool is_float32, BasicPointSet<T> & points,
+                         std::string & error) {
+    if (dims == 0) { error = "binary input needs a dimensionality"; return false; }
+    FILE * file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) { error = "could not open '" + path + "'"; return false; }
+    std::fseek(file, 0, SEEK_END);
+    const long file_size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    const size_t value_size = is_float32 ? sizeof(float) : sizeof(double);
+    const size_t num_values = (size_t)std::max(file_size, 0L) / value_size;
+    if (num_values % dims != 0) {
+      std::fclose(file);
+      error = "file size is not a whole number of " + std::to_string(dims) + "-D points";
+      return false;
+    }
+    points.Reset(dims);
+    points.Resize(num_values / dims);
+    emp::vector<float> chunk(is_float32 ? (1 << 20) : 0);
+    size_t done = 0;
+    bool ok = true;
+    if (is_float32) {
+      while (ok && done < num_values) {
+        const size_t want = std::min(chunk.size(), num_values - done);
+        ok = std::fread(chunk.data(), sizeof(float), want, file) == want;
+        for (size_t i = 0; ok && i < want; ++i) points.Set((done + i) / dims, (done + i) % dims, chunk[i]);
+        done += want;
+      }
+    } else {
+      emp::vector<double> values(num_values);
+      ok = std::fread(values.data(), sizeof(double), num_values, file) == num_values;
+      for (size_t i = 0; ok && i < num_values; ++i) points.Set(i / dims, i % dims, (T) values[i]);
+    }
+    std::fclose(file);
+    if (!ok) { error = "short read from '" + path + "'"; return false; }
+    return true;
+  }
+
+}
+
+#endif
@@ -0,0 +1,88 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+
+#ifndef CLUSTERING_POINT_SET_H
+#define CLUSTERING_POINT_SET_H
+
+#include <cstddef>
+
+#include "base/vector.h"
+
+namespace clustering {
+
+  /// A set of D-dimensional points stored structure-of-arrays: one contiguous column of
+  /// coordinates per dimension (point i, dimension d lives at GetColumn(d)[i]). Distance kernels
+  /// stream these columns with unit stride.
+  ///
+  /// T is the coordinate type: double (PointSet) or float (PointSetF, half the memory and twice
+  /// the SIMD lanes; plenty for canvas-scale and most real data). Points go in and come out as
+  /// any arithmetic type and are converted on the way.
+  template <typename T>
+  class BasicPointSet {
+  protected:
+    emp::vector<emp::vector<T>> columns;  //< One coordinate column per dimension.
+    size_t num_points;
+
+  public:
+    using value_t = T;
+
+    BasicPointSet(size_t _dims = 2) : columns(_dims), num_points(0) { ; }
+
+    size_t GetDims() const { return columns.size(); }
+    size_t GetSize() const { return num_points; }
+    bool IsEmpty() const { return num_points == 0; }
+
+    T Get(size_t i, size_t d) const { return columns[d][i]; }
+    void Set(size_t i, size_t d, T val) { columns[d][i] = val; }
+    const T * GetColumn(size_t d) const { return columns[d].data(); }
+    T * GetColumn(size_t d) { return columns[d].data(); }
+
+    /// Copy point i into out (GetDims() values).
+    template <typename OUT_T>
+    void GetPoint(size_t i, OUT_T * out) const {
+      for (size_t d = 0; d < columns.size(); ++d) out[d] = (OUT_T) columns[d][i];
+    }
+
+    /// Reset to an empty set of points with the given dimensionality.
+    void Reset(size_t _dims) { columns.clear(); columns.resize(_dims); num_points = 0; }
+    void Clear() { for (auto & col : columns) col.clear(); num_points = 0; }
+    void Reserve(size_t n) { for (auto & col : columns) col.reserve(n); }
+    void Resize(size_t n) { for (auto & col : columns) col.resize(n, (T) 0); num_points = n; }
+
+    /// Replace the contents with a copy of other (converting coordinates to T).
+    template <typename OTHER_T>
+    void CopyFrom(const BasicPointSet<OTHER_T> & other) {
+      Reset(other.GetDims());
+      for (size_t d = 0; d < columns.size(); ++d) {
+        const OTHER_T * col = other.GetColumn(d);
+        columns[d].assign(col, col + other.GetSize());
+      }
+      num_points = other.GetSize();
+    }
+
+    /// Append a point (reads GetDims() values from pt).
+    template <typename IN_T>
+    void AddPoint(const IN_T * pt) {
+      for (size_t d = 0; d < columns.size(); ++d) columns[d].push_back((T) pt[d]);
+      ++num_points;
+    }
+    /// Remove point i by moving the last point into its slot (O(dims); doesn't preserve order).
+    void SwapRemove(size_t i) {
+      for (auto & col : columns) { col[i] = col.back(); col.pop_back(); }
+      --num_points;
+    }
+    /// Append a 2-D point.
+    void AddPoint(double x, double y) {
+      columns[0].push_back((T) x);
+      columns[1].push_back((T) y);
+      ++num_points;
+    }
+  };
+
+  using PointSet = BasicPointSet<double>;
+  using PointSetF = BasicPointSet<float>;
+
+}
+
+#endif
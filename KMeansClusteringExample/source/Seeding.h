@@ -0,0 +1,312 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  Choosing initial centroids.
+//  - k-means++ (Arthur & Vassilvitskii, 2007): pick each new centroid with probability
+//    proportional to D^2 (squared distance to the nearest centroid chosen so far). K passes.
+//  - k-means|| (Bahmani et al., "Scalable K-Means++", 2012): oversample ~l points per round with
+//    probability l * D^2 / sum(D^2) for a handful of rounds, weight each candidate by how many
+//    points it's closest to, then run weighted k-means++ on the (small) candidate set.
+//  Both update D^2 with the SIMD assignment kernel, split across a ThreadPool; each thread keeps
+//  its own partial sum of D^2 so sampling never needs a serial pass over all points.
+//  Both accept optional per-point weights (e.g., a coreset): a point of weight w counts as w
+//  copies of itself, so sampling is by w * D^2.
+//  Points may be double (PointSet) or float32 (PointSetF); centroids always come out as double.
+
+#ifndef CLUSTERING_SEEDING_H
+#define CLUSTERING_SEEDING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "PointSet.h"
+#include "AssignKernel.h"
+#include "ThreadPool.h"
+
+namespace clustering {
+
+  /// How should KMeans pick its starting point?
+  enum class SeedMethod { RANDOM_PARTITION, KMEANS_PLUS_PLUS, KMEANS_PARALLEL };
+
+  inline const char * GetSeedMethodName(SeedMethod method) {
+    switch (method) {
+      case SeedMethod::RANDOM_PARTITION: return "random";
+      case SeedMethod::KMEANS_PARALLEL: return "kmeans||";
+      default: return "kmeans++";
+    }
+  }
+
+  /// Parse a seeding method name (as printed by GetSeedMethodName). Returns false if unknown.
+  inline bool ParseSeedMethod(const std::string & name, SeedMethod & method) {
+    for (SeedMethod m : { SeedMethod::RANDOM_PARTITION, SeedMethod::KMEANS_PLUS_PLUS, SeedMethod::KMEANS_PARALLEL }) {
+      if (name == GetSeedMethodName(m)) { method = m; return true; }
+    }
+    return false;
+  }
+
+  namespace internal {
+
+    /// Stateless hash -> uniform double in [0, 1). Lets every point draw its own random number
+    /// without sharing an RNG across threads (and independent of the thread count).
+    inline double HashUniform(uint64_t seed, uint64_t i) {
+      uint64_t z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      z ^= z >> 31;
+      return (double)(z >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /// Pick an index with probability proportional to weights[i] (uniformly if weights is null).
+    inline size_t SampleByWeight(const double * weights, size_t n, emp::Random & random) {
+      if (weights == nullptr) return random.GetUInt(n);
+      double total = 0.0;
+      for (size_t i = 0; i < n; ++i) total += weights[i];
+      double target = random.GetDouble(total);
+      for (size_t i = 0; i < n; ++i) {
+        if (target < weights[i]) return i;
+        target -= weights[i];
+      }
+      return n - 1;
+    }
+
+    /// Per-point D^2 to the nearest chosen centroid, plus per-thread partial sums (of w * D^2
+    /// if the points are weighted). Distances are measured in the points' coordinate type T.
+    template <typename T>
+    class SquaredDistanceTable {
+    protected:
+      const BasicPointSet<T> & points;
+      const double * weights;             //< Per-point weights (null = all 1).
+      ThreadPool & pool;
+      emp::vector<double> dist_sq;        //< D^2 for each point.
+      emp::vector<double> thread_sums;    //< Sum of (weighted) dist_sq over each thread's range.
+      emp::vector<const T *> cols;
+      emp::vector<size_t> scratch_ids;
+      emp::vector<T> scratch_dist;
+
+    public:
+      SquaredDistanceTable(const BasicPointSet<T> & _points, ThreadPool & _pool, const double * _weights = nullptr)
+        : points(_points), weights(_weights), pool(_pool), dist_sq(_points.GetSize(), std::numeric_limits<double>::max()),
+          thread_sums(_pool.GetNumThreads(), 0.0), cols(_points.GetDims()),
+          scratch_ids(_points.GetSize()), scratch_dist(_points.GetSize())
+      {
+        for (size_t d = 0; d < points.GetDims(); ++d) cols[d] = points.GetColumn(d);
+      }
+
+      double Get(size_t i) const { return dist_sq[i]; }
+      /// Sampling mass of point i: w * D^2.
+      double GetMass(size_t i) const { return weights ? weights[i] * dist_sq[i] : dist_sq[i]; }
+
+      double GetTotal() const {
+        double total = 0.0;
+        for (double sum : thread_sums) total += sum;
+        return total;
+      }
+
+      /// Fold in new centroids (cent_t: dims x num_new, transposed) and refresh the partial sums.
+      void Update(const T * cent_t, size_t num_new) {
+        const size_t dims = points.GetDims();
+        pool.ForRanges(points.GetSize(), [this, cent_t, num_new, dims](size_t t, size_t begin, size_t end) {
+          AssignNearestBlock(cols.data(), dims, begin, end, cent_t, num_new, scratch_ids.data(), scratch_dist.data());
+          double sum = 0.0;
+          for (size_t i = begin; i < end; ++i) {
+            dist_sq[i] = std::min(dist_sq[i], (double) scratch_dist[i]);
+            sum += GetMass(i);
+          }
+          thread_sums[t] = sum;
+        });
+      }
+
+      /// Find the point where the running sum of (w *) D^2 passes target (target in [0, GetTotal())).
+      /// Only the one thread range that contains target is scanned.
+      size_t Sample(double target) const {
+        const size_t n = points.GetSize();
+        for (size_t t = 0; t < thread_sums.size(); ++t) {
+          size_t begin, end;
+          pool.GetRange(n, t, begin, end);
+          if (target >= thread_sums[t] && t + 1 < thread_sums.size()) { target -= thread_sums[t]; continue; }
+          size_t last = begin;
+          for (size_t i = begin; i < end; ++i) {
+            const double mass = GetMass(i);
+            if (mass <= 0.0) continue;
+            last = i;
+            if (target < mass) return i;
+            target -= mass;
+          }
+          return last;   // Rounding ran us off the end of the range.
+        }
+        return n - 1;
+      }
+    };
+
+    /// Transpose rows [first, first + count) of a row-major centroid buffer into cent_t.
+    template <typename T>
+    inline void TransposeRows(const emp::vector<double> & rows, size_t first, size_t count, size_t dims,
+                              emp::vector<T> & cent_t) {
+      cent_t.resize(count * dims);
+      for (size_t c = 0; c < count; ++c) {
+        for (size_t d = 0; d < dims; ++d) cent_t[d * count + c] = (T) rows[(first + c) * dims + d];
+      }
+    }
+
+    /// Weighted k-means++ over a small row-major candidate set, followed by a few weighted Lloyd
+    /// iterations. Serial: the candidate set is O(rounds * l) points.
+    inline void ReduceCandidates(const emp::vector<double> & cands, const emp::vector<double> & weights,
+                                 size_t dims, size_t K, emp::Random & random, emp::vector<double> & centroids) {
+      const size_t m = weights.size();
+      auto dist_to = [&cands, dims](size_t i, const double * cent) {
+        double dist = 0.0;
+        for (size_t d = 0; d < dims; ++d) { const double diff = cands[i * dims + d] - cent[d]; dist += diff * diff; }
+        return dist;
+      };
+      centroids.resize(K * dims);
+      emp::vector<double> best(m, std::numeric_limits<double>::max());
+      for (size_t c = 0; c < K; ++c) {
+        // First pick is weighted by point count, the rest by weight * D^2.
+        double total = 0.0;
+        for (size_t i = 0; i < m; ++i) total += (c == 0) ? weights[i] : weights[i] * best[i];
+        size_t pick = random.GetUInt(m);
+        if (total > 0.0) {
+          double target = random.GetDouble(total);
+          for (size_t i = 0; i < m; ++i) {
+            const double w = (c == 0) ? weights[i] : weights[i] * best[i];
+            if (w <= 0.0) continue;
+            pick = i;
+            if (target < w) break;
+            target -= w;
+          }
+        }
+        std::copy(cands.begin() + pick * dims, cands.begin() + (pick + 1) * dims, centroids.begin() + c * dims);
+        for (size_t i = 0; i < m; ++i) best[i] = std::min(best[i], dist_to(i, centroids.data() + c * dims));
+      }
+      // Polish with weighted Lloyd iterations on the candidates.
+      constexpr size_t LLOYD_ITERS = 5;
+      emp::vector<double> sums(K * dims);
+      emp::vector<double> mass(K);
+      for (size_t iter = 0; iter < LLOYD_ITERS; ++iter) {
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(mass.begin(), mass.end(), 0.0);
+        for (size_t i = 0; i < m; ++i) {
+          size_t best_c = 0;
+          double best_dist = std::numeric_limits<double>::max();
+          for (size_t c = 0; c < K; ++c) {
+            const double dist = dist_to(i, centroids.data() + c * dims);
+            if (dist < best_dist) { best_dist = dist; best_c = c; }
+          }
+          mass[best_c] += weights[i];
+          for (size_t d = 0; d < dims; ++d) sums[best_c * dims + d] += weights[i] * cands[i * dims + d];
+        }
+        for (size_t c = 0; c < K; ++c) {
+          if (mass[c] <= 0.0) continue;
+          for (size_t d = 0; d < dims; ++d) centroids[c * dims + d] = sums[c * dims + d] / mass[c];
+        }
+      }
+    }
+
+  }
+
+  /// k-means++: fill centroids (row-major K x dims) with K points chosen by D^2 sampling.
+  /// (weights: optional, one per point.)
+  template <typename T>
+  inline void SeedKMeansPlusPlus(const BasicPointSet<T> & points, size_t K, emp::Random & random, ThreadPool & pool,
+                                 emp::vector<double> & centroids, const double * weights = nullptr) {
+    const size_t n = points.GetSize();
+    const size_t dims = points.GetDims();
+    centroids.resize(K * dims);
+    if (n == 0) return;
+    internal::SquaredDistanceTable<T> table(points, pool, weights);
+    emp::vector<T> cent_t(dims);
+    size_t pick = internal::SampleByWeight(weights, n, random);
+    for (size_t c = 0; c < K; ++c) {
+      if (c > 0) {
+        const double total = table.GetTotal();
+        // Everything already sits on a centroid (fewer distinct points than K): pick uniformly.
+        pick = (total > 0.0) ? table.Sample(random.GetDouble(total)) : random.GetUInt(n);
+      }
+      points.GetPoint(pick, centroids.data() + c * dims);
+      if (c + 1 < K) {
+        internal::TransposeRows(centroids, c, 1, dims, cent_t);
+        table.Update(cent_t.data(), 1);
+      }
+    }
+  }
+
+  /// k-means||: rounds of oversampling (expected oversampling * K new candidates per round), then
+  /// weighted k-means++ on the candidates. Far fewer passes over the data than k-means++ for large K.
+  /// The default l = 0.5K, 5 rounds is the cheap end of what Bahmani et al. found works as well as
+  /// k-means++ (larger l mostly adds distance work). (weights: optional, one per point.)
+  template <typename T>
+  inline void SeedKMeansParallel(const BasicPointSet<T> & points, size_t K, emp::Random & random, ThreadPool & pool,
+                                 emp::vector<double> & centroids, const double * weights = nullptr,
+                                 size_t rounds = 5, double oversampling = 0.5) {
+    const size_t n = points.GetSize();
+    const size_t dims = points.GetDims();
+    centroids.resize(K * dims);
+    if (n == 0) return;
+    internal::SquaredDistanceTable<T> table(points, pool, weights);
+    emp::vector<double> cands(dims);          // Row-major candidate centroids.
+    emp::vector<T> cent_t;
+    points.GetPoint(internal::SampleByWeight(weights, n, random), cands.data());
+    internal::TransposeRows(cands, 0, 1, dims, cent_t);
+    table.Update(cent_t.data(), 1);
+    const double l = oversampling * (double) K;
+    const size_t num_threads = pool.GetNumThreads();
+    emp::vector<emp::vector<size_t>> picked(num_threads);
+    for (size_t round = 0; round < rounds; ++round) {
+      const double total = table.GetTotal();
+      if (total <= 0.0) break;
+      const uint64_t round_seed = ((uint64_t) random.GetUInt() << 32) | random.GetUInt();
+      // Each point is picked independently with probability min(1, l * w * D^2 / total).
+      pool.ForRanges(n, [&](size_t t, size_t begin, size_t end) {
+        picked[t].clear();
+        for (size_t i = begin; i < end; ++i) {
+          if (internal::HashUniform(round_seed, i) * total < l * table.GetMass(i)) picked[t].push_back(i);
+        }
+      });
+      const size_t first_new = cands.size() / dims;
+      for (const auto & ids : picked) {
+        for (size_t i : ids) {
+          cands.resize(cands.size() + dims);
+          points.GetPoint(i, cands.data() + cands.size() - dims);
+        }
+      }
+      const size_t num_new = cands.size() / dims - first_new;
+      if (num_new == 0) continue;
+      internal::TransposeRows(cands, first_new, num_new, dims, cent_t);
+      table.Update(cent_t.data(), num_new);
+    }
+    // Too few distinct candidates (e.g., heavily duplicated data): top up with random points.
+    while (cands.size() / dims < K) {
+      cands.resize(cands.size() + dims);
+      points.GetPoint(random.GetUInt(n), cands.data() + cands.size() - dims);
+    }
+
+    // Weight each candidate by how many points (or how much weight) are nearest to it (per-thread
+    // sums, then combined).
+    const size_t m = cands.size() / dims;
+    internal::TransposeRows(cands, 0, m, dims, cent_t);
+    emp::vector<const T *> cols(dims);
+    for (size_t d = 0; d < dims; ++d) cols[d] = points.GetColumn(d);
+    emp::vector<size_t> nearest(n);
+    emp::vector<T> nearest_dist(n);
+    emp::vector<emp::vector<double>> thread_weights(num_threads);
+    pool.ForRanges(n, [&](size_t t, size_t begin, size_t end) {
+      AssignNearestBlock(cols.data(), dims, begin, end, cent_t.data(), m, nearest.data(), nearest_dist.data());
+      thread_weights[t].assign(m, 0.0);
+      for (size_t i = begin; i < end; ++i) thread_weights[t][nearest[i]] += weights ? weights[i] : 1.0;
+    });
+    emp::vector<double> cand_weights(m, 0.0);
+    for (const auto & tw : thread_weights) {
+      for (size_t c = 0; c < m; ++c) cand_weights[c] += tw[c];
+    }
+    internal::ReduceCandidates(cands, cand_weights, dims, K, random, centroids);
+  }
+
+}
+
+#endif
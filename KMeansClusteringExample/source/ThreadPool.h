@@ -0,0 +1,202 @@
+//  This file is part of Project Name
+//  Copyright (C) Michigan State University, 2017.
+//  Released under the MIT Software license; see doc/LICENSE
+//
+//  A minimal fork-join thread pool for the clustering engines. Work is always split into the same
+//  contiguous ranges for a given thread count, so per-thread partial results can be combined in a
+//  fixed order (results are reproducible for a fixed number of threads).
+//  Web builds have no pthreads: there (or with one thread) everything runs on the calling thread.
+//  ThreadBuffers gives each thread a private, cache-line-aligned accumulation buffer (so threads
+//  never write to the same line) and folds them together with a fixed-shape tree reduction.
+
+#ifndef CLUSTERING_THREAD_POOL_H
+#define CLUSTERING_THREAD_POOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#ifndef __EMSCRIPTEN__
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "base/vector.h"
+
+namespace clustering {
+
+  class ThreadPool {
+  protected:
+    size_t num_threads;                      //< Including the calling thread.
+#ifndef __EMSCRIPTEN__
+    emp::vector<std::thread> workers;        //< num_threads - 1 helpers.
+    std::mutex mutex;
+    std::condition_variable wake;            //< Signals helpers that a new job (or shutdown) is ready.
+    std::condition_variable done;            //< Signals the caller that helpers finished.
+    std::function<void(size_t)> job;         //< Current job: called with the thread id.
+    size_t generation;                       //< Bumped for every job so helpers don't rerun one.
+    size_t pending;                          //< Helpers still working on the current job.
+    bool stopping;
+
+    void WorkerLoop(size_t thread_id) {
+      size_t seen = 0;
+      while (true) {
+        std::function<void(size_t)> * cur_job;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+          if (stopping) return;
+          seen = generation;
+          cur_job = &job;
+        }
+        (*cur_job)(thread_id);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) done.notify_one();
+      }
+    }
+
+    void StopWorkers() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      wake.notify_all();
+      for (auto & worker : workers) worker.join();
+      workers.clear();
+      stopping = false;
+    }
+#endif
+
+  public:
+    ThreadPool(size_t _num_threads = 1) : num_threads(1)
+#ifndef __EMSCRIPTEN__
+      , workers(), mutex(), wake(), done(), job(), generation(0), pending(0), stopping(false)
+#endif
+    {
+      SetNumThreads(_num_threads);
+    }
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+    ~ThreadPool() {
+#ifndef __EMSCRIPTEN__
+      StopWorkers();
+#endif
+    }
+
+    size_t GetNumThreads() const { return num_threads; }
+
+    /// How many hardware threads does this machine have? (1 for web builds.)
+    static size_t GetHardwareThreads() {
+#ifndef __EMSCRIPTEN__
+      return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#else
+      return 1;
+#endif
+    }
+
+    /// Resize the pool (0 = one per hardware thread).
+    void SetNumThreads(size_t _num_threads) {
+      if (_num_threads == 0) _num_threads = GetHardwareThreads();
+#ifndef __EMSCRIPTEN__
+      if (_num_threads == num_threads && workers.size() + 1 == num_threads) return;
+      StopWorkers();
+      num_threads = _num_threads;
+      for (size_t t = 1; t < num_threads; ++t) workers.emplace_back([this, t]() { WorkerLoop(t); });
+#else
+      num_threads = 1;
+#endif
+    }
+
+    /// Call fun(thread_id) once on every thread (the caller runs thread 0); returns when all finish.
+    void RunOnAll(const std::function<void(size_t)> & fun) {
+#ifndef __EMSCRIPTEN__
+      if (num_threads > 1) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          job = fun;
+          pending = num_threads - 1;
+          ++generation;
+        }
+        wake.notify_all();
+        fun(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]() { return pending == 0; });
+        return;
+      }
+#endif
+      fun(0);
+    }
+
+    /// Range [begin, end) of n items handled by thread thread_id (same split every time).
+    void GetRange(size_t n, size_t thread_id, size_t & begin, size_t & end) const {
+      begin = n * thread_id / num_threads;
+      end = n * (thread_id + 1) / num_threads;
+    }
+
+    /// Split [0, n) into one contiguous range per thread and call fun(thread_id, begin, end).
+    template <typename FUN_T>
+    void ForRanges(size_t n, FUN_T && fun) {
+      RunOnAll([this, n, &fun](size_t thread_id) {
+        size_t begin, end;
+        GetRange(n, thread_id, begin, end);
+        fun(thread_id, begin, end);
+      });
+    }
+  };
+
+  /// One private buffer of len values per thread, each starting on its own cache line.
+  template <typename T>
+  class ThreadBuffers {
+  protected:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t LINE_VALUES = (CACHE_LINE + sizeof(T) - 1) / sizeof(T);
+
+    emp::vector<T> storage;
+    size_t offset;        //< Index of the first cache-line-aligned value in storage.
+    size_t stride;        //< Values between consecutive buffers (len rounded up to whole lines).
+    size_t num_buffers;
+    size_t len;
+
+  public:
+    ThreadBuffers() : storage(), offset(0), stride(0), num_buffers(0), len(0) { ; }
+
+    size_t GetNumBuffers() const { return num_buffers; }
+    size_t GetLength() const { return len; }
+    T * Get(size_t id) { return storage.data() + offset + id * stride; }
+    const T * Get(size_t id) const { return storage.data() + offset + id * stride; }
+
+    /// Make room for _num_buffers buffers of _len values each (contents unspecified).
+    void Resize(size_t _num_buffers, size_t _len) {
+      num_buffers = _num_buffers;
+      len = _len;
+      stride = (len + LINE_VALUES - 1) / LINE_VALUES * LINE_VALUES;
+      storage.resize(num_buffers * stride + LINE_VALUES);
+      const size_t misalign = (size_t)((uintptr_t) storage.data() % CACHE_LINE);
+      offset = misalign ? (CACHE_LINE - misalign) / sizeof(T) : 0;
+    }
+
+    /// Zero buffer id.
+    void Clear(size_t id) { std::fill(Get(id), Get(id) + len, T()); }
+
+    /// Sum all buffers into buffer 0 with a pairwise tree (buffer 0 += 1, 2 += 3, ..., then 0 += 2,
+    /// ...). The tree's shape only depends on the number of buffers, so the result is bit-for-bit
+    /// reproducible. Values are split across the pool; each thread reduces its own slice.
+    void TreeReduce(ThreadPool & pool) {
+      if (num_buffers < 2) return;
+      pool.ForRanges(len, [this](size_t, size_t begin, size_t end) {
+        for (size_t step = 1; step < num_buffers; step *= 2) {
+          for (size_t id = 0; id + step < num_buffers; id += 2 * step) {
+            T * dest = Get(id);
+            const T * src = Get(id + step);
+            for (size_t i = begin; i < end; ++i) dest[i] += src[i];
+          }
+        }
+      });
+    }
+  };
+
+}
+
+#endif
@@ -0,0 +1,337 @@
+// Benchmark suite for the NATIVE clustering engines: generates reproducible synthetic workloads,
+// runs every clustering strategy on each, and reports time, iterations, memory and quality
+// (inertia, and adjusted Rand index against the generating labels).
+//
+// Usage: kmeans_benchmark [options]
+//   --workloads A,B,...   datasets to run (default: all): blobs, many-blobs, anisotropic,
+//                         varying-density, high-d
+//   --strategies A,B,...  engines to run (default: all): auto, naive, hamerly, elkan, kdtree,
+//                         minibatch, coreset, and auto-f32 ... kdtree-f32 (the same k-means
+//                         strategies on float32 coordinates)
+//   --scale F             multiply every workload's point count by F (default: 1)
+//   --repeats R           time each case R times and keep the fastest (default: 3)
+//   --threads N           worker threads (default: 1, for stable timings; 0 = one per hardware thread)
+//   --max-iters N         iteration cap per run (default: 100)
+//   --seed S              random seed for data and engines (default: 1)
+//   --report FILE         write the results as tab-separated values (one row per case)
+//   --baseline FILE       compare against an earlier report; exits with status 2 on regressions
+//   --tolerance F         slowdown allowed before a case counts as a regression (default: 0.25)
+//
+// Every case with the same seed and thread count is deterministic, so quality columns should match
+// a baseline exactly; only times move. Memory is the peak resident growth during the run (Linux).
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "tools/Random.h"
+
+#include "../PointSet.h"
+#include "../KMeans.h"
+#include "../MiniBatchKMeans.h"
+#include "../Coreset.h"
+#include "../PointGenerator.h"
+#include "../ClusterMetrics.h"
+
+/// A synthetic dataset: generator, size and the K it was drawn with.
+struct Workload {
+  std::string name;
+  size_t num_points;
+  size_t dims;
+  size_t k;
+};
+
+/// What one benchmark case measured.
+struct Measurement {
+  double seconds = 0.0;   //< Fastest of the repeats.
+  size_t iterations = 0;
+  double inertia = 0.0;
+  double ari = 0.0;       //< Adjusted Rand index vs. the generating labels.
+  size_t memory_kb = 0;   //< Peak resident growth during the run.
+};
+
+constexpr double EXTENT = 1000.0;
+constexpr size_t MINIBATCH_SIZE = 1024;
+constexpr size_t CORESET_SIZE = 4096;
+
+const emp::vector<Workload> WORKLOADS = {
+  { "blobs", 200000, 2, 10 },
+  { "many-blobs", 200000, 2, 100 },
+  { "anisotropic", 200000, 2, 8 },
+  { "varying-density", 200000, 2, 8 },
+  { "high-d", 50000, 64, 32 },
+};
+const emp::vector<std::string> STRATEGIES = { "auto", "naive", "hamerly", "elkan", "kdtree", "minibatch", "coreset",
+                                              "auto-f32", "naive-f32", "hamerly-f32", "elkan-f32", "kdtree-f32" };
+const std::string F32_SUFFIX = "-f32";
+
+emp::vector<std::string> SplitList(const std::string & list) {
+  emp::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ',')) if (item.size()) items.push_back(item);
+  return items;
+}
+
+/// Read a field (in kB) from /proc/self/status (Linux only; 0 if unknown).
+size_t ReadStatusKB(const std::string & field) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, field.size(), field) == 0) return std::stoul(line.substr(field.size() + 1));
+  }
+  return 0;
+}
+
+/// Restart peak-RSS tracking (VmHWM) from the current RSS, after handing freed heap back to the
+/// OS (otherwise a run that reuses an earlier run's pages would look free).
+void ResetPeakMemory() {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+}
+
+void Generate(const Workload & workload, double scale, int seed, clustering::PointSet & points, emp::vector<size_t> & labels) {
+  emp::Random random(seed);
+  const size_t n = std::max<size_t>((size_t) ((double) workload.num_points * scale), workload.k);
+  const double spread = EXTENT / (8.0 * (double) workload.k);
+  points.Reset(workload.dims);
+  labels.clear();
+  if (workload.name == "anisotropic") {
+    clustering::GenerateAnisotropicBlobs(n, workload.dims, workload.k, EXTENT, spread, random, points, &labels);
+  } else if (workload.name == "varying-density") {
+    clustering::GenerateVaryingDensityBlobs(n, workload.dims, workload.k, EXTENT, spread, random, points, &labels);
+  } else {
+    clustering::GenerateBlobs(n, workload.dims, workload.k, EXTENT, spread, random, points, &labels);
+  }
+}
+
+/// Label every point with its nearest centroid (row-major k x dims); returns the inertia.
+double LabelAll(const clustering::PointSet & points, const emp::vector<double> & centroids, size_t k, emp::vector<size_t> & ids) {
+  const size_t n = points.GetSize();
+  const size_t dims = points.GetDims();
+  emp::vector<double> centroids_t(k * dims);
+  for (size_t c = 0; c < k; ++c) {
+    for (size_t d = 0; d < dims; ++d) centroids_t[d * k + c] = centroids[c * dims + d];
+  }
+  emp::vector<const double *> cols(dims);
+  for (size_t d = 0; d < dims; ++d) cols[d] = points.GetColumn(d);
+  emp::vector<double> dists(n);
+  ids.resize(n);
+  clustering::AssignNearestBlock(cols.data(), dims, 0, n, centroids_t.data(), k, ids.data(), dists.data());
+  double inertia = 0.0;
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t d = 0; d < dims; ++d) {
+      const double diff = points.Get(i, d) - centroids[ids[i] * dims + d];
+      inertia += diff * diff;
+    }
+  }
+  return inertia;
+}
+
+/// Full k-means on points (double or float32 coordinates).
+template <typename T>
+void RunKMeans(const clustering::BasicPointSet<T> & points, clustering::AssignStrategy assign_strategy, size_t k,
+               size_t num_threads, size_t max_iters, emp::Random & random, Measurement & result, emp::vector<size_t> & ids) {
+  clustering::BasicKMeans<T> kmeans(k);
+  kmeans.SetStrategy(assign_strategy);
+  kmeans.SetNumThreads(num_threads);
+  const clustering::KMeansResult run = kmeans.Run(points, random, max_iters);
+  result.iterations = run.iterations;
+  result.inertia = run.inertia;
+  ids = kmeans.GetAssignments();
+}
+
+/// Run one engine once (points_f: the same points in float32). Labels go to ids; returns false
+/// for unknown strategies.
+bool RunStrategy(const std::string & strategy, const clustering::PointSet & points, const clustering::PointSetF & points_f,
+                 size_t k, size_t num_threads, size_t max_iters, int seed, Measurement & result, emp::vector<size_t> & ids) {
+  emp::Random random(seed);
+  clustering::AssignStrategy assign_strategy;
+  if (clustering::ParseAssignStrategy(strategy, assign_strategy)) {
+    RunKMeans(points, assign_strategy, k, num_threads, max_iters, random, result, ids);
+    return true;
+  }
+  const size_t base_size = strategy.size() - std::min(strategy.size(), F32_SUFFIX.size());
+  if (strategy.compare(base_size, std::string::npos, F32_SUFFIX) == 0
+      && clustering::ParseAssignStrategy(strategy.substr(0, base_size), assign_strategy)) {
+    RunKMeans(points_f, assign_strategy, k, num_threads, max_iters, random, result, ids);
+    return true;
+  }
+  emp::vector<double> pt(points.GetDims());
+  if (strategy == "minibatch") {
+    // One pass over the data (the streaming use case).
+    clustering::MiniBatchKMeans model(k, points.GetDims(), MINIBATCH_SIZE);
+    for (size_t i = 0; i < points.GetSize(); ++i) {
+      points.GetPoint(i, pt.data());
+      model.AddPoint(pt.data(), random);
+    }
+    model.Flush(random);
+    const clustering::KMeansSnapshot snapshot = model.GetSnapshot();
+    result.iterations = snapshot.batches;
+    result.inertia = LabelAll(points, snapshot.centroids, k, ids);
+    return true;
+  }
+  if (strategy == "coreset") {
+    clustering::CoresetBuilder builder(k, points.GetDims(), CORESET_SIZE);
+    builder.AddPoints(points, random);
+    clustering::PointSet coreset;
+    emp::vector<double> weights;
+    builder.GetCoreset(random, coreset, weights);
+    clustering::KMeans kmeans(k);
+    kmeans.SetNumThreads(num_threads);
+    kmeans.SetWeights(weights);
+    const clustering::KMeansResult run = kmeans.Run(coreset, random, max_iters);
+    result.iterations = run.iterations;
+    result.inertia = LabelAll(points, kmeans.GetCentroids(), k, ids);
+    return true;
+  }
+  return false;
+}
+
+/// Earlier results, keyed by "workload/strategy".
+bool LoadReport(const std::string & path, std::map<std::string, Measurement> & rows, std::string & error) {
+  std::ifstream file(path);
+  if (!file) { error = "could not open '" + path + "'"; return false; }
+  std::string line;
+  std::getline(file, line);   // Header.
+  while (std::getline(file, line)) {
+    std::stringstream fields(line);
+    std::string workload, strategy, skip;
+    Measurement row;
+    std::getline(fields, workload, '\t');
+    std::getline(fields, strategy, '\t');
+    for (size_t col = 0; col < 4; ++col) std::getline(fields, skip, '\t');   // points, dims, k, threads
+    fields >> row.seconds >> row.iterations >> row.inertia >> row.ari >> row.memory_kb;
+    if (!fields) { error = "malformed row in '" + path + "': " + line; return false; }
+    rows[workload + "/" + strategy] = row;
+  }
+  return true;
+}
+
+void PrintUsage() {
+  std::cout << "Usage: kmeans_benchmark [--workloads A,B,...] [--strategies A,B,...] [--scale F] [--repeats R]"
+               " [--threads N] [--max-iters N] [--seed S] [--report FILE] [--baseline FILE] [--tolerance F]" << std::endl;
+}
+
+int main(int argc, char * argv[])
+{
+  emp::vector<std::string> workload_names;
+  emp::vector<std::string> strategies = STRATEGIES;
+  double scale = 1.0;
+  size_t repeats = 3;
+  size_t num_threads = 1;
+  size_t max_iters = 100;
+  int seed = 1;
+  std::string report_path;
+  std::string baseline_path;
+  double tolerance = 0.25;
+  for (const Workload & workload : WORKLOADS) workload_names.push_back(workload.name);
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_val = i + 1 < argc;
+    if (arg == "--workloads" && has_val) workload_names = SplitList(argv[++i]);
+    else if (arg == "--strategies" && has_val) strategies = SplitList(argv[++i]);
+    else if (arg == "--scale" && has_val) scale = std::stod(argv[++i]);
+    else if (arg == "--repeats" && has_val) repeats = std::max<size_t>(std::stoul(argv[++i]), 1);
+    else if (arg == "--threads" && has_val) num_threads = std::stoul(argv[++i]);
+    else if (arg == "--max-iters" && has_val) max_iters = std::stoul(argv[++i]);
+    else if (arg == "--seed" && has_val) seed = std::stoi(argv[++i]);
+    else if (arg == "--report" && has_val) report_path = argv[++i];
+    else if (arg == "--baseline" && has_val) baseline_path = argv[++i];
+    else if (arg == "--tolerance" && has_val) tolerance = std::stod(argv[++i]);
+    else if (arg == "-h" || arg == "--help") { PrintUsage(); return 0; }
+    else { std::cerr << "Unknown argument: " << arg << std::endl; PrintUsage(); return 1; }
+  }
+  for (const std::string & strategy : strategies) {
+    if (std::find(STRATEGIES.begin(), STRATEGIES.end(), strategy) == STRATEGIES.end()) {
+      std::cerr << "Unknown strategy: " << strategy << std::endl; PrintUsage(); return 1;
+    }
+  }
+  std::map<std::string, Measurement> baseline;
+  std::string error;
+  if (baseline_path.size() && !LoadReport(baseline_path, baseline, error)) {
+    std::cerr << "Error: " << error << std::endl; return 1;
+  }
+
+  std::ofstream report;
+  if (report_path.size()) {
+    report.open(report_path);
+    report.precision(17);
+    report << "workload\tstrategy\tpoints\tdims\tk\tthreads\tseconds\titerations\tinertia\tari\tmemory_kb\n";
+  }
+  std::cout << "Assignment kernel: " << clustering::GetAssignKernelName() << std::endl;
+  std::cout << "Workload\tStrategy\tPoints\tDims\tK\tTime (s)\tIterations\tInertia\tARI\tMemory (kB)\tvs. baseline" << std::endl;
+  size_t regressions = 0;
+  clustering::PointSet points;
+  clustering::PointSetF points_f;
+  emp::vector<size_t> labels, ids;
+  for (const std::string & name : workload_names) {
+    auto workload = std::find_if(WORKLOADS.begin(), WORKLOADS.end(), [&name](const Workload & w) { return w.name == name; });
+    if (workload == WORKLOADS.end()) { std::cerr << "Unknown workload: " << name << std::endl; PrintUsage(); return 1; }
+    Generate(*workload, scale, seed, points, labels);
+    points_f.CopyFrom(points);
+    for (const std::string & strategy : strategies) {
+      Measurement result;
+      for (size_t rep = 0; rep < repeats; ++rep) {
+        Measurement run;
+        ResetPeakMemory();
+        const size_t base_kb = ReadStatusKB("VmRSS:");
+        auto start = std::chrono::steady_clock::now();
+        RunStrategy(strategy, points, points_f, workload->k, num_threads, max_iters, seed, run, ids);
+        auto end = std::chrono::steady_clock::now();
+        const size_t peak_kb = ReadStatusKB("VmHWM:");
+        run.seconds = std::chrono::duration<double>(end - start).count();
+        run.memory_kb = peak_kb > base_kb ? peak_kb - base_kb : 0;
+        if (rep == 0) {
+          result = run;
+          result.ari = clustering::AdjustedRandIndex(ids, labels);
+        }
+        result.seconds = std::min(result.seconds, run.seconds);
+        result.memory_kb = std::max(result.memory_kb, run.memory_kb);
+      }
+
+      // Compare with the baseline: slower beyond tolerance (plus 5 ms of timer noise), or worse
+      // quality at all (runs are deterministic, so any change means the algorithm changed).
+      std::string verdict = "-";
+      auto base = baseline.find(name + "/" + strategy);
+      if (base != baseline.end()) {
+        emp::vector<std::string> problems;
+        if (result.seconds > base->second.seconds * (1.0 + tolerance) + 0.005) {
+          problems.push_back("slower (" + std::to_string(result.seconds / base->second.seconds) + "x)");
+        }
+        if (result.inertia > base->second.inertia * (1.0 + 1e-6)) problems.push_back("higher inertia");
+        if (result.ari < base->second.ari - 1e-6) problems.push_back("lower ARI");
+        verdict = "ok";
+        if (problems.size()) {
+          ++regressions;
+          verdict = "REGRESSION:";
+          for (const std::string & problem : problems) verdict += " " + problem;
+        }
+      }
+      std::cout << name << '\t' << strategy << '\t' << points.GetSize() << '\t' << points.GetDims() << '\t'
+                << workload->k << '\t' << result.seconds << '\t' << result.iterations << '\t' << result.inertia << '\t'
+                << result.ari << '\t' << result.memory_kb << '\t' << verdict << std::endl;
+      if (report.is_open()) {
+        report << name << '\t' << strategy << '\t' << points.GetSize() << '\t' << points.GetDims() << '\t'
+               << workload->k << '\t' << num_threads << '\t' << result.seconds << '\t' << result.iterations << '\t'
+               << result.inertia << '\t' << result.ari << '\t' << result.memory_kb << '\n';
+      }
+    }
+  }
+  if (baseline.size()) {
+    std::cout << regressions << " regression" << (regressions == 1 ? "" : "s") << " vs. " << baseline_path << std::endl;
+    if (regressions) return 2;
+  }
+  return 0;
+}
@@ -1,8 +1,482 @@
 // This is the main function for the NATIVE version of this project.
+//
+// Usage: kmeans_clustering POINTS_FILE [options]
+//        kmeans_clustering --generate MODE [options]
+//   -k K              number of clusters (default: 3)
+//   --binary D        POINTS_FILE is packed float64 coordinates with D dimensions (default: CSV)
+//   --f32             binary coordinates are float32 instead of float64
+//   --precision P     coordinate precision for in-memory clustering: double or float (float32 points
+//                     and distance kernels, double centroid sums; default: double)
+//   --max-iters N     stop after N iterations (default: 300)
+//   --seed S          random seed (default: 1)
+//   --strategy NAME   assignment strategy: auto, naive, hamerly, elkan or kdtree (default: auto)
+//   --init NAME       seeding: random (partition), kmeans++ or kmeans|| (default: kmeans++)
+//   --threads N       worker threads (default: 0 = one per hardware thread)
+//   --minibatch B     stream the file through mini-batch k-means with batches of B points instead
+//                     of loading it (memory stays bounded by K + B points)
+//   --passes N        with --minibatch: how many times to stream the file (default: 1)
+//   --coreset M       stream the file once into a weighted coreset of about M points (merge-and-reduce
+//                     over sensitivity sampling), cluster that, then label the file in a second pass
+//   --mmap IDS_FILE   out of core: memory-map POINTS_FILE (needs --binary D --f32) instead of loading it,
+//                     and keep assignments in IDS_FILE (one uint32 per point, also memory-mapped)
+//   --out FILE        write one cluster id per line to FILE
+//   --crossover K,... instead of clustering once, time the naive and kd-tree strategies for each
+//                     listed K (same seed and --max-iters) to find where filtering starts to pay off
+//   --sweep KMIN-KMAX instead of clustering once, cluster for every K in the range (warm-starting each
+//                     K from K - 1 within fixed segments of 8 K values, which --threads runs
+//                     concurrently; results don't depend on --threads) and report the silhouette, BIC
+//                     and gap statistic of each, plus the best K by each
+//   --generate MODE   cluster a synthetic dataset instead of a file: blobs, rings, uniform or poisson
+//                     (Poisson-disk, i.e. evenly spaced, 2-D)
+//   --points N        with --generate: how many points (default: 100000; poisson fills its square)
+//   --dims D          with --generate blobs/uniform: dimensionality (default: 2)
+//   --blobs B         with --generate blobs/rings: how many blobs/rings (default: K)
+//   --save FILE       with --generate: also write the points to FILE as CSV
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 
-int main()
+#include "tools/Random.h"
+
+#include "../PointSet.h"
+#include "../PointIO.h"
+#include "../KMeans.h"
+#include "../MiniBatchKMeans.h"
+#include "../OutOfCoreKMeans.h"
+#include "../PointGenerator.h"
+#include "../KSweep.h"
+#include "../Coreset.h"
+
+void PrintUsage() {
+  std::cout << "Usage: kmeans_clustering POINTS_FILE [-k K] [--binary DIMS] [--f32] [--precision double|float]"
+               " [--max-iters N] [--seed S]"
+               " [--strategy auto|naive|hamerly|elkan|kdtree] [--init random|kmeans++|kmeans||] [--threads N]"
+               " [--minibatch B [--passes N]] [--coreset M] [--mmap IDS_FILE] [--out FILE] [--crossover K1,K2,...]"
+               " [--sweep KMIN-KMAX]" << std::endl;
+  std::cout << "       kmeans_clustering --generate blobs|rings|uniform|poisson [--points N] [--dims D] [--blobs B]"
+               " [--save FILE] [options]" << std::endl;
+}
+
+/// Stream every point of the input file to fun(const double * pt, size_t dims).
+template <typename FUN_T>
+bool StreamPoints(const std::string & path, size_t binary_dims, bool is_float32, FUN_T && fun, std::string & error) {
+  return binary_dims ? clustering::StreamBinary(path, binary_dims, is_float32, fun, error)
+                     : clustering::StreamCSV(path, fun, error);
+}
+
+/// Stream the file once, assigning each point to its nearest centroid (row-major k x dims).
+/// Sums the inertia and, if out_path is set, writes one cluster id per line.
+bool LabelPoints(const std::string & in_path, size_t binary_dims, bool is_float32, const emp::vector<double> & centroids,
+                 size_t k, const std::string & out_path, double & inertia, std::string & error) {
+  constexpr size_t LABEL_CHUNK = 1 << 16;
+  const size_t dims = centroids.size() / k;
+  emp::vector<double> centroids_t(k * dims);
+  for (size_t c = 0; c < k; ++c) {
+    for (size_t d = 0; d < dims; ++d) centroids_t[d * k + c] = centroids[c * dims + d];
+  }
+  clustering::PointSet chunk(dims);
+  emp::vector<const double *> cols(dims);
+  emp::vector<size_t> ids;
+  emp::vector<double> dists;
+  inertia = 0.0;
+  std::ofstream out;
+  if (out_path.size()) out.open(out_path);
+  auto label_chunk = [&]() {
+    const size_t n = chunk.GetSize();
+    if (n == 0) return;
+    for (size_t d = 0; d < dims; ++d) cols[d] = chunk.GetColumn(d);
+    ids.resize(n);
+    dists.resize(n);
+    clustering::AssignNearestBlock(cols.data(), dims, 0, n, centroids_t.data(), k, ids.data(), dists.data());
+    for (size_t i = 0; i < n; ++i) {
+      const double * centroid = centroids.data() + ids[i] * dims;
+      for (size_t d = 0; d < dims; ++d) {
+        const double diff = chunk.Get(i, d) - centroid[d];
+        inertia += diff * diff;
+      }
+      if (out.is_open()) out << ids[i] << '\n';
+    }
+    chunk.Clear();
+  };
+  const bool ok = StreamPoints(in_path, binary_dims, is_float32, [&](const double * pt, size_t) {
+    chunk.AddPoint(pt);
+    if (chunk.GetSize() == LABEL_CHUNK) label_chunk();
+  }, error);
+  if (!ok) return false;
+  label_chunk();
+  return true;
+}
+
+/// Coreset mode: one pass builds a weighted coreset (O(M log(n / M)) points held), weighted
+/// k-means clusters it, and a second pass labels the file.
+int RunCoreset(const std::string & in_path, size_t binary_dims, bool is_float32, size_t k, size_t coreset_size,
+               size_t max_iters, int seed, clustering::SeedMethod seed_method, size_t num_threads,
+               const std::string & out_path) {
+  emp::Random random(seed);
+  clustering::CoresetBuilder builder(k, 0, coreset_size);
+  size_t peak_held = 0;
+  std::string error;
+  auto run_start = std::chrono::steady_clock::now();
+  const bool ok = StreamPoints(in_path, binary_dims, is_float32, [&](const double * pt, size_t dims) {
+    if (builder.GetDims() != dims) builder.Reset(dims);
+    builder.AddPoint(pt, random);
+    peak_held = std::max(peak_held, builder.GetHeldPoints());
+  }, error);
+  if (!ok) { std::cerr << "Error: " << error << std::endl; return 1; }
+  clustering::PointSet coreset;
+  emp::vector<double> weights;
+  builder.GetCoreset(random, coreset, weights);
+  auto build_end = std::chrono::steady_clock::now();
+
+  clustering::KMeans kmeans(k);
+  kmeans.SetSeedMethod(seed_method);
+  kmeans.SetNumThreads(num_threads);
+  kmeans.SetWeights(weights);
+  const clustering::KMeansResult result = kmeans.Run(coreset, random, max_iters);
+  auto run_end = std::chrono::steady_clock::now();
+
+  double inertia = 0.0;
+  if (!LabelPoints(in_path, binary_dims, is_float32, kmeans.GetCentroids(), kmeans.GetK(), out_path, inertia, error)) {
+    std::cerr << "Error: " << error << std::endl; return 1;
+  }
+  std::cout << "Streamed " << builder.GetPointsSeen() << " " << builder.GetDims() << "-D points into a coreset of "
+            << coreset.GetSize() << " (" << builder.GetNumLevels() << " levels, at most " << peak_held
+            << " points held) in " << std::chrono::duration<double>(build_end - run_start).count() << " s" << std::endl;
+  std::cout << "K: " << kmeans.GetK() << std::endl;
+  std::cout << "Iterations: " << result.iterations << (result.converged ? " (converged)" : " (hit max)") << std::endl;
+  std::cout << "Coreset inertia (estimate): " << result.inertia << std::endl;
+  std::cout << "Inertia: " << inertia << std::endl;
+  std::cout << "Wall time (excluding labeling): " << std::chrono::duration<double>(run_end - run_start).count() << " s" << std::endl;
+  return 0;
+}
+
+/// Mini-batch mode: never holds more than K + batch_size points (plus one labeling chunk).
+int RunMiniBatch(const std::string & in_path, size_t binary_dims, bool is_float32, size_t k, size_t batch_size,
+                 size_t passes, int seed, const std::string & out_path) {
+  emp::Random random(seed);
+  clustering::MiniBatchKMeans model(k, 0, batch_size);
+  std::string error;
+  auto run_start = std::chrono::steady_clock::now();
+  for (size_t pass = 0; pass < passes; ++pass) {
+    const bool ok = StreamPoints(in_path, binary_dims, is_float32, [&model, &random](const double * pt, size_t dims) {
+      if (model.GetDims() != dims) model.Reset(dims);
+      model.AddPoint(pt, random);
+    }, error);
+    if (!ok) { std::cerr << "Error: " << error << std::endl; return 1; }
+    model.Flush(random);
+  }
+  auto run_end = std::chrono::steady_clock::now();
+
+  // One more pass to label points and measure inertia against the final centroids.
+  const clustering::KMeansSnapshot snapshot = model.GetSnapshot();
+  double inertia = 0.0;
+  if (!LabelPoints(in_path, binary_dims, is_float32, snapshot.centroids, snapshot.num_clusters, out_path, inertia, error)) {
+    std::cerr << "Error: " << error << std::endl; return 1;
+  }
+
+  std::cout << "Streamed " << snapshot.points_seen << " " << snapshot.dims << "-D points in "
+            << snapshot.batches << " batches of " << batch_size << " (" << passes << " pass"
+            << (passes == 1 ? "" : "es") << ")" << std::endl;
+  std::cout << "K: " << snapshot.num_clusters << std::endl;
+  std::cout << "Assignment kernel: " << clustering::GetAssignKernelName() << std::endl;
+  std::cout << "Inertia: " << inertia << std::endl;
+  std::cout << "Wall time: " << std::chrono::duration<double>(run_end - run_start).count() << " s" << std::endl;
+  return 0;
+}
+
+/// Peak resident memory of this process in kB (Linux only; 0 if unknown).
+size_t GetPeakMemoryKB() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) return std::stoul(line.substr(6));
+  }
+  return 0;
+}
+
+/// Out-of-core mode: points stay in the (memory-mapped) file; memory is O(K * dims + chunk).
+int RunOutOfCore(const std::string & in_path, size_t binary_dims, bool is_float32, size_t k, size_t max_iters,
+                 int seed, size_t num_threads, const std::string & ids_path, const std::string & out_path) {
+  if (binary_dims == 0 || !is_float32) {
+    std::cerr << "Error: --mmap needs packed float32 points (--binary D --f32)" << std::endl;
+    return 1;
+  }
+  emp::Random random(seed);
+  clustering::OutOfCoreKMeans model(k);
+  model.SetNumThreads(num_threads);
+  std::string error;
+  if (!model.Open(in_path, binary_dims, ids_path, error)) { std::cerr << "Error: " << error << std::endl; return 1; }
+  auto run_start = std::chrono::steady_clock::now();
+  const clustering::KMeansResult result = model.Run(random, max_iters);
+  auto run_end = std::chrono::steady_clock::now();
+  std::cout << "Mapped " << model.GetNumPoints() << " " << model.GetDims() << "-D points (out of core)" << std::endl;
+  std::cout << "K: " << model.GetK() << std::endl;
+  std::cout << "Threads: " << model.GetNumThreads() << std::endl;
+  std::cout << "Assignment kernel: " << clustering::GetAssignKernelName() << std::endl;
+  std::cout << "Iterations: " << result.iterations << (result.converged ? " (converged)" : " (hit max)") << std::endl;
+  std::cout << "Inertia: " << result.inertia << std::endl;
+  std::cout << "Wall time: " << std::chrono::duration<double>(run_end - run_start).count() << " s" << std::endl;
+  if (const size_t peak_kb = GetPeakMemoryKB()) std::cout << "Peak resident memory: " << peak_kb / 1024.0 << " MB" << std::endl;
+  if (out_path.size()) {
+    std::ofstream out(out_path);
+    const uint32_t * ids = model.GetAssignments();
+    for (size_t i = 0; i < model.GetNumPoints(); ++i) out << ids[i] << '\n';
+  }
+  return 0;
+}
+
+/// Build a synthetic dataset (see --generate). Returns false (and sets error) for unknown modes.
+bool GeneratePoints(const std::string & mode, size_t n, size_t dims, size_t num_blobs, emp::Random & random,
+                    clustering::PointSet & points, std::string & error) {
+  constexpr double EXTENT = 1000.0;
+  points.Reset(mode == "rings" || mode == "poisson" ? 2 : dims);
+  if (mode == "blobs") clustering::GenerateBlobs(n, dims, num_blobs, EXTENT, EXTENT / (8.0 * (double) num_blobs), random, points);
+  else if (mode == "rings") clustering::GenerateRings(n, num_blobs, 0.5 * EXTENT, EXTENT / 200.0, random, points);
+  else if (mode == "uniform") clustering::GenerateUniform(n, dims, EXTENT, random, points);
+  else if (mode == "poisson") {
+    // Spacing chosen so a full square holds roughly n points (Bridson packs ~0.62 points per r^2).
+    clustering::PoissonDiskSampler sampler(0.0, 0.0, EXTENT, EXTENT, EXTENT * std::sqrt(0.62 / (double) std::max<size_t>(n, 1)));
+    sampler.Fill(random, points);
+  }
+  else { error = "unknown generator '" + mode + "'"; return false; }
+  return true;
+}
+
+/// Run k-means on points with the given strategy; returns wall time (including any index build).
+template <typename T>
+double TimeStrategy(const clustering::BasicPointSet<T> & points, size_t k, clustering::AssignStrategy strategy,
+                    clustering::SeedMethod seed_method, size_t num_threads, size_t max_iters, int seed,
+                    clustering::KMeansResult & result, emp::vector<size_t> & assignments) {
+  emp::Random random(seed);
+  clustering::BasicKMeans<T> kmeans(k);
+  kmeans.SetStrategy(strategy);
+  kmeans.SetSeedMethod(seed_method);
+  kmeans.SetNumThreads(num_threads);
+  auto start = std::chrono::steady_clock::now();
+  result = kmeans.Run(points, random, max_iters);
+  auto end = std::chrono::steady_clock::now();
+  assignments = kmeans.GetAssignments();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+/// Crossover benchmark: naive vs. kd-tree filtering for each K in k_list.
+template <typename T>
+void RunCrossover(const clustering::BasicPointSet<T> & points, const emp::vector<size_t> & k_list,
+                  clustering::SeedMethod seed_method, size_t num_threads, size_t max_iters, int seed) {
+  std::cout << "K\tIterations\tNaive (s)\tKd-tree (s)\tSpeedup\tSame assignments" << std::endl;
+  clustering::KMeansResult naive_result, kdtree_result;
+  emp::vector<size_t> naive_ids, kdtree_ids;
+  for (size_t k : k_list) {
+    const double naive_time = TimeStrategy(points, k, clustering::AssignStrategy::NAIVE, seed_method,
+                                           num_threads, max_iters, seed, naive_result, naive_ids);
+    const double kdtree_time = TimeStrategy(points, k, clustering::AssignStrategy::KDTREE, seed_method,
+                                            num_threads, max_iters, seed, kdtree_result, kdtree_ids);
+    std::cout << k << '\t' << naive_result.iterations << '\t' << naive_time << '\t' << kdtree_time << '\t'
+              << naive_time / kdtree_time << "x\t" << (naive_ids == kdtree_ids ? "yes" : "no") << std::endl;
+  }
+}
+
+/// Automatic K selection: score every K in [k_min, k_max].
+void RunSweep(const clustering::PointSet & points, size_t k_min, size_t k_max, size_t num_threads,
+              size_t max_iters, int seed) {
+  emp::Random random(seed);
+  clustering::KSweep sweep(k_min, k_max);
+  sweep.SetNumThreads(num_threads);
+  sweep.SetMaxIterations(max_iters);
+  auto start = std::chrono::steady_clock::now();
+  const clustering::KSweepResult result = sweep.Run(points, random);
+  auto end = std::chrono::steady_clock::now();
+  std::cout << "K\tSegment\tIterations\tInertia\tSilhouette\tBIC\tGap\tGap SE\tTime (s)" << std::endl;
+  for (const clustering::KSweepRow & row : result.rows) {
+    std::cout << row.k << '\t' << row.segment << '\t' << row.iterations << (row.converged ? "" : "+") << '\t' << row.inertia << '\t'
+              << row.silhouette << '\t' << row.bic << '\t' << row.gap << '\t' << row.gap_sd << '\t'
+              << row.seconds << std::endl;
+  }
+  std::cout << "Best K by silhouette: " << result.best_silhouette << std::endl;
+  std::cout << "Best K by BIC: " << result.best_bic << std::endl;
+  std::cout << "Best K by gap statistic: " << result.best_gap << std::endl;
+  std::cout << "Threads: " << sweep.GetNumThreads() << std::endl;
+  std::cout << "Wall time: " << std::chrono::duration<double>(end - start).count() << " s" << std::endl;
+}
+
+/// Cluster points in memory and report how it went.
+template <typename T>
+int Cluster(const clustering::BasicPointSet<T> & points, size_t k, clustering::AssignStrategy strategy,
+            clustering::SeedMethod seed_method, size_t num_threads, size_t max_iters, int seed,
+            const std::string & out_path) {
+  emp::Random random(seed);
+  clustering::BasicKMeans<T> kmeans(k);
+  kmeans.SetStrategy(strategy);
+  kmeans.SetSeedMethod(seed_method);
+  kmeans.SetNumThreads(num_threads);
+  auto run_start = std::chrono::steady_clock::now();
+  kmeans.Step(points, random);   // Seeding (plus the first assignment), timed separately.
+  auto seed_end = std::chrono::steady_clock::now();
+  clustering::KMeansResult result = kmeans.Run(points, random, max_iters > 1 ? max_iters - 1 : 0);
+  ++result.iterations;
+  auto run_end = std::chrono::steady_clock::now();
+  std::cout << "K: " << kmeans.GetK() << std::endl;
+  std::cout << "Threads: " << kmeans.GetNumThreads() << std::endl;
+  std::cout << "Seeding: " << clustering::GetSeedMethodName(kmeans.GetSeedMethod()) << " ("
+            << std::chrono::duration<double>(seed_end - run_start).count() << " s)" << std::endl;
+  std::cout << "Assignment kernel: " << clustering::GetAssignKernelName()
+            << (sizeof(T) < sizeof(double) ? " (float32)" : " (float64)") << std::endl;
+  std::cout << "Assignment strategy: " << clustering::GetAssignStrategyName(kmeans.GetActiveStrategy()) << std::endl;
+  std::cout << "Distance computations skipped: " << 100.0 * kmeans.GetSkippedRatio() << "%" << std::endl;
+  std::cout << "Iterations: " << result.iterations << (result.converged ? " (converged)" : " (hit max)") << std::endl;
+  std::cout << "Inertia: " << result.inertia << std::endl;
+  std::cout << "Wall time: " << std::chrono::duration<double>(run_end - run_start).count() << " s" << std::endl;
+
+  if (out_path.size()) {
+    std::ofstream out(out_path);
+    for (size_t id : kmeans.GetAssignments()) out << id << '\n';
+  }
+  return 0;
+}
+
+int main(int argc, char * argv[])
 {
-  std::cout << "Hello World!" << std::endl;
+  std::string in_path;
+  std::string out_path;
+  size_t k = 3;
+  size_t binary_dims = 0;
+  bool is_float32 = false;
+  bool single_precision = false;
+  size_t max_iters = 300;
+  int seed = 1;
+  clustering::AssignStrategy strategy = clustering::AssignStrategy::AUTO;
+  clustering::SeedMethod seed_method = clustering::SeedMethod::KMEANS_PLUS_PLUS;
+  size_t num_threads = 0;
+  size_t batch_size = 0;
+  size_t passes = 1;
+  size_t coreset_size = 0;
+  emp::vector<size_t> crossover_ks;
+  size_t sweep_min = 0, sweep_max = 0;
+  std::string generate_mode;
+  std::string save_path;
+  size_t num_points = 100000;
+  size_t gen_dims = 2;
+  size_t num_blobs = 0;
+  std::string ids_path;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_val = i + 1 < argc;
+    if (arg == "-k" && has_val) k = std::stoul(argv[++i]);
+    else if (arg == "--binary" && has_val) binary_dims = std::stoul(argv[++i]);
+    else if (arg == "--f32") is_float32 = true;
+    else if (arg == "--precision" && has_val) {
+      const std::string precision = argv[++i];
+      if (precision != "double" && precision != "float") {
+        std::cerr << "Unknown precision: " << precision << std::endl; PrintUsage(); return 1;
+      }
+      single_precision = precision == "float";
+    }
+    else if (arg == "--max-iters" && has_val) max_iters = std::stoul(argv[++i]);
+    else if (arg == "--seed" && has_val) seed = std::stoi(argv[++i]);
+    else if (arg == "--out" && has_val) out_path = argv[++i];
+    else if (arg == "--strategy" && has_val) {
+      if (!clustering::ParseAssignStrategy(argv[++i], strategy)) {
+        std::cerr << "Unknown strategy: " << argv[i] << std::endl; PrintUsage(); return 1;
+      }
+    }
+    else if (arg == "--init" && has_val) {
+      if (!clustering::ParseSeedMethod(argv[++i], seed_method)) {
+        std::cerr << "Unknown seeding method: " << argv[i] << std::endl; PrintUsage(); return 1;
+      }
+    }
+    else if (arg == "--threads" && has_val) num_threads = std::stoul(argv[++i]);
+    else if (arg == "--minibatch" && has_val) batch_size = std::stoul(argv[++i]);
+    else if (arg == "--passes" && has_val) passes = std::stoul(argv[++i]);
+    else if (arg == "--coreset" && has_val) coreset_size = std::stoul(argv[++i]);
+    else if (arg == "--mmap" && has_val) ids_path = argv[++i];
+    else if (arg == "--generate" && has_val) generate_mode = argv[++i];
+    else if (arg == "--points" && has_val) num_points = std::stoul(argv[++i]);
+    else if (arg == "--dims" && has_val) gen_dims = std::stoul(argv[++i]);
+    else if (arg == "--blobs" && has_val) num_blobs = std::stoul(argv[++i]);
+    else if (arg == "--save" && has_val) save_path = argv[++i];
+    else if (arg == "--crossover" && has_val) {
+      std::stringstream k_list(argv[++i]);
+      std::string k_str;
+      while (std::getline(k_list, k_str, ',')) if (k_str.size()) crossover_ks.push_back(std::stoul(k_str));
+    }
+    else if (arg == "--sweep" && has_val) {
+      const std::string range = argv[++i];
+      const size_t dash = range.find('-');
+      if (dash == std::string::npos || dash == 0 || dash + 1 == range.size()) {
+        std::cerr << "Bad --sweep range (expected KMIN-KMAX): " << range << std::endl; PrintUsage(); return 1;
+      }
+      sweep_min = std::stoul(range.substr(0, dash));
+      sweep_max = std::stoul(range.substr(dash + 1));
+    }
+    else if (arg == "-h" || arg == "--help") { PrintUsage(); return 0; }
+    else if (in_path.empty() && arg[0] != '-') in_path = arg;
+    else { std::cerr << "Unknown argument: " << arg << std::endl; PrintUsage(); return 1; }
+  }
+  if (in_path.empty() == generate_mode.empty()) { PrintUsage(); return 1; }
+  if (k < 1) { std::cerr << "Error: -k must be at least 1" << std::endl; PrintUsage(); return 1; }
+  if (ids_path.size()) {
+    if (in_path.empty()) { std::cerr << "Error: --mmap needs POINTS_FILE" << std::endl; return 1; }
+    return RunOutOfCore(in_path, binary_dims, is_float32, k, max_iters, seed, num_threads, ids_path, out_path);
+  }
+  if (batch_size) {
+    if (in_path.empty()) { std::cerr << "Error: --minibatch streams POINTS_FILE (use --save to write one)" << std::endl; return 1; }
+    return RunMiniBatch(in_path, binary_dims, is_float32, k, batch_size, passes, seed, out_path);
+  }
+  if (coreset_size) {
+    if (in_path.empty()) { std::cerr << "Error: --coreset streams POINTS_FILE (use --save to write one)" << std::endl; return 1; }
+    return RunCoreset(in_path, binary_dims, is_float32, k, coreset_size, max_iters, seed, seed_method, num_threads, out_path);
+  }
+
+  if (single_precision && sweep_max) { std::cerr << "Error: --sweep runs in double precision" << std::endl; return 1; }
+
+  // Load (or generate) into points, or into points_f for single precision.
+  clustering::PointSet points;
+  clustering::PointSetF points_f;
+  std::string error;
+  auto load_start = std::chrono::steady_clock::now();
+  if (generate_mode.size()) {
+    emp::Random gen_random(seed);
+    if (!GeneratePoints(generate_mode, num_points, gen_dims, num_blobs ? num_blobs : k, gen_random, points, error)) {
+      std::cerr << "Error: " << error << std::endl; PrintUsage(); return 1;
+    }
+    if (save_path.size()) {
+      std::ofstream save(save_path);
+      save.precision(17);
+      for (size_t i = 0; i < points.GetSize(); ++i) {
+        for (size_t d = 0; d < points.GetDims(); ++d) save << (d ? "," : "") << points.Get(i, d);
+        save << '\n';
+      }
+    }
+    if (single_precision) { points_f.CopyFrom(points); points.Reset(points.GetDims()); }
+  } else {
+    bool loaded;
+    if (single_precision) {
+      loaded = binary_dims ? clustering::LoadBinary(in_path, binary_dims, is_float32, points_f, error)
+                           : clustering::LoadCSV(in_path, points_f, error);
+    } else {
+      loaded = binary_dims ? clustering::LoadBinary(in_path, binary_dims, is_float32, points, error)
+                           : clustering::LoadCSV(in_path, points, error);
+    }
+    if (!loaded) { std::cerr << "Error: " << error << std::endl; return 1; }
+  }
+  auto load_end = std::chrono::steady_clock::now();
+  const size_t loaded_points = single_precision ? points_f.GetSize() : points.GetSize();
+  const size_t loaded_dims = single_precision ? points_f.GetDims() : points.GetDims();
+  std::cout << (generate_mode.size() ? "Generated " : "Loaded ") << loaded_points << " " << loaded_dims
+            << "-D points in " << std::chrono::duration<double>(load_end - load_start).count() << " s" << std::endl;
+  if (crossover_ks.size()) {
+    if (single_precision) RunCrossover(points_f, crossover_ks, seed_method, num_threads, max_iters, seed);
+    else RunCrossover(points, crossover_ks, seed_method, num_threads, max_iters, seed);
+    return 0;
+  }
+  if (sweep_max) {
+    RunSweep(points, sweep_min, sweep_max, num_threads, max_iters, seed);
+    return 0;
+  }
+
+  if (single_precision) return Cluster(points_f, k, strategy, seed_method, num_threads, max_iters, seed, out_path);
+  return Cluster(points, k, strategy, seed_method, num_threads, max_iters, seed, out_path);
 }
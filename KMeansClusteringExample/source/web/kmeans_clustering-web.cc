@@ -6,6 +6,7 @@
 #include <cmath>
 #include <iostream>
 #include <algorithm>
+#include <string>
 
 #include "base/vector.h"
 #include "tools/Random.h"
@@ -16,10 +17,19 @@
 #include "web/JSWrap.h"
 #include "web/color_map.h"
 
+#include "../PointSet.h"
+#include "../KMeans.h"
+#include "../MiniBatchKMeans.h"
+#include "../IncrementalKMeans.h"
+#include "../PointGenerator.h"
+#include "../KSweep.h"
+
 namespace UI = emp::web;
 
-constexpr size_t MAX_RANDOMIZE_TRIES = 10000; //< How many times should we retry dropping random points to avoid point-collisions?
 constexpr size_t RANDOM_POINT_DROP_CNT = 10;
+constexpr size_t DEFAULT_BATCH_SIZE = 16;     //< Points per mini-batch update (one batch per frame).
+constexpr size_t INCREMENTAL_CHECK_BUDGET = 5000;  //< Max point re-checks per click/frame once clustering has converged.
+constexpr size_t SUGGEST_K_MAX = 20;          //< Largest K tried by "Suggest K".
 /// WARNING: KMeansExample does not support having multiple instances on the same HTML page.
 /// WARNING: KMeansExample makes assumptions about the associated .html page. Not really meant to be
 ///          used outside of the context of this application.
@@ -42,11 +52,20 @@ double canvas_pos_y;  //< Internally-used variable to keep track of canvas y pos
 
 size_t cluster_iteration; //< What iteration of the clustering algorithm are we on?
 size_t num_bins;          //< How many K-means clustering bins should we have?
+bool use_kmeanspp;        //< Seed with k-means++ (instead of a random partition)?
+bool use_kdtree;          //< Force kd-tree filtering for the assignment step (otherwise picked automatically)?
+bool use_minibatch;       //< Run mini-batch k-means (one batch per frame) instead of full Lloyd iterations?
+size_t batch_size;        //< How many points per mini-batch?
 
 emp::vector<emp::Circle> points;    //< Vector to keep track of data points.
 emp::vector<size_t> cluster_ids;    //< Vector to keep track of which cluster each point belongs to.
 emp::vector<emp::Circle> centroids; //< Vector to keep track of cluster centroids.
 
+clustering::PointSet data;          //< Flat copy of point coordinates (what the clustering engine works on).
+clustering::KMeans kmeans;          //< The k-means clustering engine.
+clustering::MiniBatchKMeans minibatch;  //< Mini-batch k-means engine (used when use_minibatch is set).
+clustering::IncrementalKMeans incremental;  //< Takes over once Lloyd iterations converge: edits are O(1) + local repair.
+
 enum class Mode { CLUSTER, CONFIG } page_mode;  //< What mode is the page in?
 
 /// This function is wrapped in javascript. Used to update canvas position from javascript.
@@ -60,6 +79,11 @@ std::string GenerateParamNumberField(std::string field_name, std::string field_i
   return GenerateParamField(field_name, field_id, default_value, "Number");
 }
 
+/// Given a field name, field_id, and field value: generate the HTML for a checkbox input field.
+std::string GenerateParamCheckboxField(std::string field_name, std::string field_id, bool default_value) {
+  return GenerateParamField(field_name, field_id, default_value, "checkbox");
+}
+
 /// Given a field name, field_id, field value, and input type: generate the HTML for an input field
 /// of the provided type.
 /// WARNING: Pulled this function out of some old code. No promises on whether or not it uses good
@@ -90,7 +114,12 @@ public:
       point_radius(10),
       cluster_iteration(0),
       num_bins(3),
+      use_kmeanspp(true),
+      use_kdtree(false),
+      use_minibatch(false),
+      batch_size(DEFAULT_BATCH_SIZE),
       points(), cluster_ids(), centroids(),
+      data(2), kmeans(num_bins), minibatch(num_bins, 2, batch_size), incremental(),
       page_mode(Mode::CONFIG)
   {
     // Wrap some necessary functions for js<-->c++ comms.
@@ -107,7 +136,12 @@ public:
     data_dash << UI::Button([this]() { this->DoAddPoints(); }, "Drop Points", "drop_points_button");
     data_dash << UI::Button([this]() { this->DoClear(); }, "Clear", "clear_button");
     data_dash << UI::Button([this]() { this->DoToggleMode(); }, "Cluster Mode", "cluster_mode_button");
+    data_dash << UI::Button([this]() { this->DoSuggestK(); }, "Suggest K", "suggest_k_button");
     data_dash << GenerateParamNumberField("K", "num_bins", num_bins);
+    data_dash << GenerateParamCheckboxField("k-means++ Seeding", "use_kmeanspp", use_kmeanspp);
+    data_dash << GenerateParamCheckboxField("Kd-tree Filtering", "use_kdtree", use_kdtree);
+    data_dash << GenerateParamCheckboxField("Mini-batch", "use_minibatch", use_minibatch);
+    data_dash << GenerateParamNumberField("Batch Size", "batch_size", batch_size);
 
     // Build cluster dashboard.
     cluster_dash << UI::Button([this]() { this->DoToggleRun(); }, "Run", "run_pause_button");
@@ -116,6 +150,9 @@ public:
     cluster_dash << UI::Button([this]() { this->DoToggleMode(); }, "Data Mode", "config_mode_button");
     cluster_dash << "<br/>";
     cluster_dash << "<h2><span class=\"badge badge-secondary" << "\" style=\"margin-left:5px\">" << "K: " << UI::Live([this]() { return this->num_bins; }) << "</span></h2>";
+    cluster_dash << "<h4><span class=\"badge badge-secondary" << "\" style=\"margin-left:5px\">"
+                 << UI::Live([this]() { return this->use_minibatch ? "Mini-batch (" + std::to_string(this->batch_size) + " points/step)" : std::string("Full (Lloyd)"); })
+                 << "</span></h4>";
 
     // Configure all 'da buttons.
     // - They'll be bootstrap buttons: class="btn"
@@ -129,6 +166,9 @@ public:
     auto cm_button = data_dash.Button("cluster_mode_button");
     cm_button.SetAttr("class", "btn btn-primary");
     cm_button.SetAttr("style", "margin:5px");
+    auto sk_button = data_dash.Button("suggest_k_button");
+    sk_button.SetAttr("class", "btn btn-primary");
+    sk_button.SetAttr("style", "margin:5px");
     auto rp_button = cluster_dash.Button("run_pause_button");
     rp_button.SetAttr("class", "btn btn-primary");
     rp_button.SetAttr("style", "margin:5px");
@@ -147,7 +187,8 @@ public:
   }
 
   /// Handler function for canvas mouse clicks.
-  /// For each click in the canvas, make a new point in position where click occured.
+  /// For each click in the canvas, make a new point in position where click occured (shift-click
+  /// removes the point under the cursor instead).
   /// In the process, update canvas_pos_x, canvas_pos_y
   void OnMouseClick(UI::MouseEvent & event) {
     EM_ASM({
@@ -157,7 +198,8 @@ public:
     });
     int x = event.clientX - canvas_pos_x;
     int y = event.clientY - canvas_pos_y;
-    AddPoint(x, y, point_radius);
+    if (event.shiftKey) RemovePointAt(x, y);
+    else AddPoint(x, y, point_radius);
     Draw();
   }
 
@@ -203,9 +245,29 @@ public:
     points.clear();
     cluster_ids.clear();
     centroids.clear();
+    data.Clear();
+    kmeans.Reset();
+    minibatch.Reset(data.GetDims());
+    incremental.Clear();
     Draw();
   }
 
+  /// Cluster the current points for K = 2..SUGGEST_K_MAX, log each K's scores, and put the K
+  /// with the best silhouette into the K field.
+  void DoSuggestK() {
+    if (points.size() < 3) return;
+    clustering::KSweep sweep(2, std::min(SUGGEST_K_MAX, points.size() - 1));
+    const clustering::KSweepResult result = sweep.Run(data, random);
+    std::cout << "K\tSilhouette\tBIC\tGap" << std::endl;
+    for (const clustering::KSweepRow & row : result.rows) {
+      std::cout << row.k << '\t' << row.silhouette << '\t' << row.bic << '\t' << row.gap << std::endl;
+    }
+    std::cout << "Best K: " << result.best_silhouette << " (silhouette), " << result.best_bic << " (BIC), "
+              << result.best_gap << " (gap)" << std::endl;
+    num_bins = result.best_silhouette;
+    EM_ASM_ARGS({ $("#num_bins-param").val($0); }, num_bins);
+  }
+
   /// Toggle between data config mode and cluster running mode.
   void DoToggleMode() {
     // Switch demo mode. Update page as necessary.
@@ -259,6 +321,12 @@ public:
   void Reset() {
     // Cluster reset.
     cluster_iteration = 0;
+    kmeans.SetSeedMethod(use_kmeanspp ? clustering::SeedMethod::KMEANS_PLUS_PLUS : clustering::SeedMethod::RANDOM_PARTITION);
+    kmeans.SetStrategy(use_kdtree ? clustering::AssignStrategy::KDTREE : clustering::AssignStrategy::AUTO);
+    kmeans.SetK(num_bins);
+    minibatch.SetK(num_bins);
+    minibatch.SetBatchSize(batch_size);
+    incremental.Clear();
     centroids.clear(); centroids.resize(num_bins);
     for (size_t i = 0; i < centroids.size(); ++i) { centroids[i].Set(0, 0, 0); }
     for (size_t i = 0; i < cluster_ids.size(); ++i) { cluster_ids[i] = 0; }
@@ -271,6 +339,10 @@ public:
   void InitClusterMode() {
     page_mode = Mode::CLUSTER;
     num_bins = std::min(std::max(1, EM_ASM_INT_V({ return $("#num_bins-param").val(); })), (int)points.size());
+    use_kmeanspp = EM_ASM_INT_V({ return $("#use_kmeanspp-param").is(":checked"); });
+    use_kdtree = EM_ASM_INT_V({ return $("#use_kdtree-param").is(":checked"); });
+    use_minibatch = EM_ASM_INT_V({ return $("#use_minibatch-param").is(":checked"); });
+    batch_size = (size_t) std::max(1, EM_ASM_INT_V({ return $("#batch_size-param").val(); }));
     Reset();
     UpdateDash();
   }
@@ -293,85 +365,95 @@ public:
 
   /// Add a single point to data.
   void AddPoint(const emp::Circle & circ) {
-    points.emplace_back(circ);
-    cluster_ids.emplace_back(0);
+    AddPoint(circ.GetCenterX(), circ.GetCenterY(), circ.GetRadius());
   }
 
-  /// Add a single point to data.
+  /// Add a single point to data. Once clustering has converged, the incremental engine assigns
+  /// it and repairs only the assignments its centroid's move affects.
   void AddPoint(double x, double y, double r) {
     points.emplace_back(x, y, r);
+    data.AddPoint(x, y);
     cluster_ids.emplace_back(0);
+    kmeans.InvalidatePoints();
+    if (incremental.IsReady()) {
+      incremental.InsertPoint(data);
+      RefineIncremental();
+    }
+  }
+
+  /// Remove the point under canvas position (x, y), if any.
+  void RemovePointAt(double x, double y) {
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (!points[i].Contains(x, y)) continue;
+      // Swap-remove, mirroring PointSet::SwapRemove() so indices stay in sync.
+      if (incremental.IsReady()) incremental.RemovePoint(data, i);
+      else data.SwapRemove(i);
+      kmeans.InvalidatePoints();
+      points[i] = points.back(); points.pop_back();
+      cluster_ids[i] = cluster_ids.back(); cluster_ids.pop_back();
+      if (incremental.IsReady()) RefineIncremental();
+      return;
+    }
+  }
+
+  /// Let the incremental engine repair assignments (bounded work per call), then mirror only the
+  /// points whose clusters changed.
+  void RefineIncremental() {
+    incremental.Refine(data, INCREMENTAL_CHECK_BUDGET);
+    for (size_t i : incremental.GetChanged()) {
+      if (i < cluster_ids.size()) cluster_ids[i] = incremental.GetAssignment(i);
+    }
+    incremental.ClearChanged();
+    UpdateCentroidCircles();
+  }
+
+  /// Mirror the active engine's centroids into the circles we draw.
+  void UpdateCentroidCircles() {
+    for (size_t i = 0; i < centroids.size(); ++i) {
+      const double * centroid = incremental.IsReady() ? incremental.GetCentroid(i)
+                              : use_minibatch ? minibatch.GetCentroid(i) : kmeans.GetCentroid(i);
+      centroids[i].Set(centroid[0], centroid[1], point_radius/2.0);
+    }
   }
 
-  /// Generate n random points.
+  /// Generate n random points that don't overlap each other or any existing point (Poisson-disk
+  /// sampling over a spatial hash, so each drop is O(n) overall). Once the canvas is full, fewer
+  /// than n points are dropped.
   void AddPoints(size_t n) {
     // range: 0 + point_radius : width - point_radius
     // range: 0 + point_radius : height - point_radius
-    size_t counter = 0;
-    for (size_t i = 0; i < n; ++i) {
-      emp::Circle c = emp::Circle(0, 0, point_radius);
-      bool sat;
-      while (counter < MAX_RANDOMIZE_TRIES) {
-        double y = random.GetDouble(point_radius, height - point_radius);
-        double x = random.GetDouble(point_radius, width - point_radius);
-        c.SetCenter(x, y);
-        sat = true;
-        for (size_t j = 0; j < points.size(); ++j) {
-          if (c.HasOverlap(points[j])) { sat = false; break; }
-        }
-        if (sat) { break; }
-        ++counter;
-      }
-      AddPoint(c);
-    }
+    clustering::PoissonDiskSampler sampler(point_radius, point_radius, width - point_radius,
+                                           height - point_radius, 2.0 * point_radius);
+    for (const auto & pt : points) sampler.Insert(pt.GetCenterX(), pt.GetCenterY());
+    clustering::PointSet dropped(2);
+    const size_t placed = sampler.AddPoints(n, random, dropped);
+    for (size_t i = 0; i < placed; ++i) AddPoint(dropped.Get(i, 0), dropped.Get(i, 1), point_radius);
+    if (placed < n) std::cout << "Canvas is full: dropped " << placed << " of " << n << " points." << std::endl;
     Draw();
   }
 
-  /// Take a single step in the k-means clustering algorithm.
+  /// Take a single step in the k-means clustering algorithm: a full Lloyd iteration, or (in
+  /// mini-batch mode) one batch of randomly sampled points. Once Lloyd iterations converge, the
+  /// incremental engine takes over and steps only repair what edits have disturbed.
+  /// (The algorithms live in clustering::KMeans/MiniBatchKMeans/IncrementalKMeans; here we just
+  /// mirror their state for drawing.)
   void ClusterSingleStep() {
     // If no points have been laid down... do nothing.
     if (points.empty()) return;
-    // Assign membership.
-    if (cluster_iteration == 0) {
-      // Randomly if on initial iteration.
-      for (size_t i = 0; i < cluster_ids.size(); ++i) { cluster_ids[i] = i % num_bins; }
-      emp::Shuffle(random, cluster_ids);
+    if (use_minibatch) {
+      minibatch.Step(data, random);
+      minibatch.Assign(data, cluster_ids);
+    } else if (incremental.IsReady()) {
+      RefineIncremental();
     } else {
-      // Assign each point to it's nearest centroid.
-      for (size_t i = 0; i < points.size(); ++i) {
-        double min_dist = std::numeric_limits<double>::max();
-        size_t cID = 0;
-        for (size_t c = 0; c < centroids.size(); ++c) {
-          double cen_dist = Distance(points[i], centroids[c]);
-          if (cen_dist < min_dist) { min_dist = cen_dist; cID = c; }
-        }
-        cluster_ids[i] = cID;
-      }
-    }
-    // Update centurions.
-    // - Reset all centroids to 0,0 (make maths easier for ourselves).
-    for (size_t i = 0; i < centroids.size(); ++i) { centroids[i].Set(0, 0, 0); }
-    for (size_t i = 0; i < points.size(); ++i) {
-      auto & centroid = centroids[cluster_ids[i]];
-      centroid.SetCenterX(centroid.GetCenterX() + points[i].GetCenterX());
-      centroid.SetCenterY(centroid.GetCenterY() + points[i].GetCenterY());
-      centroid.SetRadius(centroid.GetRadius() + 1);
-    }
-    for (size_t i = 0; i < centroids.size(); ++i) {
-      auto & centroid = centroids[i];
-      centroid.SetCenterX(centroid.GetCenterX() / centroid.GetRadius());
-      centroid.SetCenterY(centroid.GetCenterY() / centroid.GetRadius());
-      centroid.SetRadius(point_radius/2.0); // Set radius to normal size.
+      const size_t changed = kmeans.Step(data, random);
+      for (size_t i = 0; i < cluster_ids.size(); ++i) { cluster_ids[i] = kmeans.GetAssignment(i); }
+      if (changed == 0) incremental.Init(data, num_bins, kmeans.GetAssignments());
     }
+    UpdateCentroidCircles();
     ++cluster_iteration;
   }
 
-  /// Compute the euclidean distance between two points (a, b).
-  /// Used here as the point similarity metric for k-means clustering algorithm.
-  double Distance(const emp::Circle & a, const emp::Circle & b) {
-    return (std::sqrt( std::pow(a.GetCenterX() - b.GetCenterX(), 2) + std::pow(a.GetCenterY() - b.GetCenterY(), 2) ));
-  }
-
 };
 
 KMeansExample e;
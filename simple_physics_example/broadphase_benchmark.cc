@@ -0,0 +1,117 @@
+/*
+  broadphase_benchmark.cc
+    Compares the multi-level HierarchicalGrid2D broad-phase against a single-level grid (one cell
+    size, large enough for the biggest body) over scenarios with different radius ratios.
+*/
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "base/vector.h"
+#include "tools/Random.h"
+
+#include "./world/HierarchicalGrid2D.h"
+
+struct BodyClass {
+  double radius;
+  double fraction;    //< Fraction of bodies in this class.
+  double growth;      //< Per-step radius wobble (organisms grow and shrink).
+};
+
+struct Scenario {
+  std::string name;
+  emp::vector<BodyClass> classes;
+};
+
+struct BenchResult {
+  double update_ms;
+  double pairs_ms;
+  size_t pair_cnt;
+};
+
+BenchResult RunGrid(HierarchicalGrid2D<size_t> & grid, const Scenario & scenario, double w, double h,
+                    size_t num_bodies, size_t num_steps, int seed) {
+  emp::Random random(seed);
+  emp::vector<double> xs(num_bodies), ys(num_bodies), rs(num_bodies), base_rs(num_bodies), growth(num_bodies);
+  emp::vector<size_t> handles(num_bodies);
+  size_t id = 0;
+  for (const auto & cls : scenario.classes) {
+    const size_t cnt = (size_t)(cls.fraction * num_bodies);
+    for (size_t i = 0; i < cnt && id < num_bodies; ++i, ++id) {
+      base_rs[id] = rs[id] = cls.radius;
+      growth[id] = cls.growth;
+    }
+  }
+  for (; id < num_bodies; ++id) { base_rs[id] = rs[id] = scenario.classes[0].radius; growth[id] = 0; }
+  for (size_t i = 0; i < num_bodies; ++i) {
+    xs[i] = random.GetDouble(0, w);
+    ys[i] = random.GetDouble(0, h);
+    handles[i] = grid.Insert(i, xs[i], ys[i], rs[i]);
+  }
+
+  BenchResult result{0.0, 0.0, 0};
+  for (size_t step = 0; step < num_steps; ++step) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < num_bodies; ++i) {
+      xs[i] = std::min(std::max(xs[i] + random.GetDouble(-1.0, 1.0), 0.0), w);
+      ys[i] = std::min(std::max(ys[i] + random.GetDouble(-1.0, 1.0), 0.0), h);
+      if (growth[i] > 0) rs[i] = base_rs[i] * (1.0 + growth[i] * random.GetDouble(-1.0, 1.0));
+      grid.Move(handles[i], xs[i], ys[i], rs[i]);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    size_t pair_cnt = 0;
+    grid.ForEachOverlappingPair([&pair_cnt](size_t, size_t) { ++pair_cnt; });
+    auto t2 = std::chrono::high_resolution_clock::now();
+    result.update_ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    result.pairs_ms += std::chrono::duration<double, std::milli>(t2 - t1).count();
+    result.pair_cnt += pair_cnt;
+  }
+  result.update_ms /= num_steps;
+  result.pairs_ms /= num_steps;
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  const double w = 2000;
+  const double h = 2000;
+  const size_t num_bodies = (argc > 1) ? (size_t)std::stoul(argv[1]) : 20000;
+  const size_t num_steps = (argc > 2) ? (size_t)std::stoul(argv[2]) : 50;
+  const int seed = 1;
+
+  // Radii mirror the web demo defaults: resources 5, organisms 10 (DEFAULT_MAX_ORGANISM_RADIUS),
+  // dispensers 25.
+  emp::vector<Scenario> scenarios = {
+    {"uniform r=10 (1:1)",          {{10.0, 1.0, 0.0}}},
+    {"demo mix 5/10/25 (1:5)",      {{5.0, 0.70, 0.0}, {10.0, 0.29, 0.2}, {25.0, 0.01, 0.0}}},
+    {"growing orgs 5/2-18 (1:4)",   {{5.0, 0.50, 0.0}, {10.0, 0.50, 0.8}}},
+    {"few giants 2/100 (1:50)",     {{2.0, 0.999, 0.0}, {100.0, 0.001, 0.0}}},
+  };
+
+  std::cout << "bodies=" << num_bodies << " steps=" << num_steps << " world=" << w << "x" << h << std::endl;
+  std::cout << std::left << std::setw(30) << "scenario" << std::setw(14) << "grid"
+            << std::setw(12) << "update_ms" << std::setw(12) << "pairs_ms" << "pairs/step" << std::endl;
+  for (const auto & scenario : scenarios) {
+    double min_r = scenario.classes[0].radius, max_r = 0.0;
+    for (const auto & cls : scenario.classes) {
+      min_r = std::min(min_r, cls.radius * (1.0 - cls.growth));
+      max_r = std::max(max_r, cls.radius * (1.0 + cls.growth));
+    }
+    HierarchicalGrid2D<size_t> single(w, h, 2.0 * max_r, 1);
+    HierarchicalGrid2D<size_t> multi(w, h, 2.0 * min_r);
+    const BenchResult rs = RunGrid(single, scenario, w, h, num_bodies, num_steps, seed);
+    const BenchResult rm = RunGrid(multi, scenario, w, h, num_bodies, num_steps, seed);
+    std::cout << std::setw(30) << scenario.name << std::setw(14) << "single-level"
+              << std::setw(12) << rs.update_ms << std::setw(12) << rs.pairs_ms
+              << (double)rs.pair_cnt / num_steps << std::endl;
+    std::cout << std::setw(30) << "" << std::setw(14) << "hierarchical"
+              << std::setw(12) << rm.update_ms << std::setw(12) << rm.pairs_ms
+              << (double)rm.pair_cnt / num_steps << std::endl;
+    if (rs.pair_cnt != rm.pair_cnt) {
+      std::cout << "ERROR: pair counts differ between grids!" << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -57,6 +57,7 @@ const double DEFAULT_MAX_ORGANISM_RADIUS = 10;
 const double DEFAULT_COST_OF_REPRO = 1;
 const bool DEFAULT_DETACH_ON_BIRTH = true;
 const double DEFAULT_ORGANISM_MEMBRANE_STRENGTH = 10.0;
+const bool DEFAULT_USE_CONTROLLERS = false;
 //  -- Resource-specific --
 const int DEFAULT_MAX_RESOURCE_AGE = 250;
 const int DEFAULT_MAX_RESOURCE_COUNT = 100;
@@ -128,6 +129,7 @@ class EvoInPhysicsInterface {
     double cost_of_repro;
     bool detach_on_birth;
     double organism_membrane_strength;
+    bool use_controllers;
     //double organism_density;
     //  -- Resource-specific --
     int max_resource_age;
@@ -165,6 +167,7 @@ class EvoInPhysicsInterface {
       cost_of_repro = DEFAULT_COST_OF_REPRO;
       detach_on_birth = DEFAULT_DETACH_ON_BIRTH;
       organism_membrane_strength = DEFAULT_ORGANISM_MEMBRANE_STRENGTH;
+      use_controllers = DEFAULT_USE_CONTROLLERS;
       //  -- Resource-specific --
       max_resource_age = DEFAULT_MAX_RESOURCE_AGE;
       max_resource_count = DEFAULT_MAX_RESOURCE_COUNT;
@@ -228,6 +231,7 @@ class EvoInPhysicsInterface {
       param_view << "Cost of Reproduction: " << web::Live([this]() { return cost_of_repro; }) << "<br>";
       param_view << "Detach on Birth: " << web::Live([this]() { return (int) detach_on_birth; }) << "<br>";
       param_view << "Organism Membrane Strength: " << web::Live([this]() { return organism_membrane_strength; }) << "<br>";
+      param_view << "Evolved Controllers: " << web::Live([this]() { return (int) use_controllers; }) << "<br>";
       // -- Resource-Specific --
       param_view << "Max Resource Age: " << web::Live([this]() { return max_resource_age; }) << "<br>";
       param_view << "Max Resource Count: " << web::Live([this]() { return max_resource_count; }) << "<br>";
@@ -261,6 +265,7 @@ class EvoInPhysicsInterface {
       exp_config << GenerateParamNumberField("Cost of Reproduction", "cost-of-repro", cost_of_repro);
       exp_config << GenerateParamCheckboxField("Detach on Birth", "detach-on-birth", detach_on_birth);
       exp_config << GenerateParamNumberField("Organism Membrane Strength", "organism-membrane-strength", organism_membrane_strength);
+      exp_config << GenerateParamCheckboxField("Evolved Controllers", "use-controllers", use_controllers);
       //  -- Resource-specific --
       exp_config << "<h3>Resource-Specific Settings</h3>";
       exp_config << GenerateParamNumberField("Max Resource Age", "max-resource-age", max_resource_age);
@@ -322,6 +327,7 @@ class EvoInPhysicsInterface {
       random = new emp::Random(random_seed);
       world = new World_t(world_width, world_height, random, surface_friction, max_pop_size,
                           genome_length, cost_of_repro, resource_value, max_resource_age);
+      world->SetUseControllers(use_controllers);
       // Setup world view canvs.
       world_view.ClearChildren();
       world_view << web::Canvas(world_width, world_height, "simple-world-canvas") << "<br>";
@@ -458,6 +464,7 @@ class EvoInPhysicsInterface {
       cost_of_repro = EM_ASM_DOUBLE_V({ return $("#cost-of-repro-param").val(); });
       detach_on_birth = EM_ASM_INT_V({ return $("#detach-on-birth-param").is(":checked"); });
       organism_membrane_strength = EM_ASM_DOUBLE_V({ return $("#organism-membrane-strength-param").val(); });
+      use_controllers = EM_ASM_INT_V({ return $("#use-controllers-param").is(":checked"); });
       // -- Resource-Specific --
       max_resource_age = EM_ASM_INT_V({ return $("#max-resource-age-param").val(); });
       max_resource_count = EM_ASM_INT_V({ return $("#max-resource-count-param").val(); });
@@ -0,0 +1,211 @@
+/*
+  world/ControllerEngine.h
+    Defines ControllerTopology and BatchedControllerEngine: evaluates the small feed-forward
+    controllers of a whole population in one batched pass.
+*/
+
+#ifndef CONTROLLERENGINE_H
+#define CONTROLLERENGINE_H
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+#include "base/vector.h"
+
+/// Shape of a controller network: inputs -> tanh hidden layer -> tanh outputs. With zero hidden
+/// units, inputs feed the outputs directly.
+/// Flat weight layout (what organisms carry around as their controller genome):
+///   [W1 (hidden x inputs, row-major)] [b1 (hidden)] [W2 (outputs x layer_in, row-major)] [b2 (outputs)]
+/// where layer_in is num_hidden (or num_inputs if there is no hidden layer).
+struct ControllerTopology {
+  size_t num_inputs;
+  size_t num_hidden;
+  size_t num_outputs;
+
+  size_t GetLayerIn() const { return num_hidden ? num_hidden : num_inputs; }
+  size_t GetNumWeights() const {
+    return num_hidden * num_inputs + num_hidden + num_outputs * GetLayerIn() + num_outputs;
+  }
+  bool operator<(const ControllerTopology & other) const {
+    return std::tie(num_inputs, num_hidden, num_outputs)
+         < std::tie(other.num_inputs, other.num_hidden, other.num_outputs);
+  }
+};
+
+/// Controllers are grouped by topology. Within a group, every array is laid out
+/// [row][col][organism] so the innermost loop of the forward pass runs across organisms with unit
+/// stride: one batched multiply-accumulate per weight position, which the compiler vectorizes.
+/// Weights stay packed between updates: Add() a controller once (packing just its lane) and
+/// Remove() it when its organism goes (the last lane moves into the hole). Per update, only
+/// SetInputs() for every controller, then Evaluate() and GetOutput().
+class BatchedControllerEngine {
+public:
+  static constexpr size_t LANE_PAD = 8;   //< Organism dimension is padded to a multiple of this.
+
+private:
+  struct Group {
+    ControllerTopology topology;
+    size_t count;     //< Organisms in this group.
+    size_t stride;    //< Padded organism dimension (lanes allocated).
+    emp::vector<double> w1, b1, w2, b2;
+    emp::vector<double> inputs, hidden, outputs;
+    emp::vector<size_t> owners;   //< Handle of the controller in each lane.
+
+    /// Call fun(array, rows) for every packed array.
+    template <typename FUN_T>
+    void ForEachArray(FUN_T && fun) {
+      const size_t layer_in = topology.GetLayerIn();
+      fun(w1, topology.num_hidden * topology.num_inputs);
+      fun(b1, topology.num_hidden);
+      fun(w2, topology.num_outputs * layer_in);
+      fun(b2, topology.num_outputs);
+      fun(inputs, topology.num_inputs);
+      fun(hidden, topology.num_hidden);
+      fun(outputs, topology.num_outputs);
+    }
+  };
+
+  struct Slot { size_t group; size_t lane; };
+
+  emp::vector<Group> groups;
+  std::map<ControllerTopology, size_t> group_lookup;
+  emp::vector<Slot> slots;            //< Handle -> (group, lane).
+  emp::vector<size_t> free_slots;     //< Handles of removed controllers, for reuse.
+  size_t num_active;
+
+  static void Transpose(const double * src, size_t rows, size_t cols, size_t lane, size_t stride, double * dst) {
+    for (size_t r = 0; r < rows; ++r) {
+      for (size_t c = 0; c < cols; ++c) dst[(r * cols + c) * stride + lane] = src[r * cols + c];
+    }
+  }
+
+  /// out[o][n] = tanh(b[o][n] + sum_i w[o][i][n] * in[i][n]) for every organism n.
+  static void Layer(const double * w, const double * b, const double * in, double * out,
+                    size_t rows, size_t cols, size_t stride, size_t count) {
+    for (size_t o = 0; o < rows; ++o) {
+      double * out_row = out + o * stride;
+      const double * b_row = b + o * stride;
+      for (size_t n = 0; n < count; ++n) out_row[n] = b_row[n];
+      for (size_t i = 0; i < cols; ++i) {
+        const double * w_row = w + (o * cols + i) * stride;
+        const double * in_row = in + i * stride;
+        for (size_t n = 0; n < count; ++n) out_row[n] += w_row[n] * in_row[n];
+      }
+      for (size_t n = 0; n < count; ++n) out_row[n] = std::tanh(out_row[n]);
+    }
+  }
+
+  /// Double a group's lane capacity, keeping every packed lane where it is.
+  static void Grow(Group & g) {
+    const size_t new_stride = g.stride ? 2 * g.stride : LANE_PAD;
+    g.ForEachArray([&g, new_stride](emp::vector<double> & v, size_t rows) {
+      emp::vector<double> grown(rows * new_stride, 0.0);
+      for (size_t r = 0; r < rows; ++r) {
+        std::copy(v.begin() + r * g.stride, v.begin() + r * g.stride + g.count, grown.begin() + r * new_stride);
+      }
+      v.swap(grown);
+    });
+    g.stride = new_stride;
+  }
+
+  static void CopyLane(Group & g, size_t from, size_t to) {
+    g.ForEachArray([&g, from, to](emp::vector<double> & v, size_t rows) {
+      for (size_t r = 0; r < rows; ++r) v[r * g.stride + to] = v[r * g.stride + from];
+    });
+  }
+
+public:
+  BatchedControllerEngine() : groups(), group_lookup(), slots(), free_slots(), num_active(0) { ; }
+
+  /// Drop every controller (and group).
+  void Clear() {
+    groups.clear();
+    group_lookup.clear();
+    slots.clear();
+    free_slots.clear();
+    num_active = 0;
+  }
+
+  size_t GetSize() const { return num_active; }
+  size_t GetNumGroups() const { return groups.size(); }
+
+  /// Pack a controller into its topology's group; returns the handle used with SetInputs, GetOutput
+  /// and Remove. weights must hold topology.GetNumWeights() values. Inputs start at zero.
+  size_t Add(const ControllerTopology & topology, const emp::vector<double> & weights) {
+    auto it = group_lookup.find(topology);
+    size_t group_id;
+    if (it == group_lookup.end()) {
+      group_id = groups.size();
+      group_lookup[topology] = group_id;
+      groups.emplace_back();
+      groups.back().topology = topology;
+      groups.back().count = 0;
+      groups.back().stride = 0;
+    } else group_id = it->second;
+    Group & g = groups[group_id];
+    if (g.count == g.stride) Grow(g);
+    const size_t lane = g.count++;
+    size_t id;
+    if (free_slots.size()) { id = free_slots.back(); free_slots.pop_back(); }
+    else { id = slots.size(); slots.emplace_back(); }
+    slots[id] = {group_id, lane};
+    g.owners.push_back(id);
+    ++num_active;
+    const ControllerTopology & t = g.topology;
+    const size_t layer_in = t.GetLayerIn();
+    const double * w = weights.data();
+    Transpose(w, t.num_hidden, t.num_inputs, lane, g.stride, g.w1.data());  w += t.num_hidden * t.num_inputs;
+    Transpose(w, t.num_hidden, 1, lane, g.stride, g.b1.data());             w += t.num_hidden;
+    Transpose(w, t.num_outputs, layer_in, lane, g.stride, g.w2.data());     w += t.num_outputs * layer_in;
+    Transpose(w, t.num_outputs, 1, lane, g.stride, g.b2.data());
+    for (size_t i = 0; i < t.num_inputs; ++i) g.inputs[i * g.stride + lane] = 0.0;
+    return id;
+  }
+
+  /// Drop controller id; the group's last lane is moved into its place (other handles stay valid).
+  void Remove(size_t id) {
+    const Slot slot = slots[id];
+    Group & g = groups[slot.group];
+    const size_t last = --g.count;
+    if (slot.lane != last) {
+      CopyLane(g, last, slot.lane);
+      g.owners[slot.lane] = g.owners[last];
+      slots[g.owners[slot.lane]].lane = slot.lane;
+    }
+    g.owners.pop_back();
+    free_slots.push_back(id);
+    --num_active;
+  }
+
+  /// Stage this update's sensor values for controller id (topology.num_inputs values).
+  void SetInputs(size_t id, const emp::vector<double> & inputs) {
+    const Slot & slot = slots[id];
+    Group & g = groups[slot.group];
+    Transpose(inputs.data(), g.topology.num_inputs, 1, slot.lane, g.stride, g.inputs.data());
+  }
+
+  /// Run the forward pass for every controller.
+  void Evaluate() {
+    for (auto & g : groups) {
+      if (g.count == 0) continue;
+      const ControllerTopology & t = g.topology;
+      if (t.num_hidden) {
+        Layer(g.w1.data(), g.b1.data(), g.inputs.data(), g.hidden.data(), t.num_hidden, t.num_inputs, g.stride, g.count);
+        Layer(g.w2.data(), g.b2.data(), g.hidden.data(), g.outputs.data(), t.num_outputs, t.num_hidden, g.stride, g.count);
+      } else {
+        Layer(g.w2.data(), g.b2.data(), g.inputs.data(), g.outputs.data(), t.num_outputs, t.num_inputs, g.stride, g.count);
+      }
+    }
+  }
+
+  /// Output o (in [-1, 1]) of controller id, as of the last Evaluate().
+  double GetOutput(size_t id, size_t o) const {
+    const Slot & slot = slots[id];
+    const Group & g = groups[slot.group];
+    return g.outputs[o * g.stride + slot.lane];
+  }
+};
+
+#endif
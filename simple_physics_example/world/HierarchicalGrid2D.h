@@ -0,0 +1,368 @@
+/*
+  world/HierarchicalGrid2D.h
+    Defines the HierarchicalGrid2D class: a multi-level uniform grid broad-phase for circles of
+    mixed radii (dispensers, organisms, resources).
+*/
+
+#ifndef HIERARCHICALGRID2D_H
+#define HIERARCHICALGRID2D_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include "base/vector.h"
+
+/// Each level of the hierarchy has twice the cell size of the level below it, and a circle's natural
+/// level is the smallest one whose cell size is at least its diameter. Levels only pay off when radii
+/// are far apart (a few giants among many small bodies): with similar radii, the extra levels cost
+/// more per query than they save. So the grid starts flat (one level, cells as wide as the largest
+/// diameter) and only bins each circle at its natural level once natural levels span SPLIT_SPREAD
+/// doublings (radii more than 16x apart); it goes flat again once they're back within MERGE_SPREAD.
+/// Switching layouts (or outgrowing the flat cells) rebins everything, which is O(n) but rare;
+/// otherwise entries are updated in place as bodies move (see Move).
+template <typename PAYLOAD_T>
+class HierarchicalGrid2D {
+public:
+  static constexpr size_t NO_ENTRY = (size_t)-1;
+
+private:
+  static constexpr size_t SPLIT_SPREAD = 5;   //< Go hierarchical at this many levels between smallest and largest.
+  static constexpr size_t MERGE_SPREAD = 3;   //< Go flat again at this many (or fewer).
+  // When a body outgrows the flat cells, they grow to fit it but at least double, so a population
+  // whose largest body keeps inching up only rebins a handful of times.
+  static constexpr double FLAT_GROWTH = 2.0;
+
+  struct Entry {
+    PAYLOAD_T payload;
+    double x;
+    double y;
+    double r;
+    size_t level;
+    size_t cell;
+    size_t slot;   //< Position of this entry within its cell's bucket.
+    bool active;
+  };
+
+  struct Level {
+    double cell_size;
+    double inv_cell_size;
+    size_t cols;
+    size_t rows;
+    double min_radius;   //< Smallest radius ever binned at this level.
+    double max_radius;   //< Largest radius ever binned at this level (conservative search bound).
+    size_t count;        //< Number of entries currently in this level.
+    emp::vector<emp::vector<size_t>> cells;
+  };
+
+  double width;
+  double height;
+  double min_cell_size;
+  emp::vector<double> natural_sizes;   //< Cell size of each hierarchy level.
+  bool hierarchical;                   //< Binned by natural level (or all in one flat level)?
+  emp::vector<Level> levels;           //< Current layout: the hierarchy, or a single flat level.
+  emp::vector<Entry> entries;
+  emp::vector<size_t> free_entries;
+  size_t num_active;
+  size_t num_rebins;   //< How many moves required an entry to change cells? (stat)
+  size_t num_rebuilds; //< How many times was everything rebinned (layout switch or flat resize)? (stat)
+
+  size_t ToCol(const Level & lvl, double x) const {
+    const double c = std::floor(x * lvl.inv_cell_size);
+    if (c < 0) return 0;
+    if (c >= (double)lvl.cols) return lvl.cols - 1;
+    return (size_t)c;
+  }
+
+  size_t ToRow(const Level & lvl, double y) const {
+    const double c = std::floor(y * lvl.inv_cell_size);
+    if (c < 0) return 0;
+    if (c >= (double)lvl.rows) return lvl.rows - 1;
+    return (size_t)c;
+  }
+
+  /// Smallest hierarchy level whose cells (min_cell_size * 2^level) are at least 2r wide.
+  size_t NaturalLevel(double r) const {
+    const double ratio = 2.0 * r / min_cell_size;
+    if (!(ratio > 1.0)) return 0;
+    if (ratio >= natural_sizes.back() / min_cell_size) return natural_sizes.size() - 1;
+    // ratio = 1.f * 2^e (read off the bits): the level is e, or e + 1 if there is any fraction.
+    uint64_t bits;
+    std::memcpy(&bits, &ratio, sizeof(bits));
+    const size_t exponent = (size_t)((bits >> 52) & 0x7ff) - 1023;
+    const bool has_fraction = (bits & ((uint64_t(1) << 52) - 1)) != 0;
+    return exponent + (has_fraction ? 1 : 0);
+  }
+
+  /// Natural level for radius r, given that it was at level `level` before (usually still is).
+  size_t NaturalLevel(double r, size_t level) const {
+    const double diameter = 2.0 * r;
+    const bool fits = diameter <= natural_sizes[level] || level + 1 == natural_sizes.size();
+    const bool needs = level == 0 || diameter > natural_sizes[level - 1];
+    return (fits && needs) ? level : NaturalLevel(r);
+  }
+
+  Level MakeLevel(double cell_size) const {
+    Level lvl;
+    lvl.cell_size = cell_size;
+    lvl.inv_cell_size = 1.0 / cell_size;
+    lvl.cols = (size_t)std::ceil(width / cell_size);
+    lvl.rows = (size_t)std::ceil(height / cell_size);
+    lvl.min_radius = std::numeric_limits<double>::infinity();
+    lvl.max_radius = 0.0;
+    lvl.count = 0;
+    lvl.cells.resize(lvl.cols * lvl.rows);
+    return lvl;
+  }
+
+  /// Lay the levels out for the current mode and rebin every active entry. A flat level is sized for
+  /// the largest circle, and at least min_flat_cell wide.
+  void Rebuild(double min_flat_cell = 0.0) {
+    levels.clear();
+    if (hierarchical) {
+      for (double cell_size : natural_sizes) levels.push_back(MakeLevel(cell_size));
+    } else {
+      double max_r = 0.0;
+      for (const Entry & entry : entries) if (entry.active) max_r = std::max(max_r, entry.r);
+      levels.push_back(MakeLevel(std::max({ min_cell_size, min_flat_cell, 2.0 * max_r })));
+    }
+    for (size_t id = 0; id < entries.size(); ++id) {
+      Entry & entry = entries[id];
+      if (!entry.active) continue;
+      entry.level = hierarchical ? NaturalLevel(entry.r) : 0;
+      entry.cell = CellFor(levels[entry.level], entry.x, entry.y);
+      Link(id);
+    }
+    ++num_rebuilds;
+  }
+
+  /// Flat layout: entry id (active, radius already set) is about to be binned or rebinned. The level's
+  /// radius bounds only ever widen, so when one of them moves, switch to the hierarchy if the radii now
+  /// span too many levels, or grow the cells if the entry no longer fits. Returns whether it rebuilt.
+  bool FitFlat(size_t id) {
+    Level & flat = levels[0];
+    const double r = entries[id].r;
+    if (r >= flat.min_radius && r <= flat.max_radius) return false;
+    if (NaturalLevel(std::max(r, flat.max_radius)) >= NaturalLevel(std::min(r, flat.min_radius)) + SPLIT_SPREAD) {
+      // The bounds may be stale (from bodies long gone); tighten them before committing to a split.
+      flat.min_radius = r;
+      flat.max_radius = r;
+      for (const Entry & entry : entries) {
+        if (!entry.active) continue;
+        flat.min_radius = std::min(flat.min_radius, entry.r);
+        flat.max_radius = std::max(flat.max_radius, entry.r);
+      }
+      if (NaturalLevel(flat.max_radius) >= NaturalLevel(flat.min_radius) + SPLIT_SPREAD) {
+        hierarchical = true;
+        Rebuild();
+        return true;
+      }
+    }
+    if (2.0 * r > flat.cell_size) { Rebuild(FLAT_GROWTH * flat.cell_size); return true; }
+    return false;
+  }
+
+  /// Hierarchical layout: call after a level empties. Goes flat once the occupied levels are within
+  /// MERGE_SPREAD of each other. Returns whether it rebuilt.
+  bool MaybeFlatten() {
+    if (num_active == 0) return false;
+    size_t lo = 0, hi = levels.size() - 1;
+    while (levels[lo].count == 0) ++lo;
+    while (levels[hi].count == 0) --hi;
+    if (hi - lo > MERGE_SPREAD) return false;
+    hierarchical = false;
+    Rebuild();
+    return true;
+  }
+
+  size_t CellFor(const Level & lvl, double x, double y) const {
+    return ToRow(lvl, y) * lvl.cols + ToCol(lvl, x);
+  }
+
+  void Link(size_t id) {
+    Entry & entry = entries[id];
+    Level & lvl = levels[entry.level];
+    auto & bucket = lvl.cells[entry.cell];
+    entry.slot = bucket.size();
+    bucket.push_back(id);
+    lvl.min_radius = std::min(lvl.min_radius, entry.r);
+    lvl.max_radius = std::max(lvl.max_radius, entry.r);
+    ++lvl.count;
+  }
+
+  void Unlink(size_t id) {
+    Entry & entry = entries[id];
+    Level & lvl = levels[entry.level];
+    auto & bucket = lvl.cells[entry.cell];
+    // Swap-and-pop, patching the slot of whoever got moved into our spot.
+    const size_t last = bucket.back();
+    bucket[entry.slot] = last;
+    entries[last].slot = entry.slot;
+    bucket.pop_back();
+    --lvl.count;
+  }
+
+  /// Call fun(id) for every entry at level lvl binned in a cell touching the box [x0,x1]x[y0,y1].
+  template <typename FUN_T>
+  void ForEachInBox(const Level & lvl, double x0, double y0, double x1, double y1, FUN_T && fun) const {
+    const size_t c0 = ToCol(lvl, x0), c1 = ToCol(lvl, x1);
+    const size_t r0 = ToRow(lvl, y0), r1 = ToRow(lvl, y1);
+    for (size_t row = r0; row <= r1; ++row) {
+      for (size_t col = c0; col <= c1; ++col) {
+        for (size_t id : lvl.cells[row * lvl.cols + col]) fun(id);
+      }
+    }
+  }
+
+public:
+  /// Build a grid covering a _w x _h world. Hierarchy level 0 uses _min_cell_size; levels double in
+  /// size until a single cell covers the whole world or _max_levels is reached (the flat level is never
+  /// finer than _min_cell_size either). Bodies outside of the world bounds are clamped into the border
+  /// cells.
+  HierarchicalGrid2D(double _w = 1.0, double _h = 1.0, double _min_cell_size = 1.0, size_t _max_levels = 32)
+    : width(0), height(0), min_cell_size(0), natural_sizes(), hierarchical(false), levels(), entries(),
+      free_entries(), num_active(0), num_rebins(0), num_rebuilds(0)
+  {
+    Config(_w, _h, _min_cell_size, _max_levels);
+  }
+
+  /// Reconfigure grid dimensions. Clears all entries.
+  void Config(double _w, double _h, double _min_cell_size, size_t _max_levels = 32) {
+    width = std::max(_w, 1.0);
+    height = std::max(_h, 1.0);
+    min_cell_size = std::max(_min_cell_size, 1e-6);
+    natural_sizes.assign(1, min_cell_size);
+    while (natural_sizes.size() < std::max<size_t>(_max_levels, 1)) {
+      if (natural_sizes.back() >= width && natural_sizes.back() >= height) break;
+      natural_sizes.push_back(natural_sizes.back() * 2.0);
+    }
+    num_rebins = 0;
+    num_rebuilds = 0;
+    Clear();
+  }
+
+  /// Remove all entries (keeps grid configuration).
+  void Clear() {
+    entries.clear();
+    free_entries.clear();
+    num_active = 0;
+    hierarchical = false;
+    Rebuild();
+  }
+
+  size_t GetSize() const { return num_active; }
+  bool IsHierarchical() const { return hierarchical; }
+  size_t GetNumLevels() const { return levels.size(); }
+  size_t GetLevelCount(size_t level) const { return levels[level].count; }
+  double GetCellSize(size_t level) const { return levels[level].cell_size; }
+  size_t GetNumRebins() const { return num_rebins; }
+  size_t GetNumRebuilds() const { return num_rebuilds; }
+
+  bool IsActive(size_t id) const { return id < entries.size() && entries[id].active; }
+  const PAYLOAD_T & GetPayload(size_t id) const { return entries[id].payload; }
+  double GetX(size_t id) const { return entries[id].x; }
+  double GetY(size_t id) const { return entries[id].y; }
+  double GetRadius(size_t id) const { return entries[id].r; }
+
+  /// Insert a circle; returns the handle used to Move/Remove it later.
+  size_t Insert(const PAYLOAD_T & payload, double x, double y, double r) {
+    size_t id;
+    if (free_entries.size()) { id = free_entries.back(); free_entries.pop_back(); }
+    else { id = entries.size(); entries.emplace_back(); }
+    Entry & entry = entries[id];
+    entry.payload = payload;
+    entry.x = x; entry.y = y; entry.r = r;
+    entry.active = true;
+    ++num_active;
+    // A rebuild bins the new entry along with everything else.
+    if (!hierarchical && FitFlat(id)) return id;
+    entry.level = hierarchical ? NaturalLevel(r) : 0;
+    entry.cell = CellFor(levels[entry.level], x, y);
+    Link(id);
+    return id;
+  }
+
+  void Remove(size_t id) {
+    if (!IsActive(id)) return;
+    Unlink(id);
+    entries[id].active = false;
+    free_entries.push_back(id);
+    --num_active;
+    if (hierarchical && levels[entries[id].level].count == 0) MaybeFlatten();
+  }
+
+  /// Update an entry's position/radius. Only touches buckets if the entry changed cell or level (or
+  /// its new radius calls for a different layout).
+  void Move(size_t id, double x, double y, double r) {
+    Entry & entry = entries[id];
+    entry.x = x; entry.y = y;
+    size_t new_level = entry.level;
+    if (r != entry.r) {
+      entry.r = r;
+      if (hierarchical) new_level = NaturalLevel(r, entry.level);
+      else if (FitFlat(id)) return;
+    }
+    const size_t new_cell = CellFor(levels[new_level], x, y);
+    if (new_level == entry.level && new_cell == entry.cell) {
+      Level & lvl = levels[new_level];
+      lvl.min_radius = std::min(lvl.min_radius, r);
+      lvl.max_radius = std::max(lvl.max_radius, r);
+      return;
+    }
+    const size_t old_level = entry.level;
+    Unlink(id);
+    entry.level = new_level;
+    entry.cell = new_cell;
+    Link(id);
+    ++num_rebins;
+    if (levels[old_level].count == 0) MaybeFlatten();
+  }
+
+  /// Call fun(id) for every entry whose circle overlaps (or touches) the disc at (x, y) with the given radius.
+  template <typename FUN_T>
+  void ForEachInRadius(double x, double y, double radius, FUN_T && fun) const {
+    for (const Level & lvl : levels) {
+      if (lvl.count == 0) continue;
+      const double reach = radius + lvl.max_radius;
+      ForEachInBox(lvl, x - reach, y - reach, x + reach, y + reach, [&](size_t id) {
+        const Entry & e = entries[id];
+        const double dx = e.x - x, dy = e.y - y;
+        const double rsum = e.r + radius;
+        if (dx * dx + dy * dy <= rsum * rsum) fun(id);
+      });
+    }
+  }
+
+  /// Call fun(a, b) exactly once for every pair of overlapping circles.
+  /// Each entry is only tested against its own level and the levels above it, so cross-level pairs
+  /// are found from the smaller body's side; same-level pairs are reported with a < b.
+  template <typename FUN_T>
+  void ForEachOverlappingPair(FUN_T && fun) const {
+    for (size_t la = 0; la < levels.size(); ++la) {
+      const Level & lvl_a = levels[la];
+      if (lvl_a.count == 0) continue;
+      for (const auto & bucket : lvl_a.cells) {
+        for (size_t a : bucket) {
+          const Entry & ea = entries[a];
+          for (size_t lb = la; lb < levels.size(); ++lb) {
+            const Level & lvl_b = levels[lb];
+            if (lvl_b.count == 0) continue;
+            const double reach = ea.r + lvl_b.max_radius;
+            ForEachInBox(lvl_b, ea.x - reach, ea.y - reach, ea.x + reach, ea.y + reach, [&](size_t b) {
+              if (lb == la && b <= a) return;
+              const Entry & eb = entries[b];
+              const double dx = eb.x - ea.x, dy = eb.y - ea.y;
+              const double rsum = ea.r + eb.r;
+              if (dx * dx + dy * dy < rsum * rsum) fun(a, b);
+            });
+          }
+        }
+      }
+    }
+  }
+};
+
+#endif
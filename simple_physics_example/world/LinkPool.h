@@ -0,0 +1,155 @@
+/*
+  world/LinkPool.h
+    Defines LinkPool: pooled storage for links between bodies with per-body compact adjacency
+    and O(1) IsLinked.
+*/
+
+#ifndef LINKPOOL_H
+#define LINKPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+#include "base/vector.h"
+
+/// Links live in a single slab (recycled through a free list) and are addressed by index. Nodes are
+/// small dense ids supplied by the caller (e.g., broad-phase handles). Each node keeps its link
+/// indices in a small inline array, spilling into a heap vector only when it has many links.
+template <typename LINK_TYPE_T>
+class LinkPool {
+public:
+  static constexpr size_t INLINE_LINKS = 4;
+
+  struct Link {
+    size_t from;
+    size_t to;
+    LINK_TYPE_T type;
+    double cur_dist;
+    double target_dist;
+    double link_strength;
+    bool active;
+  };
+
+private:
+  struct Adjacency {
+    uint32_t inline_links[INLINE_LINKS];
+    uint32_t inline_cnt;
+    emp::vector<uint32_t> overflow;
+
+    size_t GetSize() const { return inline_cnt + overflow.size(); }
+    uint32_t Get(size_t i) const { return (i < INLINE_LINKS) ? inline_links[i] : overflow[i - INLINE_LINKS]; }
+    void Set(size_t i, uint32_t v) { if (i < INLINE_LINKS) inline_links[i] = v; else overflow[i - INLINE_LINKS] = v; }
+    void Push(uint32_t v) {
+      if (inline_cnt < INLINE_LINKS) inline_links[inline_cnt++] = v;
+      else overflow.push_back(v);
+    }
+    void Erase(uint32_t v) {
+      const size_t size = GetSize();
+      for (size_t i = 0; i < size; ++i) {
+        if (Get(i) != v) continue;
+        Set(i, Get(size - 1));   // Order doesn't matter: swap in the last entry.
+        if (overflow.size()) overflow.pop_back();
+        else --inline_cnt;
+        return;
+      }
+    }
+    void Clear() { inline_cnt = 0; overflow.clear(); }
+  };
+
+  emp::vector<Link> links;
+  emp::vector<uint32_t> free_links;
+  emp::vector<Adjacency> adjacency;
+  std::unordered_map<uint64_t, uint32_t> pair_counts;   //< Unordered node pair -> number of links.
+  size_t num_active;
+
+  static uint64_t PairKey(size_t a, size_t b) {
+    if (a > b) std::swap(a, b);
+    return ((uint64_t)a << 32) | (uint64_t)(uint32_t)b;
+  }
+
+  Adjacency & GetAdjacency(size_t node) {
+    if (node >= adjacency.size()) {
+      const size_t old_size = adjacency.size();
+      adjacency.resize(node + 1);
+      for (size_t i = old_size; i < adjacency.size(); ++i) adjacency[i].inline_cnt = 0;
+    }
+    return adjacency[node];
+  }
+
+  void Destroy(uint32_t id) {
+    Link & link = links[id];
+    if (!link.active) return;
+    GetAdjacency(link.from).Erase(id);
+    if (link.to != link.from) GetAdjacency(link.to).Erase(id);
+    auto it = pair_counts.find(PairKey(link.from, link.to));
+    if (--(it->second) == 0) pair_counts.erase(it);
+    link.active = false;
+    free_links.push_back(id);
+    --num_active;
+  }
+
+public:
+  LinkPool() : links(), free_links(), adjacency(), pair_counts(), num_active(0) { ; }
+
+  void Clear() {
+    links.clear();
+    free_links.clear();
+    for (auto & adj : adjacency) adj.Clear();
+    pair_counts.clear();
+    num_active = 0;
+  }
+
+  size_t GetSize() const { return num_active; }
+  Link & GetLink(size_t id) { return links[id]; }
+  const Link & GetLink(size_t id) const { return links[id]; }
+
+  /// Add a link from -> to; returns its id.
+  size_t AddLink(LINK_TYPE_T type, size_t from, size_t to, double cur_dist = 0.0,
+                 double target_dist = 0.0, double link_strength = 0.0) {
+    uint32_t id;
+    if (free_links.size()) { id = free_links.back(); free_links.pop_back(); }
+    else { id = (uint32_t)links.size(); links.emplace_back(); }
+    links[id] = {from, to, type, cur_dist, target_dist, link_strength, true};
+    GetAdjacency(from).Push(id);
+    if (to != from) GetAdjacency(to).Push(id);
+    ++pair_counts[PairKey(from, to)];
+    ++num_active;
+    return id;
+  }
+
+  /// Are these two nodes linked (in either direction, any type)?
+  bool IsLinked(size_t a, size_t b) const { return pair_counts.count(PairKey(a, b)) > 0; }
+
+  /// Call fun(Link &) for every active link into node with the given type.
+  template <typename FUN_T>
+  void ForEachLinkTo(size_t node, LINK_TYPE_T type, FUN_T && fun) {
+    if (node >= adjacency.size()) return;
+    const Adjacency & adj = adjacency[node];
+    for (size_t i = 0; i < adj.GetSize(); ++i) {
+      Link & link = links[adj.Get(i)];
+      if (link.to == node && link.type == type) fun(link);
+    }
+  }
+
+  /// Call fun(Link &) for every active link out of node with the given type.
+  template <typename FUN_T>
+  void ForEachLinkFrom(size_t node, LINK_TYPE_T type, FUN_T && fun) {
+    if (node >= adjacency.size()) return;
+    const Adjacency & adj = adjacency[node];
+    for (size_t i = 0; i < adj.GetSize(); ++i) {
+      Link & link = links[adj.Get(i)];
+      if (link.from == node && link.type == type) fun(link);
+    }
+  }
+
+  /// Remove every link touching node (call before the node id gets recycled).
+  void RemoveNode(size_t node) {
+    if (node >= adjacency.size()) return;
+    Adjacency & adj = adjacency[node];
+    while (adj.GetSize()) Destroy(adj.Get(adj.GetSize() - 1));
+  }
+};
+
+#endif
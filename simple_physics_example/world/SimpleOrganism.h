@@ -14,6 +14,7 @@
 #include "physics/PhysicsBody2D.h"
 #include "physics/PhysicsBodyOwner.h"
 #include "SimpleResource.h"
+#include "ControllerEngine.h"
 
 class SimpleOrganism : public emp::PhysicsBodyOwner_Base<emp::PhysicsBody2D<emp::Circle>> {
 private:
@@ -30,6 +31,8 @@ private:
 
 public:
   emp::BitVector genome;
+  emp::vector<double> controller;          // Controller weights (layout described by ControllerTopology).
+  ControllerTopology controller_topology;
   // TODO: use argument forwarding to be able to create body when making organism!
   SimpleOrganism(const emp::Circle &_p, int genome_length = 1, bool detach_on_birth = true)
     : offspring_count(0),
@@ -37,7 +40,9 @@ public:
       energy(0.0),
       resources_collected(0.0),
       detach_on_birth(detach_on_birth),
-      genome(genome_length, false)
+      genome(genome_length, false),
+      controller(),
+      controller_topology({0, 0, 0})
   {
     UpdateGenomeID();
     body = nullptr;
@@ -54,7 +59,9 @@ public:
        resources_collected(other.GetResourcesCollected()),
        detach_on_birth(other.GetDetachOnBirth()),
        genome_id(other.GetGenomeID()),
-       genome(other.genome)
+       genome(other.genome),
+       controller(other.controller),
+       controller_topology(other.controller_topology)
   {
     body = nullptr;
     has_body = other.has_body;
@@ -74,6 +81,15 @@ public:
   double GetBirthTime() const { return birth_time; }
   bool GetDetachOnBirth() const { return detach_on_birth; }
   int GetGenomeID() const { return genome_id; }
+  bool HasController() const { return controller.size() > 0; }
+  const ControllerTopology & GetControllerTopology() const { return controller_topology; }
+
+  // Give this organism a randomly-weighted controller with the given topology.
+  void InitController(const ControllerTopology & topology, emp::Random *r) {
+    controller_topology = topology;
+    controller.resize(topology.GetNumWeights());
+    for (auto & w : controller) w = r->GetDouble(-1.0, 1.0);
+  }
 
   void Evaluate() override {
     // Required: Be sure to call BodyOwner_Base evaluate.
@@ -115,6 +131,9 @@ public:
     for (int i = 0; i < offspring->genome.GetSize(); i++) {
       if (r->P(mut_rate)) offspring->genome[i] = !offspring->genome[i];
     }
+    for (auto & w : offspring->controller) {
+      if (r->P(mut_rate)) w += r->GetRandNormal(0.0, 0.1);
+    }
     offspring->UpdateGenomeID();
     // Link and nudge. offspring
     emp::Angle repro_angle(r->GetDouble(2.0 * emp::PI)); // What angle should we put the offspring at?
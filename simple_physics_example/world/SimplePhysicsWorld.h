@@ -1,6 +1,13 @@
 #include "SimpleOrganism.h"
 #include "SimpleResource.h"
 #include "SimpleResourceDispenser.h"
+#include "HierarchicalGrid2D.h"
+#include "SpatialQueries.h"
+#include "ControllerEngine.h"
+#include "MovementNoise.h"
+#include "LinkPool.h"
+
+#include <unordered_map>
 
 #include "base/vector.h"
 #include "tools/BitVector.h"
@@ -15,15 +22,60 @@
 namespace emp {
 namespace evo {
   class SimplePhysicsWorld {
+  public:
+    // Smallest radius we expect to see (resources); sets the finest broad-phase cell size.
+    static constexpr double MIN_BROAD_PHASE_RADIUS = 5.0;
+    // Body kind bits (used to filter spatial queries).
+    static constexpr size_t BODY_ORGANISM = 1;
+    static constexpr size_t BODY_RESOURCE = 2;
+    static constexpr size_t BODY_DISPENSER = 4;
+    static constexpr size_t BODY_ANY = BODY_ORGANISM | BODY_RESOURCE | BODY_DISPENSER;
+    // Controller sensors: nearest resource (dx, dy), nearest organism (dx, dy), energy.
+    // Controller outputs: thrust (x, y).
+    static constexpr size_t CONTROLLER_INPUTS = 5;
+    static constexpr size_t CONTROLLER_OUTPUTS = 2;
+
+    struct TrackedBody {
+      PhysicsBody2D<Circle> *body;
+      size_t kind;
+    };
+    using BroadPhase_t = HierarchicalGrid2D<TrackedBody>;
+    using Query_t = SpatialQueryService<TrackedBody>;
+    using LinkPool_t = LinkPool<BODY_LINK_TYPE>;
+
   protected:
     using Organism_t = SimpleOrganism;
     using Resource_t = SimpleResource;
     using Dispenser_t = SimpleResourceDispenser;
     using Physics_t = CirclePhysics2D<Organism_t, Resource_t, Dispenser_t>;
+    using Body_t = PhysicsBody2D<Circle>;
 
 
     Physics_t physics;
+    // Multi-level grid over all live bodies. Collisions are still resolved by physics, so positions
+    // are only pushed into it (incrementally) when something is about to query it.
+    BroadPhase_t broad_phase;
+    std::unordered_map<Body_t*, size_t> broad_phase_ids;
+    bool broad_phase_stale;   // Have bodies moved since the last SyncBroadPhase()?
+    Query_t spatial_queries;
+    size_t num_query_threads;
+    // Organism -> resource CONSUME_RESOURCE links, keyed by broad-phase id. These are bookkeeping
+    // only (no forces), so they live here instead of as heap-allocated BodyLinks. A link never
+    // outlives its step: the resource is fed (or ages out) and UntrackBody drops its links.
+    LinkPool_t consume_links;
+    // Evolved controllers (replace random movement noise when enabled).
+    bool use_controllers;
+    double max_thrust;
+    double sensor_range;
+    ControllerTopology controller_topology;
+    BatchedControllerEngine controller_engine;
+    std::unordered_map<Organism_t*, size_t> controller_ids;   // Organism -> controller_engine handle.
+    emp::vector<size_t> controller_handles;   // Handle of population[i]'s controller (this update).
+    emp::vector<double> sensor_buffer;
+    emp::vector<SpatialHit> resource_hits, organism_hits;
+    emp::vector<size_t> resource_hit_counts, organism_hit_counts;
     Random *random_ptr;
+    MovementNoise movement_noise;   // Batched random-direction kicks for resources/organisms.
     emp::vector<Organism_t*> population;
     emp::vector<Resource_t*> resources;
     emp::vector<Dispenser_t*> dispensers;
@@ -46,10 +98,17 @@ namespace evo {
     SimplePhysicsWorld(double _w, double _h, Random *_random_ptr, double _surface_friction,
                        int _max_pop_size, int _genome_length, double _cost_of_repro, double _resource_value,
                        int _max_resource_age)
-    : physics(), cur_update(0), max_pop_size(_max_pop_size), genome_length(_genome_length),
+    : physics(), broad_phase(_w, _h, 2.0 * MIN_BROAD_PHASE_RADIUS), broad_phase_ids(), broad_phase_stale(false),
+      spatial_queries(broad_phase), num_query_threads(1), consume_links(),
+      use_controllers(false), max_thrust(0.05), sensor_range(100.0),
+      controller_topology({CONTROLLER_INPUTS, 4, CONTROLLER_OUTPUTS}), controller_engine(),
+      controller_ids(), controller_handles(),
+      sensor_buffer(CONTROLLER_INPUTS, 0.0), resource_hits(), organism_hits(),
+      resource_hit_counts(), organism_hit_counts(), cur_update(0), max_pop_size(_max_pop_size), genome_length(_genome_length),
       cost_of_repro(_cost_of_repro), resource_value(_resource_value), max_resource_age(_max_resource_age)
     {
       random_ptr = _random_ptr;
+      movement_noise.Seed(random_ptr->GetUInt());
       physics.ConfigPhysics(_w, _h, _random_ptr, _surface_friction);
 
       std::function<void(Organism_t*, Resource_t*)> fun0 = [this](Organism_t *org, Resource_t *res) {
@@ -73,6 +132,11 @@ namespace evo {
 
     void Clear() {
       physics.Clear();
+      broad_phase.Clear();
+      broad_phase_ids.clear();
+      consume_links.Clear();
+      controller_engine.Clear();
+      controller_ids.clear();
       for (auto *org : population) delete org;
       for (auto *res : resources) delete res;
       for (auto *dis : dispensers) delete dis;
@@ -96,12 +160,137 @@ namespace evo {
     const emp::vector<Organism_t*> GetConstPopulation() const { return population; }
     const emp::vector<Resource_t*> GetConstResources() const { return resources; }
     const emp::vector<Dispenser_t*> GetConstDispensers() const { return dispensers; }
+    // Positions/radii are as of the last SyncBroadPhase().
+    const BroadPhase_t & GetBroadPhase() const { return broad_phase; }
+    const Query_t & GetSpatialQueries() const { return spatial_queries; }
+    const LinkPool_t & GetConsumeLinks() const { return consume_links; }
+    size_t GetNumQueryThreads() const { return num_query_threads; }
+    void SetNumQueryThreads(size_t n) { num_query_threads = n; }
+    bool GetUseControllers() const { return use_controllers; }
+    double GetMaxThrust() const { return max_thrust; }
+    double GetSensorRange() const { return sensor_range; }
+    const ControllerTopology & GetControllerTopology() const { return controller_topology; }
+    void SetMaxThrust(double t) { max_thrust = t; }
+    void SetSensorRange(double r) { sensor_range = r; }
+    // Hidden-layer size for controllers created from here on (existing organisms keep theirs).
+    void SetControllerHidden(size_t num_hidden) { controller_topology.num_hidden = num_hidden; }
+
+    // Turn evolved controllers on/off. Organisms without a controller get a random one.
+    void SetUseControllers(bool use) {
+      if (use == use_controllers) return;
+      use_controllers = use;
+      controller_engine.Clear();
+      controller_ids.clear();
+      if (!use) return;
+      for (auto *org : population) {
+        if (!org->HasController()) org->InitController(controller_topology, random_ptr);
+        TrackController(org);
+      }
+    }
+
+    // Controller weights never change after birth, so they are packed into the engine once.
+    void TrackController(Organism_t *org) {
+      controller_ids[org] = controller_engine.Add(org->GetControllerTopology(), org->controller);
+    }
+
+    void UntrackController(Organism_t *org) {
+      auto it = controller_ids.find(org);
+      if (it == controller_ids.end()) return;
+      controller_engine.Remove(it->second);
+      controller_ids.erase(it);
+    }
+
+    // Broad-phase/query handle of a body (BroadPhase_t::NO_ENTRY if untracked).
+    size_t GetSpatialID(Body_t *body) const {
+      auto it = broad_phase_ids.find(body);
+      return (it == broad_phase_ids.end()) ? BroadPhase_t::NO_ENTRY : it->second;
+    }
+
+    void TrackBody(Body_t *body, size_t kind) {
+      const Point & center = body->GetShape().GetCenter();
+      broad_phase_ids[body] = broad_phase.Insert({body, kind}, center.GetX(), center.GetY(), body->GetShape().GetRadius());
+    }
+
+    void UntrackBody(Body_t *body) {
+      auto it = broad_phase_ids.find(body);
+      if (it == broad_phase_ids.end()) return;
+      // The id gets recycled, so links touching it must go now rather than at end of step.
+      consume_links.RemoveNode(it->second);
+      broad_phase.Remove(it->second);
+      broad_phase_ids.erase(it);
+    }
+
+    // Build one query per organism (in population order) and run them as a batch. Results for
+    // organism i live in hits[i * max_results, i * max_results + counts[i]).
+    void RunOrganismQueries(SpatialQuery proto, size_t max_results,
+                            emp::vector<SpatialHit> & hits, emp::vector<size_t> & counts) {
+      SyncBroadPhase();
+      emp::vector<SpatialQuery> queries(population.size(), proto);
+      for (size_t i = 0; i < population.size(); ++i) {
+        Body_t *body = population[i]->GetBodyPtr();
+        const Point & center = body->GetShape().GetCenter();
+        queries[i].x = center.GetX();
+        queries[i].y = center.GetY();
+        queries[i].exclude_id = GetSpatialID(body);
+      }
+      spatial_queries.RunBatch(queries, max_results, hits, counts, num_query_threads);
+    }
+
+    // k nearest resources (within range) for every organism.
+    void SenseNearestResources(size_t k, double range, emp::vector<SpatialHit> & hits, emp::vector<size_t> & counts) {
+      SpatialQuery proto{SpatialQuery::Type::NEAREST, 0, 0, range, 0, 0, k, BODY_RESOURCE, BroadPhase_t::NO_ENTRY};
+      RunOrganismQueries(proto, k, hits, counts);
+    }
+
+    // Sense (batched spatial queries), then run every organism's controller in one batched pass.
+    // population[i]'s controller is controller_handles[i].
+    void EvaluateControllers() {
+      SenseNearestResources(1, sensor_range, resource_hits, resource_hit_counts);
+      SpatialQuery proto{SpatialQuery::Type::NEAREST, 0, 0, sensor_range, 0, 0, 1, BODY_ORGANISM, BroadPhase_t::NO_ENTRY};
+      RunOrganismQueries(proto, 1, organism_hits, organism_hit_counts);
+      controller_handles.resize(population.size());
+      for (size_t i = 0; i < population.size(); ++i) {
+        Organism_t *org = population[i];
+        const Point & center = org->GetBody().GetShape().GetCenter();
+        std::fill(sensor_buffer.begin(), sensor_buffer.end(), 0.0);
+        if (resource_hit_counts[i]) {
+          const size_t id = resource_hits[i].id;
+          sensor_buffer[0] = (broad_phase.GetX(id) - center.GetX()) / sensor_range;
+          sensor_buffer[1] = (broad_phase.GetY(id) - center.GetY()) / sensor_range;
+        }
+        if (organism_hit_counts[i]) {
+          const size_t id = organism_hits[i].id;
+          sensor_buffer[2] = (broad_phase.GetX(id) - center.GetX()) / sensor_range;
+          sensor_buffer[3] = (broad_phase.GetY(id) - center.GetY()) / sensor_range;
+        }
+        sensor_buffer[4] = std::min(1.0, org->GetEnergy() / cost_of_repro);
+        controller_handles[i] = controller_ids[org];
+        controller_engine.SetInputs(controller_handles[i], sensor_buffer);
+      }
+      controller_engine.Evaluate();
+    }
+
+    // Push current body positions/radii into the broad-phase (no-op if nothing moved since the last
+    // sync). Bodies that stay in their cell only have their coordinates refreshed.
+    void SyncBroadPhase() {
+      if (!broad_phase_stale) return;
+      broad_phase_stale = false;
+      for (auto & kv : broad_phase_ids) {
+        const Circle & shape = kv.first->GetShape();
+        broad_phase.Move(kv.second, shape.GetCenter().GetX(), shape.GetCenter().GetY(), shape.GetRadius());
+      }
+    }
 
     // TODO: At the moment, totally ignores POpulationManager_Base stuff. Does not update fitness manager.
     int AddOrg(Organism_t *new_org) {
       int pos = (int)population.size();
+      if (use_controllers) {
+        if (!new_org->HasController()) new_org->InitController(controller_topology, random_ptr);
+        TrackController(new_org);
+      }
       population.push_back(new_org);
       physics.AddBody(new_org);
+      TrackBody(new_org->GetBodyPtr(), BODY_ORGANISM);
       return pos;
     }
 
@@ -109,6 +298,7 @@ namespace evo {
       int pos = GetResourceCnt();
       resources.push_back(new_resource);
       physics.AddBody(new_resource);
+      TrackBody(new_resource->GetBodyPtr(), BODY_RESOURCE);
       return pos;
     }
 
@@ -121,6 +311,7 @@ namespace evo {
       new_dispenser->RegisterDispenserTimerCallback(fun);
       dispensers.push_back(new_dispenser);
       physics.AddBody(new_dispenser);
+      TrackBody(new_dispenser->GetBodyPtr(), BODY_DISPENSER);
       return pos;
     }
 
@@ -135,15 +326,17 @@ namespace evo {
       using Body_t = PhysicsBody2D<Circle>;
       Body_t *org_body = org->GetBodyPtr();
       Body_t *res_body = res->GetBodyPtr();
+      const size_t org_id = GetSpatialID(org_body);
+      const size_t res_id = GetSpatialID(res_body);
       // If organism and resource collide, link with a CONSUME link.
-      if (!org_body->IsLinked(*res_body)) {
+      if (!consume_links.IsLinked(org_id, res_id)) {
         double strength;
         const double sq_pair_dist = (org_body->GetShape().GetCenter() - res_body->GetShape().GetCenter()).SquareMagnitude();
         const double radius_sum = org_body->GetShape().GetRadius() + res_body->GetShape().GetRadius();
         const double sq_min_dist = radius_sum * radius_sum;
         // Strength is a function of how close the two organisms are.
         sq_pair_dist == 0.0 ? strength = std::numeric_limits<double>::max() : strength = sq_min_dist / sq_pair_dist;
-        org_body->AddLink(BODY_LINK_TYPE::CONSUME_RESOURCE, *res_body, sqrt(sq_pair_dist), sqrt(sq_min_dist), strength);
+        consume_links.AddLink(BODY_LINK_TYPE::CONSUME_RESOURCE, org_id, res_id, sqrt(sq_pair_dist), sqrt(sq_min_dist), strength);
       }
       org_body->ResolveCollision();
       res_body->ResolveCollision();
@@ -160,26 +353,30 @@ namespace evo {
     void Update() {
       // Progress physics by one time step.
       physics.Update();
+      broad_phase_stale = true;
       emp::vector<Organism_t*> new_organisms;
       // Manage resources.
       int cur_size = GetResourceCnt();
       int cur_id = 0;
+      movement_noise.Generate(resources.size());
       while (cur_id < cur_size) {
         Resource_t *resource = resources[cur_id];
         // Evaluate.
         resource->Evaluate();
         // Handle resource consumption.
-        auto consumption_links = resource->GetBody().GetLinksToByType(BODY_LINK_TYPE::CONSUME_RESOURCE);
-        if ((int)consumption_links.size() > 0) {
-          // Find the strongest link!
-          auto *max_link = consumption_links[0];
-          for (auto *link : consumption_links) {
-            if (link->link_strength > max_link->link_strength) max_link = link;
-          }
+        // Find the strongest link!
+        const LinkPool_t::Link *max_link = nullptr;
+        consume_links.ForEachLinkTo(GetSpatialID(resource->GetBodyPtr()), BODY_LINK_TYPE::CONSUME_RESOURCE,
+          [&max_link](const LinkPool_t::Link & link) {
+            if (max_link == nullptr || link.link_strength > max_link->link_strength) max_link = &link;
+          });
+        if (max_link != nullptr) {
           // Feed resource to strongest link.
-          if (physics.template IsBodyOwnerType<Organism_t>((PhysicsBody2D<Circle>*)max_link->from)) {
-            Organism_t *org = physics.template ToBodyOwnerType<Organism_t>((PhysicsBody2D<Circle>*)max_link->from);
+          const TrackedBody & consumer = broad_phase.GetPayload(max_link->from);
+          if (consumer.kind == BODY_ORGANISM) {
+            Organism_t *org = physics.template ToBodyOwnerType<Organism_t>(consumer.body);
             org->ConsumeResource(*resource);
+            UntrackBody(resource->GetBodyPtr());
             delete resource;
             cur_size--;
             resources[cur_id] = resources[cur_size];
@@ -189,12 +386,13 @@ namespace evo {
         // TODO: Remove resources flagged for removal.
         // Check on resource aging.
         if (resource->GetAge() > max_resource_age) {
+          UntrackBody(resource->GetBodyPtr());
           delete resource;
           cur_size--;
           resources[cur_id] = resources[cur_size];
           continue;
         }
-        resource->GetBody().IncVelocity(Angle(random_ptr->GetDouble() * (2.0 * emp::PI)).GetPoint(0.1));
+        resource->GetBody().IncVelocity(Point(movement_noise.GetX(cur_id) * 0.1, movement_noise.GetY(cur_id) * 0.1));
         ++cur_id;
       }
       resources.resize(cur_size);
@@ -204,6 +402,8 @@ namespace evo {
         disp->Evaluate();
       }
       // Manage population.
+      if (use_controllers) EvaluateControllers();
+      else movement_noise.Generate(population.size());
       cur_size = GetPopulationSize();
       cur_id = 0;
       while (cur_id < cur_size) {
@@ -215,8 +415,14 @@ namespace evo {
           //auto *offspring = ;
           new_organisms.push_back(org->Reproduce(random_ptr, 0.1, cost_of_repro));
         }
-        // Movement noise.
-        org->GetBody().IncVelocity(Angle(random_ptr->GetDouble() * (2.0 * emp::PI)).GetPoint(0.01));
+        if (use_controllers) {
+          // Controller thrust.
+          org->GetBody().IncVelocity(Point(controller_engine.GetOutput(controller_handles[cur_id], 0) * max_thrust,
+                                           controller_engine.GetOutput(controller_handles[cur_id], 1) * max_thrust));
+        } else {
+          // Movement noise.
+          org->GetBody().IncVelocity(Point(movement_noise.GetX(cur_id) * 0.01, movement_noise.GetY(cur_id) * 0.01));
+        }
         ++cur_id;
       }
       population.resize(cur_size);
@@ -226,7 +432,11 @@ namespace evo {
         // Cull population to make room for new organisms.
         int new_size = (int)population.size() - (total_size - 200);
         emp::Shuffle<Organism_t *>(*random_ptr, population, new_size);
-        for (int i = new_size; i < (int)population.size(); i++) delete population[i];
+        for (int i = new_size; i < (int)population.size(); i++) {
+          UntrackBody(population[i]->GetBodyPtr());
+          UntrackController(population[i]);
+          delete population[i];
+        }
         population.resize(new_size);
       }
       // Add new organisms.
@@ -0,0 +1,208 @@
+/*
+  world/SpatialQueries.h
+    Defines SpatialQueryService: k-nearest, radius, ray and cone queries (filtered by body kind)
+    over a HierarchicalGrid2D, plus batched evaluation of many queries at once.
+*/
+
+#ifndef SPATIALQUERIES_H
+#define SPATIALQUERIES_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "base/vector.h"
+
+#include "HierarchicalGrid2D.h"
+#include "WorkerPool.h"
+
+/// Result of a spatial query: a grid handle plus the distance used to rank it (center distance for
+/// nearest/radius/cone queries, distance to the ray hit for ray queries).
+struct SpatialHit {
+  size_t id;
+  double dist;
+};
+
+/// A single query in a batch. kind_mask is matched against the payload's kind bits.
+struct SpatialQuery {
+  enum class Type { NEAREST, RADIUS, RAY, CONE } type;
+  double x;
+  double y;
+  double range;       //< Search radius (RADIUS, CONE, RAY) or maximum search distance (NEAREST).
+  double angle;       //< Direction in radians (RAY, CONE).
+  double half_angle;  //< Half-width of cone in radians (CONE).
+  size_t k;           //< Number of neighbors wanted (NEAREST).
+  size_t kind_mask;
+  size_t exclude_id;  //< Handle to skip (usually the querying body itself).
+};
+
+/// PAYLOAD_T must expose a 'kind' bitfield (e.g., organism/resource/dispenser bits).
+template <typename PAYLOAD_T>
+class SpatialQueryService {
+public:
+  using Grid_t = HierarchicalGrid2D<PAYLOAD_T>;
+
+private:
+  // Batches smaller than this many queries per thread run on the calling thread.
+  static constexpr size_t MIN_QUERIES_PER_THREAD = 64;
+
+  const Grid_t & grid;
+  WorkerPool pool;   //< Persistent workers for RunBatch (just the caller by default).
+
+  bool Matches(size_t id, size_t kind_mask, size_t exclude_id) const {
+    return id != exclude_id && (grid.GetPayload(id).kind & kind_mask);
+  }
+
+  /// Keep the best k hits in a max-heap on distance.
+  static void PushBounded(emp::vector<SpatialHit> & heap, size_t k, const SpatialHit & hit) {
+    auto cmp = [](const SpatialHit & a, const SpatialHit & b) { return a.dist < b.dist; };
+    if (k == 0) return;
+    if (heap.size() < k) {
+      heap.push_back(hit);
+      std::push_heap(heap.begin(), heap.end(), cmp);
+    } else if (hit.dist < heap.front().dist) {
+      std::pop_heap(heap.begin(), heap.end(), cmp);
+      heap.back() = hit;
+      std::push_heap(heap.begin(), heap.end(), cmp);
+    }
+  }
+
+  static void SortHits(emp::vector<SpatialHit> & hits) {
+    std::sort(hits.begin(), hits.end(), [](const SpatialHit & a, const SpatialHit & b) {
+      return a.dist < b.dist || (a.dist == b.dist && a.id < b.id);
+    });
+  }
+
+public:
+  SpatialQueryService(const Grid_t & _grid) : grid(_grid), pool() { ; }
+
+  /// Up to k nearest matching bodies (by center distance) within max_dist, nearest first.
+  /// Searches an expanding disc so that dense neighborhoods never look far.
+  void Nearest(double x, double y, size_t k, size_t kind_mask, double max_dist,
+               emp::vector<SpatialHit> & out, size_t exclude_id = Grid_t::NO_ENTRY,
+               double start_radius = 16.0) const {
+    out.clear();
+    if (k == 0) return;
+    double radius = std::min(start_radius, max_dist);
+    while (true) {
+      out.clear();
+      grid.ForEachInRadius(x, y, radius, [&](size_t id) {
+        if (!Matches(id, kind_mask, exclude_id)) return;
+        const double dx = grid.GetX(id) - x, dy = grid.GetY(id) - y;
+        const double dist = std::sqrt(dx * dx + dy * dy);
+        if (dist <= max_dist) PushBounded(out, k, {id, dist});
+      });
+      // Anything not yet seen has a center further than radius; we're done once our worst hit beats that.
+      if ((out.size() == k && out.front().dist <= radius) || radius >= max_dist) break;
+      radius = std::min(radius * 2.0, max_dist);
+    }
+    SortHits(out);
+  }
+
+  /// All matching bodies whose circles overlap the disc at (x, y), nearest first.
+  void InRadius(double x, double y, double range, size_t kind_mask,
+                emp::vector<SpatialHit> & out, size_t exclude_id = Grid_t::NO_ENTRY,
+                size_t max_results = std::numeric_limits<size_t>::max()) const {
+    out.clear();
+    grid.ForEachInRadius(x, y, range, [&](size_t id) {
+      if (!Matches(id, kind_mask, exclude_id)) return;
+      const double dx = grid.GetX(id) - x, dy = grid.GetY(id) - y;
+      PushBounded(out, max_results, {id, std::sqrt(dx * dx + dy * dy)});
+    });
+    SortHits(out);
+  }
+
+  /// Matching bodies within range that intersect the cone of half-width half_angle around angle.
+  void Cone(double x, double y, double angle, double half_angle, double range, size_t kind_mask,
+            emp::vector<SpatialHit> & out, size_t exclude_id = Grid_t::NO_ENTRY,
+            size_t max_results = std::numeric_limits<size_t>::max()) const {
+    out.clear();
+    const double dir_x = std::cos(angle), dir_y = std::sin(angle);
+    grid.ForEachInRadius(x, y, range, [&](size_t id) {
+      if (!Matches(id, kind_mask, exclude_id)) return;
+      const double dx = grid.GetX(id) - x, dy = grid.GetY(id) - y;
+      const double dist = std::sqrt(dx * dx + dy * dy);
+      const double r = grid.GetRadius(id);
+      if (dist > r) {
+        // Widen the cone by the angle the body subtends so that partially-visible bodies count.
+        const double cos_to = (dx * dir_x + dy * dir_y) / dist;
+        const double limit = half_angle + std::asin(std::min(1.0, r / dist));
+        if (limit < std::acos(-1.0) && cos_to < std::cos(limit)) return;
+      }
+      PushBounded(out, max_results, {id, dist});
+    });
+    SortHits(out);
+  }
+
+  /// First matching body hit by a ray from (x, y) along angle, within range. Returns false if none.
+  bool Ray(double x, double y, double angle, double range, size_t kind_mask, SpatialHit & hit,
+           size_t exclude_id = Grid_t::NO_ENTRY) const {
+    const double dir_x = std::cos(angle), dir_y = std::sin(angle);
+    const double half = range / 2.0;
+    bool found = false;
+    hit.id = Grid_t::NO_ENTRY;
+    hit.dist = std::numeric_limits<double>::max();
+    // Candidates: everything touching the disc that circumscribes the ray segment.
+    grid.ForEachInRadius(x + dir_x * half, y + dir_y * half, half, [&](size_t id) {
+      if (!Matches(id, kind_mask, exclude_id)) return;
+      const double ox = grid.GetX(id) - x, oy = grid.GetY(id) - y;
+      const double r = grid.GetRadius(id);
+      const double proj = ox * dir_x + oy * dir_y;
+      const double perp_sq = (ox * ox + oy * oy) - proj * proj;
+      if (perp_sq > r * r) return;
+      const double half_chord = std::sqrt(r * r - perp_sq);
+      if (proj + half_chord < 0.0) return;     // Body is entirely behind the ray origin.
+      const double t_hit = std::max(proj - half_chord, 0.0);  // Origin inside the body counts as a hit at 0.
+      if (t_hit > range) return;
+      if (t_hit < hit.dist || (t_hit == hit.dist && id < hit.id)) { hit = {id, t_hit}; found = true; }
+    });
+    return found;
+  }
+
+  /// Evaluate one query, writing at most max_results hits into out.
+  void Run(const SpatialQuery & q, size_t max_results, emp::vector<SpatialHit> & out) const {
+    switch (q.type) {
+      case SpatialQuery::Type::NEAREST:
+        Nearest(q.x, q.y, std::min(q.k, max_results), q.kind_mask, q.range, out, q.exclude_id);
+        break;
+      case SpatialQuery::Type::RADIUS:
+        InRadius(q.x, q.y, q.range, q.kind_mask, out, q.exclude_id, max_results);
+        break;
+      case SpatialQuery::Type::CONE:
+        Cone(q.x, q.y, q.angle, q.half_angle, q.range, q.kind_mask, out, q.exclude_id, max_results);
+        break;
+      case SpatialQuery::Type::RAY: {
+        out.clear();
+        SpatialHit hit;
+        if (max_results && Ray(q.x, q.y, q.angle, q.range, q.kind_mask, hit, q.exclude_id)) out.push_back(hit);
+        break;
+      }
+    }
+  }
+
+  /// Evaluate a batch of queries (e.g., one per organism). Results for query i are written to
+  /// hits[i * max_results, i * max_results + counts[i]), so memory is fixed at
+  /// queries.size() * max_results regardless of how crowded the world gets. Queries are split into
+  /// contiguous chunks across num_threads workers (the grid is only read); the workers are kept
+  /// between batches, and small batches don't wake them at all.
+  void RunBatch(const emp::vector<SpatialQuery> & queries, size_t max_results,
+                emp::vector<SpatialHit> & hits, emp::vector<size_t> & counts,
+                size_t num_threads = 1) {
+    hits.resize(queries.size() * max_results);
+    counts.resize(queries.size());
+    auto run_range = [&](size_t begin, size_t end) {
+      emp::vector<SpatialHit> scratch;
+      scratch.reserve(max_results);
+      for (size_t i = begin; i < end; ++i) {
+        Run(queries[i], max_results, scratch);
+        counts[i] = std::min(scratch.size(), max_results);
+        std::copy(scratch.begin(), scratch.begin() + counts[i], hits.begin() + i * max_results);
+      }
+    };
+    pool.SetNumThreads(num_threads);
+    if (queries.size() < pool.GetNumThreads() * MIN_QUERIES_PER_THREAD) { run_range(0, queries.size()); return; }
+    pool.ForRanges(queries.size(), [&run_range](size_t, size_t begin, size_t end) { run_range(begin, end); });
+  }
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*
+  world/WorkerPool.h
+    Defines WorkerPool: a small fork-join pool of persistent threads for splitting per-update
+    batches (e.g., spatial queries) across cores.
+*/
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+
+#ifndef __EMSCRIPTEN__
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "base/vector.h"
+
+/// Helper threads sleep between jobs instead of being created and joined for every batch. The
+/// calling thread always takes a share of the work. Web builds have no pthreads, so there (or with
+/// one thread) everything runs on the calling thread.
+class WorkerPool {
+private:
+  size_t num_threads;                  //< Including the calling thread.
+#ifndef __EMSCRIPTEN__
+  emp::vector<std::thread> workers;    //< num_threads - 1 helpers.
+  std::mutex mutex;
+  std::condition_variable wake;        //< A new job (or shutdown) is ready.
+  std::condition_variable done;        //< The helpers finished the current job.
+  std::function<void(size_t)> job;     //< Current job: called with the thread id.
+  size_t generation;                   //< Bumped for every job so helpers don't rerun one.
+  size_t pending;                      //< Helpers still working on the current job.
+  bool stopping;
+
+  void WorkerLoop(size_t thread_id) {
+    size_t seen = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this, seen]() { return stopping || generation != seen; });
+        if (stopping) return;
+        seen = generation;
+      }
+      job(thread_id);
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--pending == 0) done.notify_one();
+    }
+  }
+
+  void StopWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto & worker : workers) worker.join();
+    workers.clear();
+    stopping = false;
+  }
+#endif
+
+public:
+  WorkerPool() : num_threads(1)
+#ifndef __EMSCRIPTEN__
+    , workers(), mutex(), wake(), done(), job(), generation(0), pending(0), stopping(false)
+#endif
+  { ; }
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool & operator=(const WorkerPool &) = delete;
+  ~WorkerPool() {
+#ifndef __EMSCRIPTEN__
+    StopWorkers();
+#endif
+  }
+
+  size_t GetNumThreads() const { return num_threads; }
+
+  /// Resize the pool (at least 1). Does nothing if the size is unchanged.
+  void SetNumThreads(size_t _num_threads) {
+#ifndef __EMSCRIPTEN__
+    _num_threads = std::max<size_t>(_num_threads, 1);
+    if (_num_threads == num_threads) return;
+    StopWorkers();
+    num_threads = _num_threads;
+    for (size_t t = 1; t < num_threads; ++t) workers.emplace_back([this, t]() { WorkerLoop(t); });
+#endif
+  }
+
+  /// Split [0, n) into one contiguous range per thread and call fun(thread_id, begin, end) for
+  /// each (the caller runs thread 0); returns when all are done.
+  void ForRanges(size_t n, const std::function<void(size_t, size_t, size_t)> & fun) {
+    auto run = [this, n, &fun](size_t thread_id) {
+      fun(thread_id, n * thread_id / num_threads, n * (thread_id + 1) / num_threads);
+    };
+#ifndef __EMSCRIPTEN__
+    if (num_threads > 1) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = run;
+        pending = num_threads - 1;
+        ++generation;
+      }
+      wake.notify_all();
+      run(0);
+      std::unique_lock<std::mutex> lock(mutex);
+      done.wait(lock, [this]() { return pending == 0; });
+      return;
+    }
+#endif
+    run(0);
+  }
+};
+
+#endif